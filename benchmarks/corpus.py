@@ -0,0 +1,108 @@
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+
+"""Synthetic PDFs for the benchmarks.
+
+Each corpus is generated deterministically, so that results from different
+runs and releases measure the same files. ``scale`` multiplies the size of
+every corpus; the defaults at ``scale=1`` take a few seconds to generate.
+"""
+
+import random
+import zlib
+from io import BytesIO
+
+import pikepdf
+from pikepdf import Array, Dictionary, Name
+
+PAGE_CONTENT = b'BT /F1 12 Tf 72 720 Td (Page %d) Tj ET'
+
+
+def _scaled(n, scale):
+    return max(1, int(n * scale))
+
+
+def _saved(pdf):
+    out = BytesIO()
+    pdf.save(out, static_id=True)
+    return out.getvalue()
+
+
+def many_pages(scale=1.0):
+    """Pages with a small content stream each"""
+    pdf = pikepdf.new()
+    font = pdf.make_indirect(
+        Dictionary(Type=Name.Font, Subtype=Name.Type1, BaseFont=Name.Helvetica)
+    )
+    for i in range(_scaled(5_000, scale)):
+        page = pdf.add_blank_page()
+        page.Resources = Dictionary(Font=Dictionary(F1=font))
+        page.Contents = pdf.make_stream(PAGE_CONTENT % i)
+    return _saved(pdf)
+
+
+def many_objects(scale=1.0):
+    """Many small indirect dictionaries, reachable from the catalog"""
+    pdf = pikepdf.new()
+    pdf.add_blank_page()
+    pdf.Root.Objects = Array(
+        pdf.make_indirect(
+            Dictionary(Type=Name.Test, Index=i, Rect=[0, 0, i % 612, 1.5 * i])
+        )
+        for i in range(_scaled(100_000, scale))
+    )
+    return _saved(pdf)
+
+
+def huge_stream(scale=1.0):
+    """One large Flate compressed stream, half noise and half repetitive"""
+    half = _scaled(16 << 20, scale)
+    noise = random.Random(0).getrandbits(8 * half).to_bytes(half, 'little')
+    data = noise + bytes(range(256)) * (half // 256)
+    pdf = pikepdf.new()
+    page = pdf.add_blank_page()
+    stream = pdf.make_stream(b'')
+    stream.write(zlib.compress(data), filter=Name.FlateDecode)
+    page.Blob = stream
+    return _saved(pdf)
+
+
+def deep_tree(scale=1.0):
+    """A long chain of indirect dictionaries and deeply nested direct arrays"""
+    depth = _scaled(500, scale)
+    pdf = pikepdf.new()
+    page = pdf.add_blank_page()
+    node = pdf.make_indirect(Dictionary(Depth=depth))
+    for i in range(depth - 1, 0, -1):
+        node = pdf.make_indirect(Dictionary(Depth=i, Child=node))
+    page.Chain = node
+    nested = Array([0])
+    for _ in range(depth):
+        nested = Array([nested])
+    page.Nested = nested
+    return _saved(pdf)
+
+
+def dense_content(scale=1.0):
+    """One page whose content stream has very many operators"""
+    rng = random.Random(0)
+    ops = []
+    for _ in range(_scaled(100_000, scale)):
+        x, y = rng.randrange(612), rng.randrange(792)
+        ops.append(b'q 1 0 0 1 %d %d cm 0 0 m 10 10 l 0.5 w S Q' % (x, y))
+    pdf = pikepdf.new()
+    page = pdf.add_blank_page()
+    page.Contents = pdf.make_stream(b'\n'.join(ops))
+    return _saved(pdf)
+
+
+CORPORA = {
+    'many_pages': many_pages,
+    'many_objects': many_objects,
+    'huge_stream': huge_stream,
+    'deep_tree': deep_tree,
+    'dense_content': dense_content,
+}
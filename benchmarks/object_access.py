@@ -0,0 +1,68 @@
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+
+"""Measure the cost of returning objects from a Pdf to Python.
+
+Run with ``python benchmarks/object_access.py``. For each kind of access, this
+reports the time per object returned, and how much the reference count of the
+Pdf grew while the objects were alive, which should be one per object.
+"""
+
+import gc
+import sys
+import timeit
+
+import pikepdf
+from pikepdf import Dictionary, Name, settings
+
+N_OBJECTS = 10_000
+REPEAT = 5
+
+
+def make_pdf():
+    pdf = pikepdf.new()
+    pdf.Root.Objects = pikepdf.Array(
+        pdf.make_indirect(Dictionary(Type=Name.Test, Index=i, Font=Name.Helv))
+        for i in range(N_OBJECTS)
+    )
+    return pdf
+
+
+def per_object(fn, number):
+    return min(timeit.repeat(fn, number=1, repeat=REPEAT)) / number * 1e9
+
+
+def main():
+    pdf = make_pdf()
+    objects = pdf.Root.Objects
+
+    def indirect_access():
+        return [objects[i] for i in range(N_OBJECTS)]
+
+    def name_access():
+        return [d.Font for d in held]
+
+    before = sys.getrefcount(pdf)
+    held = indirect_access()
+    growth = sys.getrefcount(pdf) - before
+
+    print(f"indirect objects: {per_object(indirect_access, N_OBJECTS):.0f} ns each")
+    print(f"  Pdf references per live object: {growth / N_OBJECTS:.2f}")
+    for intern in (False, True):
+        settings.set_intern_scalars(intern)
+        print(
+            f"names, intern_scalars={intern}: "
+            f"{per_object(name_access, N_OBJECTS):.0f} ns each"
+        )
+    settings.set_intern_scalars(False)
+
+    del held
+    gc.collect()
+    print(f"  Pdf references after release: {sys.getrefcount(pdf) - before}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,274 @@
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+
+"""Benchmarks for the hot paths of pikepdf, with machine-readable results.
+
+Run with ``make bench``, or ``python benchmarks/run.py``. Each benchmark is
+timed on one of the synthetic corpora in ``corpus.py``, and the results are
+written as JSON, to standard output or to ``--output``, so that they can be
+compared across releases. A summary is printed to standard error.
+
+Times are in seconds per call. ``best`` is the fastest of ``repeat`` runs, and
+is the number to compare; ``median`` shows how noisy the measurement was.
+"""
+
+import argparse
+import json
+import platform
+import re
+import statistics
+import sys
+import tempfile
+import timeit
+from datetime import datetime, timezone
+from io import BytesIO
+from pathlib import Path
+from typing import Callable, Dict, List, NamedTuple
+
+import pikepdf
+from pikepdf import AccessMode, Array, Dictionary, Object, ObjectStreamMode
+
+from corpus import CORPORA
+
+RESULTS_FORMAT = 1
+
+
+class Benchmark(NamedTuple):
+    name: str
+    corpus: str
+    params: Dict[str, str]
+    # Called with the path to the corpus; returns the function to time
+    setup: Callable[[Path], Callable[[], object]]
+
+    @property
+    def id(self) -> str:
+        params = ','.join(f'{k}={v}' for k, v in self.params.items())
+        return f'{self.name}[{self.corpus}{"," if params else ""}{params}]'
+
+
+BENCHMARKS: List[Benchmark] = []
+
+
+def benchmark(name, corpus, **params):
+    def decorator(setup):
+        BENCHMARKS.append(Benchmark(name, corpus, params, setup))
+        return setup
+
+    return decorator
+
+
+def _register_open(corpus):
+    for mode_name, mode in AccessMode.__members__.items():
+
+        @benchmark('open_pdf', corpus, access_mode=mode_name)
+        def open_pdf(path, mode=mode):
+            def run():
+                with pikepdf.open(path, access_mode=mode) as pdf:
+                    return len(pdf.pages)
+
+            return run
+
+
+for _corpus in ('many_pages', 'many_objects', 'huge_stream'):
+    _register_open(_corpus)
+
+
+@benchmark('pages_index', 'many_pages')
+def pages_index(path):
+    pages = pikepdf.open(path).pages
+    n = len(pages)
+
+    def run():
+        return [pages[i] for i in range(n)]
+
+    return run
+
+
+@benchmark('pages_index', 'many_pages', order='strided')
+def pages_index_strided(path):
+    pages = pikepdf.open(path).pages
+    n = len(pages)
+    order = [(i * 7919) % n for i in range(n)]
+
+    def run():
+        return [pages[i] for i in order]
+
+    return run
+
+
+@benchmark('parse_stream_grouped', 'dense_content')
+def parse_stream_grouped(path):
+    contents = pikepdf.open(path).pages[0].Contents
+
+    def run():
+        return Object._parse_stream_grouped(contents, '')
+
+    return run
+
+
+@benchmark('parse_stream_grouped', 'many_pages', operators='Tj')
+def parse_stream_grouped_pages(path):
+    pdf = pikepdf.open(path)
+    contents = [page.Contents for page in pdf.pages]
+
+    def run():
+        return [Object._parse_stream_grouped(c, 'Tj') for c in contents]
+
+    return run
+
+
+@benchmark('objecthandle_encode', 'none', value='flat_list')
+def encode_flat(_path):
+    values = [v for i in range(20_000) for v in (i, i * 0.5, f'/N{i % 50}', True)]
+
+    def run():
+        return Array(values)
+
+    return run
+
+
+@benchmark('objecthandle_encode', 'none', value='nested_dict')
+def encode_nested(_path):
+    item = {
+        '/Type': pikepdf.Name.Annot,
+        '/Rect': [0, 0, 100.5, 200.25],
+        '/Border': [0, 0, 1],
+        '/T': 'field',
+    }
+    values = {f'/K{i}': dict(item, **{'/Index': i}) for i in range(5_000)}
+
+    def run():
+        return Dictionary(values)
+
+    return run
+
+
+@benchmark('read_bytes', 'huge_stream')
+def read_bytes_huge(path):
+    blob = pikepdf.open(path).pages[0].Blob
+
+    def run():
+        return len(blob.read_bytes())
+
+    return run
+
+
+@benchmark('read_bytes', 'many_pages')
+def read_bytes_many(path):
+    pdf = pikepdf.open(path)
+    contents = [page.Contents for page in pdf.pages]
+
+    def run():
+        return sum(len(c.read_bytes()) for c in contents)
+
+    return run
+
+
+SAVE_VARIANTS = {
+    'default': {},
+    'linearize': {'linearize': True},
+    'object_streams': {'object_stream_mode': ObjectStreamMode.generate},
+}
+
+
+def _register_save(corpus):
+    for variant, kwargs in SAVE_VARIANTS.items():
+
+        @benchmark('save_pdf', corpus, variant=variant)
+        def save_pdf(path, kwargs=kwargs):
+            pdf = pikepdf.open(path)
+
+            def run():
+                out = BytesIO()
+                pdf.save(out, **kwargs)
+                return out.tell()
+
+            return run
+
+
+for _corpus in ('many_pages', 'many_objects', 'deep_tree', 'huge_stream'):
+    _register_save(_corpus)
+
+
+def measure(fn, repeat):
+    timer = timeit.Timer(fn)
+    number, _ = timer.autorange()
+    times = [t / number for t in timer.repeat(repeat=repeat, number=number)]
+    return number, times
+
+
+def environment(scale):
+    return {
+        'pikepdf': pikepdf.__version__,
+        'qpdf': pikepdf.__libqpdf_version__,
+        'python': platform.python_version(),
+        'implementation': platform.python_implementation(),
+        'platform': platform.platform(),
+        'machine': platform.machine(),
+        'timestamp': datetime.now(timezone.utc).isoformat(),
+        'scale': scale,
+    }
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('-o', '--output', type=Path, help="write JSON here")
+    parser.add_argument(
+        '-k', '--filter', default='', help="only run benchmarks whose id matches"
+    )
+    parser.add_argument('--repeat', type=int, default=5)
+    parser.add_argument(
+        '--scale', type=float, default=1.0, help="multiply the size of each corpus"
+    )
+    parser.add_argument('--list', action='store_true', help="list benchmark ids")
+    args = parser.parse_args(argv)
+
+    selected = [b for b in BENCHMARKS if re.search(args.filter, b.id)]
+    if args.list:
+        for b in selected:
+            print(b.id)
+        return 0
+
+    results = []
+    with tempfile.TemporaryDirectory(prefix='pikepdf-bench-') as tmpdir:
+        paths: Dict[str, Path] = {}
+        for b in selected:
+            if b.corpus in CORPORA and b.corpus not in paths:
+                print(f"generating {b.corpus}", file=sys.stderr)
+                paths[b.corpus] = Path(tmpdir) / f'{b.corpus}.pdf'
+                paths[b.corpus].write_bytes(CORPORA[b.corpus](args.scale))
+
+        for b in selected:
+            number, times = measure(b.setup(paths.get(b.corpus)), args.repeat)
+            result = {
+                'id': b.id,
+                'name': b.name,
+                'corpus': b.corpus,
+                'params': b.params,
+                'number': number,
+                'repeat': args.repeat,
+                'times': times,
+                'best': min(times),
+                'median': statistics.median(times),
+            }
+            results.append(result)
+            print(f"{b.id:<60} {result['best'] * 1e3:10.3f} ms", file=sys.stderr)
+
+    report = {
+        'format': RESULTS_FORMAT,
+        'environment': environment(args.scale),
+        'results': results,
+    }
+    text = json.dumps(report, indent=2)
+    if args.output:
+        args.output.write_text(text + '\n')
+    else:
+        print(text)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -32,6 +32,13 @@ if qpdf_source_tree:
 if 'bsd' in sys.platform:
     extra_includes.append('/usr/local/include')
 
+extra_libraries = []
+extra_macros = []
+if environ.get('PIKEPDF_JBIG2DEC', None):
+    # Decode JBIG2 images in-process with libjbig2dec (0.18 or newer)
+    extra_libraries.append('jbig2dec')
+    extra_macros.append(('PIKEPDF_HAVE_JBIG2DEC', '1'))
+
 try:
     from setuptools_scm import get_version
 
@@ -50,7 +57,8 @@ ext_modules = [
             *extra_includes,
         ],
         library_dirs=[*extra_library_dirs],
-        libraries=['qpdf'],
+        libraries=['qpdf', *extra_libraries],
+        define_macros=[*extra_macros],
         cxx_std=14,
     )
 ]
@@ -24,6 +24,7 @@ from ._qpdf import (
     AccessMode,
     Annotation,
     ForeignObjectError,
+    NativeTokenFilter,
     ObjectStreamMode,
     Page,
     PasswordError,
@@ -33,6 +34,8 @@ from ._qpdf import (
     Token,
     TokenFilter,
     TokenType,
+    register_stream_decoder,
+    stream_decoders,
 )
 
 from .objects import (
@@ -62,7 +65,15 @@ from .models import (
     unparse_content_stream,
 )
 
-from . import _methods, codec
+from ._batch import BatchResult, batch_process
+
+from . import _methods, codec, settings
+from ._methods import (
+    ChunkedSaveResult,
+    DeduplicationResult,
+    PageAnalysis,
+    VerifyProblem,
+)
 
 __libqpdf_version__ = _qpdf.qpdf_version()
 
@@ -0,0 +1,198 @@
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+
+"""Open, edit and save many PDFs in parallel on native threads."""
+
+import os
+from typing import Iterable, List, NamedTuple, Optional, Sequence, Tuple, Union
+
+from ._qpdf import _batch_process, _BatchSaveOptions
+
+PathLike = Union[str, bytes, os.PathLike]
+
+_SAVE_OPTIONS = {
+    'static_id',
+    'preserve_pdfa',
+    'min_version',
+    'force_version',
+    'compress_streams',
+    'stream_decode_level',
+    'object_stream_mode',
+    'normalize_content',
+    'linearize',
+    'qdf',
+    'recompress_flate',
+}
+
+
+class BatchResult(NamedTuple):
+    """The outcome of one job run by :func:`pikepdf.batch_process`."""
+
+    input: PathLike
+    """The input file, as given."""
+
+    output: PathLike
+    """The output file, as given."""
+
+    error: Optional[Exception]
+    """``None`` if the job succeeded, or the exception that it failed with."""
+
+    @property
+    def ok(self) -> bool:
+        """``True`` if the job succeeded."""
+        return self.error is None
+
+
+def _docinfo_key(key) -> str:
+    key = str(key)
+    if not key.startswith('/'):
+        key = '/' + key
+    return key
+
+
+def _normalize_op(op) -> Tuple[str, str, str]:
+    if isinstance(op, str):
+        op = (op,)
+    if not op:
+        raise ValueError("empty edit")
+    name, args = op[0], tuple(op[1:])
+    if name == 'set_docinfo' and len(args) == 2:
+        return (name, _docinfo_key(args[0]), str(args[1]))
+    if name == 'delete_docinfo' and len(args) == 1:
+        return (name, _docinfo_key(args[0]), '')
+    if name == 'delete_xmp' and len(args) == 0:
+        return (name, '', '')
+    if name == 'rotate' and len(args) == 1:
+        angle = args[0]
+        if not isinstance(angle, int) or angle % 90 != 0:
+            raise ValueError("rotate angle must be a multiple of 90")
+        return (name, str(angle), '')
+    raise ValueError(f"unsupported batch edit: {op!r}")
+
+
+def _version_ext(version) -> Tuple[str, int]:
+    if isinstance(version, str):
+        return version, 0
+    try:
+        ver, ext = version
+        return str(ver), int(ext)
+    except (TypeError, ValueError):
+        raise TypeError("PDF version must be a tuple: (str, int)") from None
+
+
+def _save_options(options) -> _BatchSaveOptions:
+    unknown = set(options) - _SAVE_OPTIONS
+    if unknown:
+        raise TypeError(
+            f"batch_process does not support these save options: {sorted(unknown)}"
+        )
+    opts = _BatchSaveOptions()
+    for name, value in options.items():
+        if name == 'min_version':
+            opts.min_version, opts.min_extension_level = _version_ext(value)
+        elif name == 'force_version':
+            opts.force_version, opts.force_extension_level = _version_ext(value)
+        else:
+            setattr(opts, name, value)
+    if opts.normalize_content and opts.linearize:
+        raise ValueError("cannot save with both normalize_content and linearize")
+    return opts
+
+
+def _same_file(input_path, output_path) -> bool:
+    try:
+        return os.path.samefile(input_path, output_path)
+    except FileNotFoundError:
+        return False
+
+
+def batch_process(
+    jobs: Iterable[Tuple[PathLike, PathLike]],
+    ops: Sequence = (),
+    *,
+    workers: Optional[int] = None,
+    password: Union[str, bytes] = "",
+    inherit_page_attributes: bool = True,
+    **save_options,
+) -> List[BatchResult]:
+    """
+    Open, edit and save many PDFs at once, in parallel on native threads.
+
+    Each job opens an input file, applies the edits in ``ops``, and saves the
+    result to its output file. Every job has its own ``Pdf``, and runs entirely
+    in native code without holding the GIL, so jobs run in parallel and other
+    Python threads are free to run meanwhile. This is intended for workloads
+    that apply the same simple changes to a large number of files.
+
+    Only a restricted set of declarative edits is supported, since jobs do not
+    run any Python code:
+
+    * ``('set_docinfo', key, value)`` sets a key in the document info
+      dictionary, creating it if necessary, e.g. ``('set_docinfo', '/Title', 'x')``.
+    * ``('delete_docinfo', key)`` deletes a key from the document info
+      dictionary, if present.
+    * ``('delete_xmp',)`` removes XMP metadata.
+    * ``('rotate', angle)`` rotates every page by a multiple of 90 degrees,
+      relative to its current rotation.
+
+    Errors do not stop the batch. Each job's result reports the exception it
+    failed with, such as :class:`pikepdf.PdfError`,
+    :class:`pikepdf.PasswordError` or :class:`OSError`. The output file of a
+    failed job may be incomplete.
+
+    Args:
+        jobs: Pairs of ``(input, output)`` filenames.
+        ops: The edits to apply to each file, in order.
+        workers: Number of threads to use. By default, one per CPU.
+        password: Password to use for encrypted inputs. Outputs are not
+            encrypted.
+        inherit_page_attributes: As for :meth:`pikepdf.Pdf.open`.
+        **save_options: Any of the following arguments to
+            :meth:`pikepdf.Pdf.save`: ``static_id``, ``preserve_pdfa``,
+            ``min_version``, ``force_version``, ``compress_streams``,
+            ``stream_decode_level``, ``object_stream_mode``,
+            ``normalize_content``, ``linearize``, ``qdf``, ``recompress_flate``.
+            Options that call back into Python, such as ``progress`` and
+            ``fix_metadata_version``, are not supported.
+
+    Returns:
+        One :class:`pikepdf.BatchResult` per job, in the order of ``jobs``.
+
+    .. versionadded:: 2.13
+    """
+    jobs = [(input_path, output_path) for input_path, output_path in jobs]
+    edits = [_normalize_op(op) for op in ops]
+    opts = _save_options(save_options)
+    if workers is None:
+        workers = 0
+    elif workers < 1:
+        raise ValueError("workers must be at least 1")
+
+    errors: List[Optional[Exception]] = [None] * len(jobs)
+    native_jobs = []
+    native_indexes = []
+    for n, (input_path, output_path) in enumerate(jobs):
+        if _same_file(input_path, output_path):
+            errors[n] = ValueError("Cannot overwrite input file")
+            continue
+        native_jobs.append((os.fsencode(input_path), os.fsencode(output_path)))
+        native_indexes.append(n)
+
+    outcomes = _batch_process(
+        native_jobs, edits, password, inherit_page_attributes, opts, workers
+    )
+    for n, outcome in zip(native_indexes, outcomes):
+        if outcome.ok:
+            continue
+        try:
+            outcome.reraise()
+        except Exception as e:  # pylint: disable=broad-except
+            errors[n] = e
+
+    return [
+        BatchResult(input_path, output_path, error)
+        for (input_path, output_path), error in zip(jobs, errors)
+    ]
@@ -12,27 +12,47 @@ bindings after the fact.
 We can also move the implementation to C++ if desired.
 """
 
+import hashlib
 import inspect
 import shutil
 from collections.abc import KeysView
 from decimal import Decimal
 from io import BytesIO
 from os import replace
+from os.path import samefile
 from pathlib import Path
 from subprocess import PIPE, run
 from tempfile import NamedTemporaryFile
-from typing import Any, BinaryIO, Callable, List, Optional, Tuple, Type, TypeVar, Union
+from typing import (
+    Any,
+    BinaryIO,
+    Callable,
+    Dict,
+    Iterable,
+    List,
+    NamedTuple,
+    Optional,
+    Tuple,
+    Type,
+    TypeVar,
+    Union,
+)
 from warnings import warn
 
 from . import Array, Dictionary, Name, Object, Page, Pdf, Stream
 from ._qpdf import (
     AccessMode,
     ObjectStreamMode,
+    PageList,
     PdfError,
     StreamDecodeLevel,
     StreamParser,
     Token,
+    _analyze_pages,
+    _deduplicate,
     _ObjectMapping,
+    _scan_annotations,
+    _verify,
 )
 from .models import Encryption, EncryptionInfo, Outline, PdfMetadata, Permissions
 
@@ -44,6 +64,87 @@ __all__ = []
 Numeric = TypeVar('Numeric', int, float, Decimal)
 
 
+class ChunkedSaveResult(NamedTuple):
+    """The outcome of :meth:`pikepdf.Pdf.save_chunked`."""
+
+    bytes_written: int
+    """The total size of the PDF, in bytes."""
+
+    checksum: Optional[str]
+    """Hex digest of the requested checksum of the whole PDF, if any."""
+
+
+class DeduplicationResult(NamedTuple):
+    """The outcome of :meth:`pikepdf.Pdf.deduplicate`."""
+
+    streams: int
+    """The number of duplicate streams that were merged."""
+
+    objects: int
+    """The number of duplicate dictionaries and arrays that were merged."""
+
+    bytes_saved: int
+    """The size of the raw data and unparsed dictionaries of the merged
+    objects. The output file shrinks by about this much, before any
+    compression of object streams."""
+
+
+class VerifyProblem(NamedTuple):
+    """A problem found by :meth:`pikepdf.Pdf.verify`."""
+
+    kind: str
+    """``'stream'`` if a stream's data could not be read or decoded,
+    ``'content'`` if a page's content stream has a syntax error, or
+    ``'warning'`` for other problems that qpdf noticed in the file."""
+
+    message: str
+    """Description of the problem."""
+
+    objgen: Optional[Tuple[int, int]]
+    """The object (the stream, or the page) that has the problem, if any."""
+
+    page: Optional[int]
+    """Index of the page that has the problem, for content problems."""
+
+
+class PageAnalysis(NamedTuple):
+    """A summary of one page's content, from :meth:`pikepdf._qpdf.PageList.analyze`.
+
+    Fields that were not collected are ``None``.
+    """
+
+    operators: Optional[Dict[str, int]]
+    """How many times each operator occurs in the content stream."""
+
+    resources: Optional[Dict[str, List[str]]]
+    """The names of the resources that the content stream uses, by category
+    such as ``'/Font'`` or ``'/XObject'``, in order of first use."""
+
+    images: Optional[List[Tuple[Optional[str], Tuple[float, ...]]]]
+    """Each time an image is drawn, the name of the image XObject (``None``
+    for an inline image) and the current transformation matrix at the time,
+    which maps the unit square to the image's placement on the page. Images
+    drawn by form XObjects are not included."""
+
+    text_shows: Optional[int]
+    """The number of text-showing operators."""
+
+    text_bytes: Optional[int]
+    """The number of bytes of strings shown."""
+
+    text_bbox: Optional[Tuple[float, float, float, float]]
+    """The bounding box, in user space, of the points at which text is shown,
+    or ``None`` if no text is shown. Since fonts are not read, this does not
+    include the extent of the glyphs."""
+
+    error: Optional[str]
+    """Why the content stream could not be completely analyzed, if it could
+    not. The other fields describe the content up to the problem."""
+
+
+PAGE_ANALYSES = ('operators', 'resources', 'images', 'text')
+
+
 def augments(cls_cpp: Type[Any]):
     """Attach methods of a Python support class to an existing class
 
@@ -206,7 +307,7 @@ class Extend_Object:
 
     def write(
         self,
-        data: bytes,
+        data: Union[bytes, memoryview],
         *,
         filter: Union[Name, Array, None] = None,
         decode_parms: Union[Dictionary, Array, None] = None,
@@ -227,7 +328,14 @@ class Extend_Object:
         into a PDF and displayed as images.
 
         Args:
-            data: the new data to use for replacement
+            data: the new data to use for replacement. This may be ``bytes``
+                or any other object that supports the buffer protocol and is
+                C-contiguous. Read-only buffers, such as ``bytes``, are
+                referenced rather than copied, so that large streams can be
+                written without duplicating them in memory. Writable buffers,
+                such as ``bytearray`` or NumPy arrays, are copied once;
+                pass ``memoryview(data).toreadonly()`` to avoid the copy if
+                you will not modify the data afterwards.
             filter: The filter(s) with which the
                 data is (already) encoded
             decode_parms: Parameters for the
@@ -243,6 +351,10 @@ class Extend_Object:
         parameters for that filter. If there are multiple filters, then
         `decode_parms` is an Array of Dictionary, where each array index
         is corresponds to the filter.
+
+        .. versionchanged:: 2.13
+            Accept any C-contiguous buffer as ``data``, and avoid copying
+            read-only buffers.
         """
 
         if type_check and filter is not None:
@@ -588,6 +700,130 @@ class Extend_Pdf:
 
         return problems
 
+    def verify(self, *, jobs: Optional[int] = None) -> List['VerifyProblem']:
+        """
+        Check that every stream can be decoded, and that every page's content
+        stream is well-formed.
+
+        This does the same checks as :meth:`check`, but natively: streams are
+        decoded directly rather than by writing the whole PDF, and streams and
+        pages are checked in parallel on native threads, without holding the
+        GIL. Content streams are tokenized rather than parsed into objects.
+        Other threads must not access or modify this ``Pdf`` until this
+        method returns.
+
+        Args:
+            jobs: Number of threads to use. By default, one per CPU.
+
+        Returns:
+            The problems found, if any: first those of streams in object
+            order, then those of pages in page order, then any other warnings.
+            The warnings are not cleared; :meth:`get_warnings` still returns
+            them.
+
+        .. versionadded:: 2.13
+        """
+        if jobs is None:
+            jobs = 0
+        elif jobs < 1:
+            raise ValueError("jobs must be at least 1")
+        return [
+            VerifyProblem(
+                kind,
+                message,
+                (objid, gen) if objid else None,
+                page if page >= 0 else None,
+            )
+            for objid, gen, page, kind, message in _verify(self, jobs)
+        ]
+
+    def deduplicate(self, *, jobs: Optional[int] = None) -> 'DeduplicationResult':
+        """
+        Merge identical streams and objects, so that each is saved once.
+
+        Streams with the same dictionary, apart from ``/Length``, and the same
+        raw data, and indirect dictionaries and arrays with the same contents,
+        are merged into the first of them, in object order. References to the
+        others are changed to refer to it, so that they are no longer part of
+        the document and are not saved. Since merging objects can make the objects that
+        refer to them identical, this repeats until nothing more merges.
+
+        Objects whose identity matters are never merged: pages and the page
+        tree, the document catalog, annotations, form fields, outlines,
+        structure elements, optional content groups, signatures and
+        encryption dictionaries, and any dictionary with a ``/Parent`` or
+        ``/P`` key.
+
+        Raw stream data is hashed on native threads, without holding the GIL.
+        Streams are compared exactly, not just by hash, mostly from the data
+        already read for hashing, which is read at most 64 MB at a time.
+
+        Args:
+            jobs: Number of threads to use. By default, one per CPU.
+
+        Returns:
+            The number of streams and objects merged, and the bytes saved.
+
+        .. note::
+
+            :class:`pikepdf.Object` instances that referred to a merged
+            duplicate still refer to it afterwards, and it keeps its contents,
+            but changes to it are not saved, since nothing in the document
+            refers to it any more.
+
+        .. versionadded:: 2.13
+        """
+        if jobs is None:
+            jobs = 0
+        elif jobs < 1:
+            raise ValueError("jobs must be at least 1")
+        return DeduplicationResult(*_deduplicate(self, jobs))
+
+    def scan_annotations(
+        self, fields: Optional[Iterable[str]] = None
+    ) -> Dict[str, Any]:
+        """
+        Read the annotations of all pages at once, into columns.
+
+        This walks every page's ``/Annots`` in one pass, which is much faster
+        than creating a :class:`pikepdf.Annotation` for each annotation and
+        reading its properties one at a time. Each column has one entry per
+        annotation, in page order and then in the order of each page's
+        ``/Annots``, so the columns line up, e.g. for
+        ``pandas.DataFrame(pdf.scan_annotations())``.
+
+        The available fields are:
+
+        * ``'page'``: the index of the page, as ``int``.
+        * ``'objgen'``: the annotation's ``(objid, gen)``, or ``(0, 0)`` if it
+          is a direct object.
+        * ``'subtype'``: the ``/Subtype``, as ``str`` such as ``'/Widget'``.
+        * ``'flags'``: the ``/F`` flags, as ``int``, or 0 if absent.
+        * ``'rect'``: the ``/Rect`` of all annotations, as one ``memoryview``
+          of format ``'d'`` with four values per annotation, which may be
+          reshaped with ``numpy.asarray(rect).reshape(-1, 4)``. Missing or
+          invalid values are NaN.
+        * ``'appearance_state'``: the ``/AS``, as ``str``, or ``None``.
+        * ``'field_name'``: the fully qualified name of the form field a
+          widget belongs to, as ``str``, or ``None``.
+
+        Args:
+            fields: The fields to read. By default, all of them.
+
+        Returns:
+            A dictionary mapping each field to its column.
+
+        Raises:
+            ValueError: If a field is not one of the above.
+
+        .. versionadded:: 2.13
+        """
+        if fields is None:
+            return _scan_annotations(self)
+        if isinstance(fields, str):
+            fields = [fields]
+        return _scan_annotations(self, list(fields))
+
     def _attach(
         self,
         *,
@@ -681,13 +917,16 @@ class Extend_Pdf:
         progress: Callable[[int], None] = None,
         encryption: Optional[Union[Encryption, bool]] = None,
         recompress_flate: bool = False,
+        jobs: Optional[int] = None,
+        deduplicate: bool = False,
     ) -> None:
         """
         Save all modifications to this :class:`pikepdf.Pdf`.
 
         Args:
             filename_or_stream: Where to write the output. If a file
-                exists in this location it will be overwritten.
+                exists in this location it will be overwritten. A stream
+                need only have a ``write()`` method; it need not be seekable.
                 If the file was opened with ``allow_overwriting_input=True``,
                 then it is permitted to overwrite the original file, and
                 this parameter may be omitted to implicitly use the original
@@ -746,6 +985,14 @@ class Extend_Pdf:
                 do this, which may be useful if recompressing streams to a
                 higher compression level.
 
+            jobs: Number of threads that ``deduplicate=True`` uses. By
+                default, one per CPU. Streams are compressed as the file is
+                written, on one thread.
+
+            deduplicate: If ``True``, identical streams and objects are merged
+                before saving, as by :meth:`deduplicate`, using *jobs* threads.
+                Unlike the other options, this modifies the ``Pdf``.
+
             normalize_content: Enables parsing and reformatting the
                 content stream within PDFs. This may debugging PDFs easier.
 
@@ -780,7 +1027,8 @@ class Extend_Pdf:
         to generate different versions of a file, and you *may* continue
         to modify the file after saving it. ``.save()`` does not modify
         the ``Pdf`` object in memory, except possibly by updating the XMP
-        metadata version with ``fix_metadata_version``.
+        metadata version with ``fix_metadata_version``, or by merging
+        objects with ``deduplicate``.
 
         .. note::
 
@@ -791,15 +1039,30 @@ class Extend_Pdf:
 
         .. note::
 
-            pikepdf can read PDFs with incremental updates, but always
-            coalesces any incremental updates into a single non-incremental
-            PDF file when saving.
+            pikepdf can read PDFs with incremental updates, but ``.save()``
+            always coalesces any incremental updates into a single
+            non-incremental PDF file. To append changes to the original file
+            as an incremental update, use :meth:`pikepdf.Pdf.save_incremental`.
+
+        .. note::
+
+            The GIL is released while the PDF is being written, so other Python
+            threads may run during a save. Those threads must not access or
+            modify this ``Pdf`` until ``.save()`` returns.
 
         .. versionchanged:: 2.7
             Added *recompress_flate*.
+
+        .. versionchanged:: 2.13
+            The GIL is released during the write. Streams no longer need to
+            be seekable. Added *jobs* and *deduplicate*.
         """
         if not filename_or_stream and self._original_filename:
             filename_or_stream = self._original_filename
+        if jobs is not None and jobs < 1:
+            raise ValueError("jobs must be at least 1")
+        if deduplicate:
+            self.deduplicate(jobs=jobs)
         self._save(
             filename_or_stream,
             static_id=static_id,
@@ -819,6 +1082,152 @@ class Extend_Pdf:
             recompress_flate=recompress_flate,
         )
 
+    def save_chunked(
+        self,
+        sink: Union[Callable[[bytes], Any], BinaryIO],
+        *,
+        chunk_size: int = 1024 * 1024,
+        checksum: Optional[str] = 'md5',
+        **save_options,
+    ) -> 'ChunkedSaveResult':
+        """
+        Save this :class:`pikepdf.Pdf` as a series of fixed-size chunks.
+
+        This is intended for output that is sent somewhere as it is produced,
+        such as an HTTP response or a multipart upload, without holding the
+        whole file in memory. The PDF is written in one forward pass, and only
+        one chunk is buffered at a time.
+
+        Args:
+            sink: A callable, which is called with each chunk as ``bytes``, or
+                a file-like object with a ``write()`` method. Every chunk is
+                exactly ``chunk_size`` bytes except the last, which may be
+                shorter. The sink is called from the thread that called this
+                method; to feed an ``asyncio`` application, hand the chunks
+                over with :meth:`asyncio.loop.call_soon_threadsafe` or
+                similar, and run this method in an executor.
+            chunk_size: Size of each chunk, in bytes.
+            checksum: The name of a :mod:`hashlib` algorithm, which is
+                updated with each chunk as it is produced, or ``None`` to
+                skip computing a checksum.
+            **save_options: Any of the arguments to :meth:`pikepdf.Pdf.save`,
+                other than the output.
+
+        Returns:
+            The number of bytes written and the hex digest of the checksum.
+
+        .. versionadded:: 2.13
+        """
+        if callable(sink):
+            callback = sink
+        elif hasattr(sink, 'write'):
+            callback = sink.write
+        else:
+            raise TypeError("sink must be callable or have a write() method")
+        if chunk_size < 1:
+            raise ValueError("chunk_size must be positive")
+
+        valid_options = set(inspect.signature(Pdf.save).parameters) - {
+            'self',
+            'filename_or_stream',
+        }
+        unknown = set(save_options) - valid_options
+        if unknown:
+            raise TypeError(f"unexpected save options: {sorted(unknown)}")
+
+        jobs = save_options.pop('jobs', None)
+        if jobs is not None and jobs < 1:
+            raise ValueError("jobs must be at least 1")
+        if save_options.pop('deduplicate', False):
+            self.deduplicate(jobs=jobs)
+        hasher = hashlib.new(checksum) if checksum is not None else None
+        bytes_written = self._save(
+            None,
+            samefile_check=False,
+            chunk_callback=callback,
+            chunk_size=chunk_size,
+            hasher=hasher,
+            **save_options,
+        )
+        return ChunkedSaveResult(
+            bytes_written, hasher.hexdigest() if hasher is not None else None
+        )
+
+    def save_incremental(
+        self, filename_or_stream: Union[Path, str, BinaryIO, None] = None
+    ) -> int:
+        """
+        Save changes by appending them to the original file, as an incremental
+        update.
+
+        The original file is kept byte for byte, followed by the objects that
+        have been changed or created since it was opened, and a new
+        cross-reference section. Digital signatures of the original remain
+        valid, and saving a small change to a large file is fast.
+
+        Changed objects are found by comparing each object with the same
+        object in the original file, so the cost of a save grows with the
+        number of objects, not the size of the file. Stream data is not
+        compared; streams whose data was replaced with
+        :meth:`pikepdf.Stream.write`, or that were replaced by or swapped with
+        other objects, are written. New streams that have no
+        filter are compressed.
+
+        Args:
+            filename_or_stream: Where to write the original file and the
+                update. If omitted, and the file was opened with
+                ``allow_overwriting_input=True``, the update is appended to the
+                original file, which is much faster for large files, provided
+                it has not changed since it was opened. Each further call
+                appends the changes made since the previous one.
+
+        Returns:
+            The number of objects appended.
+
+        Raises:
+            ValueError: If the ``Pdf`` was not opened from a file, is
+                encrypted, or has token filters attached, or if the
+                original file has changed since it was opened.
+
+        .. note::
+
+            When a PDF is opened, pikepdf copies attributes that pages inherit
+            from the page tree onto the pages themselves, so that every page
+            dictionary counts as changed. Open the file with
+            ``inherit_page_attributes=False``, or ``lazy=True``, to keep the
+            update small.
+
+        .. versionadded:: 2.13
+        """
+        original = self._original_filename
+        if filename_or_stream is not None and not hasattr(
+            filename_or_stream, 'write'
+        ):
+            try:
+                same = samefile(filename_or_stream, original or self.filename)
+            except OSError:
+                same = False
+            if same and not original:
+                raise ValueError(
+                    "Cannot overwrite input file. Open the file with "
+                    "pikepdf.open(..., allow_overwriting_input=True) to "
+                    "allow saving to the input file incrementally."
+                )
+            if same:
+                filename_or_stream = None
+        if filename_or_stream is None:
+            if not original:
+                raise ValueError(
+                    "save_incremental() needs a destination, unless the file was "
+                    "opened with allow_overwriting_input=True"
+                )
+            with open(original, 'r+b') as stream:
+                return self._save_incremental(stream, append=True)
+        if hasattr(filename_or_stream, 'write'):
+            return self._save_incremental(filename_or_stream, append=False)
+        with open(filename_or_stream, 'wb') as stream:
+            return self._save_incremental(stream, append=False)
+
     @staticmethod
     def open(  # TODO mandatory kwargs
         filename_or_stream: Union[Path, str, BinaryIO],
@@ -830,6 +1239,7 @@ class Extend_Pdf:
         inherit_page_attributes: bool = True,
         access_mode: AccessMode = AccessMode.default,
         allow_overwriting_input: bool = False,
+        lazy: bool = False,
     ) -> Pdf:
         """
         Open an existing file at *filename_or_stream*.
@@ -890,8 +1300,12 @@ class Extend_Pdf:
                 set on a group of pages to individual pages
             access_mode: If ``.default``, pikepdf will
                 decide how to access the file. Currently, it will always
-                selected stream access. To attempt memory mapping and fallback
-                to stream if memory mapping failed, use ``.mmap``.  Use
+                select stream access. ``.fd`` reads the stream's underlying
+                file descriptor (from ``.fileno()``) directly, without calling
+                back into Python; it falls back to stream access if there is no
+                file descriptor. To attempt memory mapping and fallback
+                to file descriptor or stream access if memory mapping failed,
+                use ``.mmap``.  Use
                 ``.mmap_only`` to require memory mapping or fail
                 (this is expected to only be useful for testing). Applications
                 should be prepared to handle the SIGBUS signal on POSIX in
@@ -902,6 +1316,18 @@ class Extend_Pdf:
                 entire input file into memory at open time; this will use more
                 memory and may recent performance especially when the opened
                 file will not be modified.
+            lazy: If True, defer work at open time that is not needed to read
+                document-level information such as ``docinfo``. Currently this
+                defers ``inherit_page_attributes``: attributes are pushed down
+                to each page when it is first accessed through ``Pdf.pages``,
+                and to all remaining pages when the PDF is saved. Pages reached
+                other ways, such as through ``Root.Pages.Kids``, only have the
+                attributes that they set themselves until then. See
+                :attr:`Pdf.open_timings` for the time spent on each phase.
+
+        .. versionchanged:: 2.13
+            Added ``AccessMode.fd``. Added *lazy*.
+
         Raises:
             pikepdf.PasswordError: If the password failed to open the
                 file.
@@ -943,6 +1369,7 @@ class Extend_Pdf:
             attempt_recovery=attempt_recovery,
             inherit_page_attributes=inherit_page_attributes,
             access_mode=access_mode,
+            lazy=lazy,
         )
         setattr(pdf, '_tmp_stream', tmp_stream)
         setattr(pdf, '_original_filename', original_filename)
@@ -981,6 +1408,47 @@ def check_is_box(obj) -> bool:
     raise ValueError("object is not a rectangle")
 
 
+@augments(PageList)
+class Extend_PageList:
+    def analyze(
+        self, *, jobs: Optional[int] = None, collect: Optional[Iterable[str]] = None
+    ) -> List[PageAnalysis]:
+        """
+        Summarize the content of every page.
+
+        Content streams are decoded and tokenized in parallel on native
+        threads, without holding the GIL and without creating Python objects
+        for their contents, which is much faster than calling
+        :func:`pikepdf.parse_content_stream` for each page. Only the content
+        streams of the pages themselves are analyzed, not those of form
+        XObjects or annotations. Other threads must not access or modify this
+        ``Pdf`` until this method returns.
+
+        Args:
+            jobs: Number of threads to use. By default, one per CPU.
+            collect: Which summaries to collect, from ``'operators'``,
+                ``'resources'``, ``'images'`` and ``'text'``. By default, all
+                of them.
+
+        Returns:
+            One :class:`pikepdf.PageAnalysis` for each page, in page order.
+
+        .. versionadded:: 2.13
+        """
+        if jobs is None:
+            jobs = 0
+        elif jobs < 1:
+            raise ValueError("jobs must be at least 1")
+        if collect is None:
+            collect = PAGE_ANALYSES
+        elif isinstance(collect, str):
+            raise TypeError("collect must be an iterable of str, not a str")
+        return [
+            PageAnalysis(*summary)
+            for summary in _analyze_pages(self._pdf, list(collect), jobs)
+        ]
+
+
 @augments(Page)
 class Extend_Page:
     @property
@@ -2,13 +2,17 @@ from typing import (
     Tuple,
     Any,
     Collection,
+    Dict,
     Iterable,
     Iterator,
     List,
+    Mapping,
     Callable,
+    Sequence,
     Set,
     Union,
     TypeVar,
+    Optional,
     overload,
 )
 from enum import Enum
@@ -21,8 +25,14 @@ def _new_operator(op: str) -> Object: ...
 def _Null() -> Any: ...
 def _encode(handle: Any) -> Object: ...
 def _new_array(arg0: Iterable) -> Object: ...
+def _new_array_from_floats(values: Iterable, places: int = ...) -> Object: ...
 def _new_boolean(arg0: bool) -> Object: ...
 def _new_dictionary(arg0: dict) -> Object: ...
+def _new_dictionaries(
+    records: Iterable[Mapping[str, Any]],
+    template: Optional[Object] = ...,
+    owner: Optional[Pdf] = ...,
+) -> List[Object]: ...
 def _new_integer(arg0: int) -> Object: ...
 def _new_name(arg0: str) -> Object: ...
 @overload
@@ -31,20 +41,53 @@ def _new_real(arg0: str) -> Object: ...
 def _new_real(value: float, places: int = ...) -> Object: ...
 @overload
 def _new_real(*args, **kwargs) -> Any: ...
-def _new_stream(arg0: Pdf, arg1: bytes) -> Object: ...
+def _new_stream(arg0: Pdf, arg1: Any) -> Object: ...
 def _new_string(s: Union[str, bytes]) -> Object: ...
 def _new_string_utf8(s: str) -> Object: ...
+def _analyze_pages(
+    pdf: Pdf, collect: List[str], workers: int
+) -> List[Tuple[Any, ...]]: ...
+def _batch_process(
+    jobs: List[Tuple[bytes, bytes]],
+    edits: List[Tuple[str, str, str]],
+    password: str,
+    inherit_page_attributes: bool,
+    save_options: _BatchSaveOptions,
+    workers: int,
+) -> List[_BatchOutcome]: ...
+def _deduplicate(pdf: Pdf, workers: int) -> Tuple[int, int, int]: ...
+def _scan_annotations(pdf: Pdf, fields: List[str] = ...) -> Dict[str, Any]: ...
 def _test_file_not_found(*args, **kwargs) -> Any: ...
+def _verify(pdf: Pdf, workers: int) -> List[Tuple[int, int, int, str, str]]: ...
+def _xmp_simple_value(
+    data: bytes, namespace: str, name: str
+) -> Tuple[bool, Optional[str]]: ...
 def get_decimal_precision() -> int: ...
+def get_intern_scalars() -> bool: ...
+def get_real_as_float() -> bool: ...
+def get_repr_limits() -> Tuple[int, int, int]: ...
 def pdf_doc_to_utf8(pdfdoc: bytes) -> str: ...
+def pdf_doc_to_utf8_many(pdfdocs: Iterable[bytes]) -> List[str]: ...
 def qpdf_version() -> str: ...
+def register_stream_decoder(
+    filter: str, decoder: Optional[Callable[[bytes, Optional[Object]], bytes]]
+) -> None: ...
 def set_access_default_mmap(mmap: bool) -> bool: ...
 def set_decimal_precision(prec: int) -> int: ...
+def set_flate_compression_level(level: int) -> None: ...
+def set_intern_scalars(enabled: bool) -> bool: ...
+def set_real_as_float(enabled: bool) -> bool: ...
+def set_repr_limits(depth: int, items: int, length: int) -> Tuple[int, int, int]: ...
+def stream_decoders() -> List[str]: ...
 def unparse(obj: Any) -> bytes: ...
 def utf8_to_pdf_doc(utf8: str, unknown: bytes) -> Tuple[bool, bytes]: ...
+def utf8_to_pdf_doc_many(
+    strings: Iterable[str], unknown: bytes
+) -> List[Tuple[bool, bytes]]: ...
 
 class AccessMode(Enum):
     default: int = ...
+    fd: int = ...
     mmap: int = ...
     mmap_only: int = ...
     stream: int = ...
@@ -68,6 +111,26 @@ class Annotation:
     @property
     def subtype(self) -> str: ...
 
+class _BatchOutcome:
+    @property
+    def ok(self) -> bool: ...
+    def reraise(self) -> None: ...
+
+class _BatchSaveOptions:
+    static_id: bool
+    preserve_pdfa: bool
+    min_version: str
+    min_extension_level: int
+    force_version: str
+    force_extension_level: int
+    compress_streams: bool
+    stream_decode_level: Any
+    object_stream_mode: ObjectStreamMode
+    normalize_content: bool
+    linearize: bool
+    qdf: bool
+    recompress_flate: bool
+
 class Buffer:
     def __init__(self, *args, **kwargs) -> None: ...
 
@@ -89,12 +152,24 @@ class Object:
     def _parse_page_contents_grouped(
         self, whitelist: str
     ) -> List[Tuple[Collection[Union[Object, 'PdfInlineImage']], Operator]]: ...
+    def _parse_page_contents_lazy(
+        self, whitelist: str
+    ) -> ContentStreamInstructionList: ...
     def _parse_stream(self, *args, **kwargs) -> Any: ...
     def _parse_stream_grouped(self, *args, **kwargs) -> Any: ...
-    def _write(self, data: bytes, filter: object, decode_parms: object) -> None: ...
+    @staticmethod
+    def _parse_stream_lazy(
+        stream: Object, whitelist: str
+    ) -> ContentStreamInstructionList: ...
+    def _write(self, data: Any, filter: object, decode_parms: object) -> None: ...
     def append(self, pyitem: Object) -> None: ...
     def as_dict(self) -> _ObjectMapping: ...
+    def as_float_array(self) -> memoryview: ...
     def as_list(self) -> _ObjectList: ...
+    def content_hash(
+        self, *, stream_data: bool = ..., follow_indirect: bool = ...
+    ) -> bytes: ...
+    def deep_equal(self, other: Object, *, follow_indirect: bool = ...) -> bool: ...
     def extend(self, arg0: Iterable[Object]) -> None: ...
     @overload
     def get(self, key: str, default: object = ...) -> object: ...
@@ -114,7 +189,9 @@ class Object:
     @staticmethod
     def parse(stream: bytes, description: str = ...) -> Object: ...
     def read_bytes(self, decode_level: StreamDecodeLevel = ...) -> bytes: ...
+    def read_memoryview(self, decode_level: StreamDecodeLevel = ...) -> memoryview: ...
     def read_raw_bytes(self) -> bytes: ...
+    def read_raw_memoryview(self) -> memoryview: ...
     def same_owner_as(self, other: Object) -> bool: ...
     def to_json(self, dereference: bool = ...) -> bytes: ...
     def unparse(self, resolved: bool = ...) -> bytes: ...
@@ -216,7 +293,7 @@ class Page:
     def as_form_xobject(self, handle_transformations: bool = ...) -> Object: ...
     def contents_coalesce(self) -> None: ...
     def externalize_inline_images(self, min_size: int = ...) -> None: ...
-    def get_filtered_contents(self, tf: TokenFilter) -> bytes: ...
+    def get_filtered_contents(self, tf: _QPDFTokenFilter) -> bytes: ...
     def parse_contents(self, arg0: StreamParser) -> None: ...
     def remove_unreferenced_resources(self) -> None: ...
     def rotate(self, angle: int, relative: bool) -> None: ...
@@ -238,6 +315,7 @@ class Page:
     def trimbox(self, val: Any) -> None: ...
 
 class PageList:
+    _pdf: Pdf
     def __init__(self, *args, **kwargs) -> None: ...
     def append(self, page: object) -> None: ...
     @overload
@@ -273,6 +351,17 @@ class PageList:
 class PasswordError(Exception): ...
 class ForeignObjectError(Exception): ...
 
+class _OutlineIndex:
+    top: List[int]
+    reoccurred: Optional[Tuple[int, int]]
+    def __init__(self, pdf: Pdf, max_depth: int) -> None: ...
+    def children(self, node: int) -> List[int]: ...
+    def descendants(self, node: int) -> List[Tuple[int, int]]: ...
+    def is_clean(self, node: int) -> bool: ...
+    def is_closed(self, node: int) -> bool: ...
+    def object(self, node: int) -> Object: ...
+    def page_index(self, node: int) -> Optional[int]: ...
+
 class Pdf:
     _attach: Any = ...
     _repr_mimebundle_: Any = ...
@@ -292,7 +381,7 @@ class Pdf:
     def _decode_all_streams_and_discard(self) -> None: ...
     def _get_object_id(self, arg0: int, arg1: int) -> Object: ...
     def _open(self, *args, **kwargs) -> Any: ...
-    def _process(self, arg0: str, arg1: bytes) -> None: ...
+    def _process(self, arg0: str, arg1: Any) -> None: ...
     def _remove_page(self, arg0: Object) -> None: ...
     def _replace_object(self, arg0: Tuple[int, int], arg1: Object) -> None: ...
     def _save(
@@ -312,10 +401,19 @@ class Pdf:
         progress: object = ...,
         encryption: object = ...,
         samefile_check: bool = ...,
-    ) -> None: ...
+        recompress_flate: bool = ...,
+        chunk_callback: object = ...,
+        chunk_size: int = ...,
+        hasher: object = ...,
+    ) -> Optional[int]: ...
+    def _save_incremental(self, stream: Any, append: bool) -> int: ...
     def _swap_objects(self, arg0: Tuple[int, int], arg1: Tuple[int, int]) -> None: ...
     def check_linearization(self, stream: object = ...) -> bool: ...
     def copy_foreign(self, h: Object) -> Object: ...
+    def copy_foreign_many(self, objects: Iterable[Object]) -> List[Object]: ...
+    def import_pages(
+        self, sources: Iterable[Any], *, deduplicate_streams: bool = ...
+    ) -> None: ...
     @overload
     def get_object(self, objgen: Tuple[int, int]) -> Object: ...
     @overload
@@ -323,6 +421,20 @@ class Pdf:
     @overload
     def get_object(*args, **kwargs) -> Any: ...
     def get_warnings(self) -> list: ...
+    def flatten_annotations(
+        self, mode: str = ..., annotations: Optional[Iterable[Any]] = ...
+    ) -> None: ...
+    def generate_appearance_streams(
+        self, annotations: Optional[Iterable[Any]] = ...
+    ) -> None: ...
+    def iter_objects(
+        self,
+        *,
+        type_code: Optional[ObjectType] = ...,
+        type: Optional[Union[Object, str]] = ...,
+        subtype: Optional[Union[Object, str]] = ...,
+        stream: Optional[bool] = ...,
+    ) -> _ObjectIterator: ...
     @overload
     def make_indirect(self, h: T) -> T: ...
     @overload
@@ -330,6 +442,7 @@ class Pdf:
     def new(self, *args, **kwargs) -> Any: ...
     def remove_unreferenced_resources(self) -> None: ...
     def show_xref_table(self) -> None: ...
+    def stats(self) -> Dict[str, Any]: ...
     @property
     def Root(self) -> Object: ...
     @property
@@ -373,6 +486,8 @@ class Pdf:
     @property
     def objects(self) -> Any: ...
     @property
+    def open_timings(self) -> Dict[str, float]: ...
+    @property
     def pages(self) -> PageList: ...
     @property
     def pdf_version(self) -> str: ...
@@ -394,6 +509,23 @@ class StreamParser:
     def handle_eof(self) -> None: ...
     def handle_object(self, arg0: Object) -> None: ...
 
+class NativeTokenFilter(_QPDFTokenFilter):
+    @staticmethod
+    def strip_operators(operators: Iterable[str]) -> NativeTokenFilter: ...
+    @staticmethod
+    def drop_text() -> NativeTokenFilter: ...
+    @staticmethod
+    def remap_resource_names(
+        mapping: Mapping[Union[Object, str], Union[Object, str]]
+    ) -> NativeTokenFilter: ...
+    @staticmethod
+    def replace_color(
+        old: Sequence[float], new: Sequence[float]
+    ) -> NativeTokenFilter: ...
+    @staticmethod
+    def chain(filters: Sequence[NativeTokenFilter]) -> NativeTokenFilter: ...
+    def __or__(self, other: NativeTokenFilter) -> NativeTokenFilter: ...
+
 class Token:
     def __init__(self, arg0: TokenType, arg1: bytes) -> None: ...
     def __eq__(self, other: Any) -> bool: ...
@@ -430,6 +562,25 @@ class TokenType(Enum):
     string: Any = ...
     word: Any = ...
 
+class ContentStreamInstructionList:
+    def __len__(self) -> int: ...
+    @overload
+    def __getitem__(
+        self, index: int
+    ) -> Tuple[List[Union[Object, 'PdfInlineImage']], Operator]: ...
+    @overload
+    def __getitem__(
+        self, index: slice
+    ) -> List[Tuple[List[Union[Object, 'PdfInlineImage']], Operator]]: ...
+    def __iter__(
+        self,
+    ) -> Iterator[Tuple[List[Union[Object, 'PdfInlineImage']], Operator]]: ...
+    def operator_name(self, index: int) -> str: ...
+
+class _ObjectIterator:
+    def __iter__(self) -> _ObjectIterator: ...
+    def __next__(self) -> Object: ...
+
 class _ObjectList:
     @overload
     def __init__(self) -> None: ...
@@ -7,7 +7,12 @@
 import codecs
 from typing import Optional, Tuple
 
-from ._qpdf import pdf_doc_to_utf8, utf8_to_pdf_doc
+from ._qpdf import (
+    pdf_doc_to_utf8,
+    pdf_doc_to_utf8_many,
+    utf8_to_pdf_doc,
+    utf8_to_pdf_doc_many,
+)
 
 # pylint: disable=redefined-builtin
 
@@ -61,4 +66,9 @@ def find_pdfdoc(encoding: str) -> Optional[codecs.CodecInfo]:
 
 codecs.register(find_pdfdoc)
 
-__all__ = ['utf8_to_pdf_doc', 'pdf_doc_to_utf8']
+__all__ = [
+    'utf8_to_pdf_doc',
+    'pdf_doc_to_utf8',
+    'utf8_to_pdf_doc_many',
+    'pdf_doc_to_utf8_many',
+]
@@ -4,7 +4,7 @@
 #
 # Copyright (C) 2017, James R. Barlow (https://github.com/jbarlow83/)
 
-from typing import Collection, List, Tuple, Union, cast
+from typing import Collection, List, Sequence, Tuple, Union, cast
 
 from pikepdf import Object, ObjectType, Operator, PdfError, _qpdf
 
@@ -34,8 +34,8 @@ class PdfParsingError(Exception):
 
 
 def parse_content_stream(
-    page_or_stream: Object, operators: str = ''
-) -> List[ContentStreamInstructions]:
+    page_or_stream: Object, operators: str = '', *, lazy: bool = False
+) -> Sequence[ContentStreamInstructions]:
     """
     Parse a PDF content stream into a sequence of instructions.
 
@@ -60,12 +60,22 @@ def parse_content_stream(
             that pertain to drawing images. Use 'BI ID EI' for inline images.
             All other operators and associated tokens are ignored. If blank,
             all tokens are accepted.
+        lazy: If ``True``, return a
+            :class:`pikepdf._qpdf.ContentStreamInstructionList` instead of a
+            list. The instructions are held in native form, and the Python
+            objects for an instruction are only created when it is accessed.
+            This is much faster and uses less memory when only some of the
+            instructions of a large content stream are examined. The result
+            supports ``len()``, indexing (including slices) and iteration.
 
     Returns:
         list: List of ``(operands, command)`` tuples where ``command`` is an
             operator (str) and ``operands`` is a tuple of str; the PDF drawing
             command and the command's operands, respectively.
 
+    .. versionchanged:: 2.13
+        Added the ``lazy`` argument.
+
     Example:
 
         >>> pdf = pikepdf.Pdf.open(input_pdf)
@@ -87,15 +97,21 @@ def parse_content_stream(
     try:
         if page_or_stream.get('/Type') == '/Page':
             page = page_or_stream
+            if lazy:
+                parse = page._parse_page_contents_lazy
+            else:
+                parse = page._parse_page_contents_grouped
             instructions = cast(
-                List[ContentStreamInstructions],
-                page._parse_page_contents_grouped(operators),
+                Sequence[ContentStreamInstructions], parse(operators)
             )
         else:
             stream = page_or_stream
+            if lazy:
+                parse = Object._parse_stream_lazy
+            else:
+                parse = Object._parse_stream_grouped
             instructions = cast(
-                List[ContentStreamInstructions],
-                Object._parse_stream_grouped(stream, operators),
+                Sequence[ContentStreamInstructions], parse(stream, operators)
             )
     except PdfError as e:
         if 'supposed to be a stream or an array' in str(e):
@@ -4,7 +4,6 @@
 #
 # Copyright (C) 2017, James R. Barlow (https://github.com/jbarlow83/)
 
-import struct
 from abc import ABC, abstractmethod
 from decimal import Decimal
 from io import BytesIO
@@ -15,7 +14,6 @@ from zlib import decompress
 from zlib import error as ZlibError
 
 from PIL import Image, ImageCms
-from PIL.TiffTags import TAGS_V2 as TIFF_TAGS
 
 from pikepdf import (
     Array,
@@ -27,6 +25,7 @@ from pikepdf import (
     StreamDecodeLevel,
     String,
     jbig2,
+    _qpdf,
 )
 
 
@@ -401,6 +400,23 @@ class PdfImage(PdfImageBase):
             stream: Writable stream to write data to
         """
 
+        data, filters = self._unstack_compression(
+            self.obj.get_raw_stream_buffer(), self.filters
+        )
+
+        if filters == ['/CCITTFaxDecode']:
+            stream.write(self._generate_ccitt_header(data, icc=self._ccitt_icc()))
+            stream.write(data)
+            return '.tif'
+        elif filters == ['/DCTDecode'] and self._dct_extractable():
+            stream.write(data)
+            return '.jpg'
+
+        raise NotExtractableError()
+
+    def _dct_extractable(self):
+        """``True`` if this image's JPEG data can be saved as a JPEG file"""
+
         def normal_dct_rgb():
             # Normal DCTDecode RGB images have the default value of
             # /ColorTransform 1 and are actually in YUV. Such a file can be
@@ -418,25 +434,67 @@ class PdfImage(PdfImageBase):
             ct = self.filter_decodeparms[0][1].get('/ColorTransform', DEFAULT_CT_CMYK)
             return self.mode == 'CMYK' and ct == DEFAULT_CT_CMYK
 
-        data, filters = self._unstack_compression(
-            self.obj.get_raw_stream_buffer(), self.filters
-        )
+        return self.mode == 'L' or normal_dct_rgb() or normal_dct_cmyk()
 
-        if filters == ['/CCITTFaxDecode']:
-            if self.colorspace == '/ICCBased':
-                icc = self._iccstream.read_bytes()
-            else:
-                icc = None
-            stream.write(self._generate_ccitt_header(data, icc=icc))
-            stream.write(data)
-            return '.tif'
-        elif filters == ['/DCTDecode'] and (
-            self.mode == 'L' or normal_dct_rgb() or normal_dct_cmyk()
-        ):
-            stream.write(data)
-            return '.jpg'
+    def _ccitt_icc(self):
+        if self.colorspace == '/ICCBased':
+            return self._iccstream.read_bytes()
+        return None
 
-        raise NotExtractableError()
+    def _extract_plan(self):
+        """Describe how :meth:`extract_many` can extract this image natively
+
+        The result gives the native code everything it needs to produce
+        the same file format as :meth:`extract_to`, or is ``None`` if the
+        image must be extracted in Python, in which case :meth:`extract_to`
+        also reports any problem with the image.
+        """
+        plan = dict(stream=self.obj, width=self.width, height=self.height)
+        unstack = 0
+        filters = self.filters
+        while len(filters) - unstack > 1 and filters[unstack] == '/FlateDecode':
+            unstack += 1
+        try:
+            if filters[unstack:] == ['/CCITTFaxDecode']:
+                k, black_is_one = self._ccitt_parameters()
+                icc = self._ccitt_icc()
+                return dict(
+                    plan,
+                    format='.tif',
+                    unstack=unstack,
+                    k=k,
+                    black_is_1=black_is_one,
+                    icc=icc,
+                )
+            if filters[unstack:] == ['/DCTDecode'] and self._dct_extractable():
+                return dict(plan, format='.jpg', unstack=unstack)
+
+            # As _extract_transcoded does, but only for what PNG can hold
+            # without help from Pillow
+            if filters and filters[0] == '/JBIG2Decode':
+                return None
+            mode, palette, bpc = self.mode, None, self.bits_per_component
+            if mode == 'RGB' and bpc == 8:
+                pass
+            elif mode == 'L' and bpc == 8:
+                pass
+            elif mode == 'P' and bpc == 8:
+                palette = self.palette
+                if palette[0] not in ('RGB', 'L'):
+                    return None
+            elif bpc == 1:
+                if mode == 'P' and self.palette not in (
+                    ('RGB', b'\x00\x00\x00\xff\xff\xff'),
+                    ('L', b'\x00\xff'),
+                ):
+                    return None
+                mode = '1'
+            else:
+                return None
+            icc = self.icc.tobytes() if self.colorspace == '/ICCBased' else None
+            return dict(plan, format='.png', mode=mode, palette=palette, icc=icc)
+        except Exception:  # pylint: disable=broad-except
+            return None
 
     def _extract_transcoded(self):
         im = None
@@ -457,7 +515,14 @@ class PdfImage(PdfImageBase):
                 else:
                     raise NotImplementedError('palette with ' + base_mode)
         elif self.bits_per_component == 1:
-            if self.filters and self.filters[0] == '/JBIG2Decode':
+            if (
+                self.filters == ['/JBIG2Decode']
+                and '/JBIG2Decode' in _qpdf.stream_decoders()
+            ):
+                # Decoded in-process, by a native decoder
+                data = self.read_bytes()
+                im = Image.frombytes('1', self.size, data)
+            elif self.filters and self.filters[0] == '/JBIG2Decode':
                 if not jbig2.jbig2dec_available():
                     raise DependencyError(
                         "jbig2dec - not installed or installed version is too old "
@@ -580,6 +645,83 @@ class PdfImage(PdfImageBase):
         """Access this image with the buffer protocol"""
         return self.obj.get_stream_buffer(decode_level=decode_level)
 
+    @property
+    def stride(self):
+        """Number of bytes in each row of the decoded image data
+
+        .. versionadded:: 2.13
+        """
+        channels = {'1': 1, 'L': 1, 'P': 1, 'RGB': 3, 'CMYK': 4}[self.mode]
+        return (self.width * channels * self.bits_per_component + 7) // 8
+
+    def read_into(self, buffer, decode_level=StreamDecodeLevel.specialized):
+        """Decompress this image directly into a writable buffer
+
+        The buffer may be a ``bytearray``, a NumPy array or anything else
+        that is writable and C-contiguous, such as one allocated once and
+        reused for many images. The decoded data is ``stride * height``
+        bytes in the layout described by :attr:`mode`, :attr:`stride` and
+        :attr:`size`. The GIL is released while decoding.
+
+        Returns:
+            int: The number of bytes written.
+
+        Raises:
+            ValueError: The buffer is too small or the image cannot be
+                decoded at this decode level.
+
+        .. versionadded:: 2.13
+        """
+        return _qpdf._read_stream_into(self.obj, buffer, decode_level)
+
+    @staticmethod
+    def extract_many(images, *, jobs=None):
+        """Extract many images at once, as :meth:`extract_to` would
+
+        Where possible, images are extracted by native code on several
+        threads with the GIL released: the raw data of each image is read,
+        stacked compression is undone, and JPEG data is returned as it is,
+        CCITT data is given a TIFF header, and other images are decoded and
+        written as PNG. The rest are extracted one at a time by
+        :meth:`extract_to`. PNG files written natively hold the same pixels
+        as those written by Pillow, but are not byte-for-byte identical.
+
+        Args:
+            images: An iterable of :class:`PdfImage` or image XObjects.
+            jobs (int): Number of threads to use. By default, one per CPU.
+
+        Returns:
+            list: A ``(extension, data)`` tuple for each image, in order, where
+            *extension* is as returned by :meth:`extract_to`.
+
+        .. versionadded:: 2.13
+        """
+        if jobs is None:
+            jobs = 0
+        elif jobs < 1:
+            raise ValueError("jobs must be at least 1")
+        pims = [im if isinstance(im, PdfImageBase) else PdfImage(im) for im in images]
+        plans = [
+            pim._extract_plan()
+            if isinstance(pim, PdfImage) and not isinstance(pim, PdfJpxImage)
+            else None
+            for pim in pims
+        ]
+        extracted = iter(
+            _qpdf._extract_images([plan for plan in plans if plan], jobs)
+        )
+
+        results = []
+        for pim, plan in zip(pims, plans):
+            data = next(extracted) if plan else None
+            if data is not None:
+                results.append((plan['format'], data))
+                continue
+            bio = BytesIO()
+            extension = pim.extract_to(stream=bio)
+            results.append((extension, bio.getvalue()))
+        return results
+
     def as_pil_image(self):
         """Extract the image as a Pillow Image, using decompression as necessary
 
@@ -600,11 +742,8 @@ class PdfImage(PdfImageBase):
 
         return im
 
-    def _generate_ccitt_header(self, data, icc=None):
-        """Construct a CCITT G3 or G4 header from the PDF metadata"""
-        # https://stackoverflow.com/questions/2641770/
-        # https://www.itu.int/itudoc/itu-t/com16/tiff-fx/docs/tiff6.pdf
-
+    def _ccitt_parameters(self):
+        """Return the CCITT K parameter and whether black is 1"""
         if not self.decode_parms:
             raise ValueError("/CCITTFaxDecode without /DecodeParms")
 
@@ -614,75 +753,18 @@ class PdfImage(PdfImageBase):
             )
 
         k = self.decode_parms[0].get("/K", 0)
-        if k < 0:
-            ccitt_group = 4  # Pure two-dimensional encoding (Group 4)
-        elif k > 0:
-            ccitt_group = 3  # Group 3 2-D
-        else:
-            ccitt_group = 2  # CCITT 1-D
         black_is_one = self.decode_parms[0].get("/BlackIs1", False)
-        # TIFF spec says:
-        # use 0 for white_is_zero (=> black is 1)
-        # use 1 for black_is_zero (=> white is 1)
-        # In practice, do the opposite of what the TIFF spec says.
-        photometry = 1 if black_is_one else 0
-
-        img_size = len(data)
-        tiff_header_struct = '<' + '2s' + 'H' + 'L' + 'H'
-
-        tag_keys = {tag.name: key for key, tag in TIFF_TAGS.items()}
-        ifd_struct = '<HHLL'
-
-        if icc is None:
-            icc = b''
+        return int(k), bool(black_is_one)
 
-        ifds = []
-
-        def header_length(ifd_count):
-            return (
-                struct.calcsize(tiff_header_struct)
-                + struct.calcsize(ifd_struct) * ifd_count
-                + 4
-            )
-
-        def add_ifd(tag_name, data, count=1):
-            key = tag_keys[tag_name]
-            typecode = TIFF_TAGS[key].type
-            ifds.append((key, typecode, count, data))
-
-        image_offset = None
-        add_ifd('ImageWidth', self.width)
-        add_ifd('ImageLength', self.height)
-        add_ifd('BitsPerSample', 1)
-        add_ifd('Compression', ccitt_group)
-        add_ifd('PhotometricInterpretation', int(photometry))
-        add_ifd('StripOffsets', lambda: image_offset)
-        add_ifd('RowsPerStrip', self.height)
-        add_ifd('StripByteCounts', img_size)
-
-        icc_offset = 0
-        if icc:
-            add_ifd('ICCProfile', lambda: icc_offset, count=len(icc))
-
-        icc_offset = header_length(len(ifds))
-        image_offset = icc_offset + len(icc)
-
-        ifd_args = [(arg() if callable(arg) else arg) for ifd in ifds for arg in ifd]
-        tiff_header = struct.pack(
-            (tiff_header_struct + ifd_struct[1:] * len(ifds) + 'L'),
-            b'II',  # Byte order indication: Little endian
-            42,  # Version number (always 42)
-            8,  # Offset to first IFD
-            len(ifds),  # Number of tags in IFD
-            *ifd_args,
-            0,  # Last IFD
+    def _generate_ccitt_header(self, data, icc=None):
+        """Construct a CCITT G3 or G4 header from the PDF metadata"""
+        # https://stackoverflow.com/questions/2641770/
+        # https://www.itu.int/itudoc/itu-t/com16/tiff-fx/docs/tiff6.pdf
+        k, black_is_one = self._ccitt_parameters()
+        return _qpdf._ccitt_tiff_header(
+            self.width, self.height, k, black_is_one, len(data), icc or b''
         )
 
-        if icc:
-            tiff_header += icc
-
-        return tiff_header
-
     def show(self):
         """Show the image however PIL wants to"""
         self.as_pil_image().show()
@@ -6,6 +6,8 @@
 
 from math import cos, pi, sin
 
+from .. import Array
+
 
 class PdfMatrix:
     """
@@ -42,6 +44,11 @@ class PdfMatrix:
                            (e, f, 1))
         elif isinstance(args[0], PdfMatrix):
             self.values = args[0].values
+        elif isinstance(args[0], Array) and len(args[0]) == 6:
+            a, b, c, d, e, f = args[0].as_float_array()
+            self.values = ((a, b, 0),
+                           (c, d, 0),
+                           (e, f, 1))
         elif len(args[0]) == 6:
             a, b, c, d, e, f = map(float, args[0])
             self.values = ((a, b, 0),
@@ -20,6 +20,7 @@ from typing import (
     NamedTuple,
     Optional,
     Set,
+    Tuple,
     Type,
     Union,
 )
@@ -30,6 +31,7 @@ from lxml.etree import QName, XMLSyntaxError
 
 from .. import Name, Stream, String
 from .. import __version__ as pikepdf_version
+from .._qpdf import _xmp_simple_value
 from .._xml import parse_xml
 
 if sys.version_info < (3, 9):  # pragma: no cover
@@ -409,6 +411,24 @@ class PdfMetadata(MutableMapping):
             data = XMP_EMPTY
         self._load_from(data)
 
+    def _peek(self, key: Union[str, QName]) -> Tuple[bool, Optional[str]]:
+        """Look up a simple property in the stored XMP without parsing it
+
+        Returns ``(True, value)`` if the property could be read this way, where
+        value is ``None`` if the property is absent, or ``(False, None)`` if the
+        XMP must be parsed to answer.
+        """
+        if self._xmp is not None or not self.overwrite_invalid_xml:
+            return False, None
+        uri, _, name = self._qname(key).partition('}')
+        if not name:
+            return False, None
+        try:
+            data = self._pdf.Root.Metadata.read_bytes()
+        except AttributeError:
+            return True, None
+        return _xmp_simple_value(data, uri[1:], name)
+
     def _load_from(self, data: bytes) -> None:
         if data.strip() == b'':
             data = XMP_EMPTY  # on some platforms lxml chokes on empty documents
@@ -650,12 +670,22 @@ class PdfMetadata(MutableMapping):
     def _get_element_values(self, name=''):
         yield from (v[2] for v in self._get_elements(name))
 
-    @ensure_loaded
     def __contains__(self, key: Union[str, QName]):
+        simple, value = self._peek(key)
+        if simple:
+            return bool(value)
+        if not self._xmp:
+            self._load()
         return any(self._get_element_values(key))
 
-    @ensure_loaded
     def __getitem__(self, key: Union[str, QName]):
+        simple, value = self._peek(key)
+        if simple:
+            if value is None:
+                raise KeyError(key)
+            return value
+        if not self._xmp:
+            self._load()
         try:
             return next(self._get_element_values(key))
         except StopIteration:
@@ -795,7 +825,6 @@ class PdfMetadata(MutableMapping):
             raise KeyError(key) from None
 
     @property
-    @ensure_loaded
     def pdfa_status(self) -> str:
         """Returns the PDF/A conformance level claimed by this PDF, or False
 
@@ -816,7 +845,6 @@ class PdfMetadata(MutableMapping):
             return ''
 
     @property
-    @ensure_loaded
     def pdfx_status(self) -> str:
         """Returns the PDF/X conformance level claimed by this PDF, or False
 
@@ -11,6 +11,7 @@ from itertools import chain
 from typing import Iterable, List, Optional, Set, Tuple, Union, cast
 
 from pikepdf import Array, Dictionary, Name, Object, Page, Pdf
+from pikepdf._qpdf import _OutlineIndex
 
 
 class PageLocation(Enum):
@@ -128,6 +129,9 @@ class OutlineItem:
 
     This object does not contain any information about higher-level or
     neighboring elements.
+
+    When read from a document, the ``children`` of an item are only created
+    when they are first accessed.
     """
 
     def __init__(
@@ -153,7 +157,46 @@ class OutlineItem:
         kwargs = dict(left=left, top=top, right=right, bottom=bottom, zoom=zoom)
         self.page_location_kwargs = {k: v for k, v in kwargs.items() if v is not None}
         self.is_closed = False
-        self.children: Iterable[OutlineItem] = []
+        self._children: Optional[List[OutlineItem]] = []
+        # Where this item was read from, if it was read from a document
+        self._index: Optional[_OutlineIndex] = None
+        self._node = -1
+        self._loaded: Tuple[object, object] = (None, None)
+        self._loaded_page_index: Optional[int] = None
+
+    @property
+    def children(self) -> List['OutlineItem']:
+        """The items nested below this one."""
+        if self._children is None:
+            assert self._index is not None
+            index = self._index
+            self._children = [
+                OutlineItem._from_index(index, child)
+                for child in index.children(self._node)
+            ]
+        return self._children
+
+    @children.setter
+    def children(self, value: List['OutlineItem']):
+        self._children = value
+
+    @property
+    def page_index(self) -> Optional[int]:
+        """The index of the page this item's destination refers to, if known.
+
+        For items read from a document, this was found when the outline was
+        read, including for named destinations and ``/GoTo`` actions. It is
+        ``None`` if the destination is not a page of the document, or if the
+        destination or action has been replaced since.
+
+        .. versionadded:: 2.13
+        """
+        if isinstance(self.destination, int):
+            return self.destination
+        destination, action = self._loaded
+        if self.destination is destination and self.action is action:
+            return self._loaded_page_index
+        return None
 
     def __str__(self):
         if self.children:
@@ -187,6 +230,30 @@ class OutlineItem:
         action = obj.get(Name.A)
         return cls(title, destination=destination, action=action, obj=obj)
 
+    @classmethod
+    def _from_index(cls, index: _OutlineIndex, node: int) -> 'OutlineItem':
+        item = cls.from_dictionary_object(index.object(node))
+        item.is_closed = index.is_closed(node)
+        item._children = None
+        item._index = index
+        item._node = node
+        item._loaded = (item.destination, item.action)
+        item._loaded_page_index = index.page_index(node)
+        return item
+
+    def _subtree_unchanged(self) -> bool:
+        """True if the items below this one were never accessed, and are
+        already written in the document as :class:`Outline` would write them.
+        """
+        if self._children is not None or self._index is None:
+            return False
+        original = self._index.object(self._node)
+        return (
+            self.obj is not None
+            and self.obj.objgen == original.objgen
+            and self._index.is_clean(self._node)
+        )
+
     def to_dictionary_object(self, pdf: Pdf, create_new: bool = False) -> Dictionary:
         """Creates a ``Dictionary`` object from this outline node's data,
         or updates the existing object.
@@ -295,6 +362,19 @@ class Outline:
                 if Name.Prev in out_obj:
                     del out_obj.Prev
             prev = out_obj
+            if level < self._max_depth and item._subtree_unchanged():
+                # Leave the subtree as it is, since writing it again would
+                # not change it
+                descendants = item._index.descendants(item._node)
+                if visited_objs.isdisjoint(descendants):
+                    visited_objs.update(descendants)
+                    sub_count = abs(int(out_obj.get(Name.Count, 0)))
+                    if item.is_closed:
+                        out_obj.Count = -sub_count
+                    else:
+                        out_obj.Count = sub_count
+                        count += sub_count
+                    continue
             if level < self._max_depth:
                 sub_items = item.children
             else:
@@ -317,36 +397,6 @@ class Outline:
                 del parent.Last
         parent.Count = count
 
-    def _load_level_outline(
-        self,
-        first_obj: Dictionary,
-        outline_items: List[Object],
-        level: int,
-        visited_objs: Set[Tuple[int, int]],
-    ):
-        current_obj = first_obj
-        while current_obj:
-            objgen = current_obj.objgen
-            if objgen in visited_objs:
-                if self._strict:
-                    raise OutlineStructureError(
-                        f"Outline object {objgen} reoccurred in structure"
-                    )
-                return
-            visited_objs.add(objgen)
-
-            item = OutlineItem.from_dictionary_object(current_obj)
-            first_child = current_obj.get(Name.First)
-            if first_child is not None and level < self._max_depth:
-                self._load_level_outline(
-                    first_child, item.children, level + 1, visited_objs
-                )
-                count = current_obj.get(Name.Count)
-                if count and count < 0:
-                    item.is_closed = True
-            outline_items.append(item)
-            current_obj = current_obj.get(Name.Next)
-
     def _save(self):
         if self._root is None:
             return
@@ -359,13 +409,15 @@ class Outline:
         self._save_level_outline(outlines, self._root, 0, set())
 
     def _load(self):
-        self._root = root = []
-        if Name.Outlines not in self._pdf.Root:
-            return
-        outlines = self._pdf.Root.Outlines or {}
-        first_obj = outlines.get(Name.First)
-        if first_obj:
-            self._load_level_outline(first_obj, root, 0, set())
+        # The whole tree is read in one pass, but items are only created for
+        # the top level here; the rest are created as they are accessed.
+        index = _OutlineIndex(self._pdf, self._max_depth)
+        objgen = index.reoccurred
+        if objgen is not None and self._strict:
+            raise OutlineStructureError(
+                f"Outline object {objgen} reoccurred in structure"
+            )
+        self._root = [OutlineItem._from_index(index, node) for node in index.top]
 
     @property
     def root(self) -> List[OutlineItem]:
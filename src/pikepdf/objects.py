@@ -22,7 +22,7 @@ class definition is present as an aide for code introspection.
 # pylint: disable=unused-import, abstract-method
 
 from secrets import token_urlsafe
-from typing import TYPE_CHECKING, Iterable, Optional, Union
+from typing import TYPE_CHECKING, Any, Iterable, List, Mapping, Optional, Union
 from warnings import warn
 
 from . import _qpdf
@@ -185,6 +185,26 @@ class Array(Object, metaclass=_ObjectMeta):
             return a.__copy__()
         return _qpdf._new_array(a)
 
+    @staticmethod
+    def from_floats(values: Iterable, places: int = 0) -> 'Array':
+        """
+        Constructs a PDF Array of real numbers.
+
+        This is faster than constructing an Array from a list of floats,
+        especially when ``values`` supports the buffer protocol with format
+        ``'d'`` (such as a NumPy ``float64`` array, ``array.array('d')``, or
+        the result of :meth:`pikepdf.Object.as_float_array`), since the values
+        are read directly from the buffer.
+
+        Args:
+            values: A buffer of doubles or an iterable of numbers.
+            places: Number of decimal places to write. If 0, qpdf's default
+                is used, as when a ``float`` is assigned to a PDF object.
+
+        .. versionadded:: 2.13
+        """
+        return _qpdf._new_array_from_floats(values, places)
+
 
 class Dictionary(Object, metaclass=_ObjectMeta):
     """Constructs a PDF Dictionary object"""
@@ -226,6 +246,40 @@ class Dictionary(Object, metaclass=_ObjectMeta):
             raise KeyError("Dictionary created from strings must begin with '/'")
         return _qpdf._new_dictionary(d)
 
+    @staticmethod
+    def from_records(
+        records: Iterable[Mapping[str, Any]],
+        *,
+        template: Optional['Dictionary'] = None,
+        owner: Optional['Pdf'] = None,
+    ) -> List['Dictionary']:
+        """
+        Constructs many PDF Dictionaries at once.
+
+        This is much faster than constructing each Dictionary separately, for
+        example to create many annotations. Values of the types that records
+        usually contain are converted without the general-purpose type checks,
+        and keys that recur from record to record are converted once.
+
+        Args:
+            records: Mappings from keys, which must begin with ``'/'``, to
+                values that can be converted to PDF objects, as for the
+                Dictionary constructor.
+            template: A Dictionary whose keys and values each new Dictionary
+                starts with, before the record's own are added. Giving a key
+                the value ``None`` in a record removes it.
+            owner: If given, each new Dictionary is made an indirect object
+                of this Pdf.
+
+        Returns:
+            The new Dictionaries, in the order of the records.
+
+        .. versionadded:: 2.13
+        """
+        if template is not None and not isinstance(template, Dictionary):
+            raise TypeError("template must be a pikepdf.Dictionary")
+        return _qpdf._new_dictionaries(records, template, owner)
+
 
 class Stream(Object, metaclass=_ObjectMeta):
     """Constructs a PDF Stream object"""
@@ -246,7 +300,9 @@ class Stream(Object, metaclass=_ObjectMeta):
 
         Args:
             owner: The Pdf to which this stream shall be attached.
-            data: The data bytes for the stream.
+            data: The data bytes for the stream. As for
+                :meth:`pikepdf.Stream.write`, this may be any C-contiguous
+                buffer, and read-only buffers are not copied.
             d: An optional mapping object that will be used to construct the stream's
                 dictionary.
             kwargs: Keyword arguments that will define the stream dictionary. Do not set
@@ -0,0 +1,34 @@
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+
+"""Global settings that affect all of pikepdf.
+
+These settings apply to the whole process, in all threads.
+"""
+
+from ._qpdf import (
+    get_decimal_precision,
+    get_intern_scalars,
+    get_real_as_float,
+    get_repr_limits,
+    set_decimal_precision,
+    set_flate_compression_level,
+    set_intern_scalars,
+    set_real_as_float,
+    set_repr_limits,
+)
+
+__all__ = [
+    'get_decimal_precision',
+    'get_intern_scalars',
+    'get_real_as_float',
+    'get_repr_limits',
+    'set_decimal_precision',
+    'set_flate_compression_level',
+    'set_intern_scalars',
+    'set_real_as_float',
+    'set_repr_limits',
+]
@@ -6,7 +6,14 @@
  * Copyright (C) 2019, James R. Barlow (https://github.com/jbarlow83/)
  */
 
-
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <qpdf/Constants.h>
 #include <qpdf/Types.h>
@@ -14,12 +21,274 @@
 #include <qpdf/QPDFExc.hh>
 #include <qpdf/PointerHolder.hh>
 #include <qpdf/QPDFAnnotationObjectHelper.hh>
+#include <qpdf/QPDFAcroFormDocumentHelper.hh>
+#include <qpdf/QPDFFormFieldObjectHelper.hh>
+#include <qpdf/QPDFPageDocumentHelper.hh>
+#include <qpdf/QPDFPageObjectHelper.hh>
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 #include "pikepdf.h"
 
+static const std::vector<std::string> scan_fields = {"page", "objgen", "subtype",
+    "flags", "rect", "appearance_state", "field_name"};
+
+// Read the annotations of every page, writing the requested fields into
+// one column each.
+static py::dict scan_annotations(QPDF &q, std::vector<std::string> fields)
+{
+    std::set<std::string> wanted;
+    for (auto const &field : fields) {
+        if (std::find(scan_fields.begin(), scan_fields.end(), field) == scan_fields.end())
+            throw py::value_error("unknown annotation field: " + field);
+        wanted.insert(field);
+    }
+    auto want = [&wanted](const char *field) { return wanted.count(field) > 0; };
+
+    py::list pages, objgens, subtypes, flags, states, field_names;
+    FloatArray rects;
+    std::unique_ptr<QPDFAcroFormDocumentHelper> afdh;
+    if (want("field_name"))
+        afdh = std::make_unique<QPDFAcroFormDocumentHelper>(q);
+
+    // Names are repeated a great deal, so each is converted once
+    std::map<std::string, py::object> names;
+    auto name_value = [&names](QPDFObjectHandle h) -> py::object {
+        if (!h.isName())
+            return py::none();
+        auto &found = names[h.getName()];
+        if (!found)
+            found = py::str(h.getName());
+        return found;
+    };
+
+    auto all_pages = q.getAllPages();
+    for (size_t page_index = 0; page_index < all_pages.size(); ++page_index) {
+        auto annots = all_pages[page_index].getKey("/Annots");
+        if (!annots.isArray())
+            continue;
+        int n = annots.getArrayNItems();
+        for (int i = 0; i < n; ++i) {
+            auto annot = annots.getArrayItem(i);
+            if (!annot.isDictionary())
+                continue;
+            if (want("page"))
+                pages.append(page_index);
+            if (want("objgen"))
+                objgens.append(py::make_tuple(annot.getObjectID(), annot.getGeneration()));
+            if (want("subtype"))
+                subtypes.append(name_value(annot.getKey("/Subtype")));
+            if (want("flags")) {
+                auto f = annot.getKey("/F");
+                flags.append(f.isInteger() ? f.getIntValue() : 0);
+            }
+            if (want("rect")) {
+                auto rect = annot.getKey("/Rect");
+                bool valid = rect.isArray() && rect.getArrayNItems() == 4;
+                for (int j = 0; j < 4; ++j) {
+                    auto item = valid ? rect.getArrayItem(j) : QPDFObjectHandle();
+                    rects.values.push_back(item.isInitialized() && item.isNumber()
+                            ? item.getNumericValue()
+                            : std::numeric_limits<double>::quiet_NaN());
+                }
+            }
+            if (want("appearance_state"))
+                states.append(name_value(annot.getKey("/AS")));
+            if (want("field_name")) {
+                auto ffh = afdh->getFieldForAnnotation(QPDFAnnotationObjectHelper(annot));
+                auto name = ffh.isNull() ? "" : ffh.getFullyQualifiedName();
+                if (name.empty())
+                    field_names.append(py::none());
+                else
+                    field_names.append(py::str(name));
+            }
+        }
+    }
+
+    py::dict result;
+    if (want("page"))
+        result["page"] = pages;
+    if (want("objgen"))
+        result["objgen"] = objgens;
+    if (want("subtype"))
+        result["subtype"] = subtypes;
+    if (want("flags"))
+        result["flags"] = flags;
+    if (want("rect"))
+        result["rect"] = float_array_memoryview(std::move(rects));
+    if (want("appearance_state"))
+        result["appearance_state"] = states;
+    if (want("field_name"))
+        result["field_name"] = field_names;
+    return result;
+}
+
+// The objgens of annotations given as pikepdf.Annotation, Object, or (objid, gen)
+static std::set<QPDFObjGen> selected_annotations(QPDF &q, py::iterable annotations)
+{
+    std::set<QPDFObjGen> selected;
+    for (auto item : annotations) {
+        if (py::isinstance<py::tuple>(item)) {
+            auto objgen = item.cast<std::pair<int, int>>();
+            selected.insert(QPDFObjGen(objgen.first, objgen.second));
+            continue;
+        }
+        QPDFObjectHandle h;
+        if (py::isinstance<QPDFAnnotationObjectHelper>(item))
+            h = item.cast<QPDFAnnotationObjectHelper &>().getObjectHandle();
+        else
+            h = item.cast<QPDFObjectHandle>();
+        if (!h.isIndirect() || h.getOwningQPDF() != &q)
+            throw py::value_error("annotations must be indirect objects owned by this Pdf");
+        selected.insert(h.getObjGen());
+    }
+    return selected;
+}
+
+void generate_appearance_streams(QPDF &q, py::object annotations)
+{
+    QPDFAcroFormDocumentHelper afdh(q);
+    if (annotations.is_none()) {
+        afdh.generateAppearancesIfNeeded();
+        return;
+    }
+
+    // As generateAppearancesIfNeeded() does for all widgets, except that
+    // /NeedAppearances is left alone, since other fields may still need them.
+    auto selected = selected_annotations(q, annotations);
+    for (auto &page : QPDFPageDocumentHelper(q).getAllPages()) {
+        for (auto &aoh : afdh.getWidgetAnnotationsForPage(page)) {
+            if (!selected.count(aoh.getObjectHandle().getObjGen()))
+                continue;
+            auto ffh = afdh.getFieldForAnnotation(aoh);
+            if (ffh.isNull())
+                continue;
+            if (ffh.getFieldType() == "/Btn") {
+                // Buttons keep their appearances; make /AS agree with /V
+                if (ffh.isRadioButton() || ffh.isCheckbox())
+                    ffh.setV(ffh.getValue());
+            } else {
+                ffh.generateAppearance(aoh);
+            }
+        }
+    }
+}
+
+// Remove a flattened widget from the form, along with any of its parent fields
+// that are left with no kids
+static void remove_form_field(QPDF &q, QPDFObjectHandle field)
+{
+    auto acroform = q.getRoot().getKey("/AcroForm");
+    while (true) {
+        auto parent = field.getKey("/Parent");
+        QPDFObjectHandle kids;
+        if (parent.isDictionary())
+            kids = parent.getKey("/Kids");
+        else if (acroform.isDictionary())
+            kids = acroform.getKey("/Fields");
+        if (!kids.isArray())
+            return;
+        for (int i = kids.getArrayNItems() - 1; i >= 0; --i) {
+            if (kids.getArrayItem(i).getObjGen() == field.getObjGen())
+                kids.eraseItem(i);
+        }
+        if (!parent.isDictionary() || kids.getArrayNItems() > 0)
+            return;
+        field = parent;
+    }
+}
+
+void flatten_annotations(QPDF &q, std::string mode, py::object annotations)
+{
+    auto required = 0;
+    auto forbidden = an_invisible | an_hidden;
+
+    if (mode == "screen") {
+        forbidden |= an_no_view;
+    } else if (mode == "print") {
+        required |= an_print;
+    } else if (mode == "" || mode == "all") {
+        // No op
+    } else {
+        throw py::value_error("Mode must be one of 'all', 'screen', 'print'.");
+    }
+
+    if (annotations.is_none()) {
+        QPDFPageDocumentHelper(q).flattenAnnotations(required, forbidden);
+        return;
+    }
+
+    // QPDFPageDocumentHelper::flattenAnnotations() works on every annotation
+    // and removes the whole form, so the selected annotations are flattened
+    // here, in the same way, page by page.
+    auto selected = selected_annotations(q, annotations);
+    bool need_appearances = QPDFAcroFormDocumentHelper(q).getNeedAppearances();
+    std::vector<QPDFObjectHandle> flattened_widgets;
+    for (auto &page : QPDFPageDocumentHelper(q).getAllPages()) {
+        auto page_oh = page.getObjectHandle();
+        auto annots = page_oh.getKey("/Annots");
+        if (!annots.isArray())
+            continue;
+        auto resources = page.getAttribute("/Resources", true);
+        if (!resources.isDictionary()) {
+            resources = QPDFObjectHandle::newDictionary();
+            page_oh.replaceKey("/Resources", resources);
+        }
+        auto rotate_obj = page.getAttribute("/Rotate", false);
+        int rotate = rotate_obj.isInteger() ? static_cast<int>(rotate_obj.getIntValue()) : 0;
+
+        std::vector<QPDFObjectHandle> kept;
+        std::string content;
+        int next_fx = 1;
+        int n = annots.getArrayNItems();
+        for (int i = 0; i < n; ++i) {
+            auto annot = annots.getArrayItem(i);
+            if (!annot.isDictionary() || !annot.isIndirect() ||
+                !selected.count(annot.getObjGen())) {
+                kept.push_back(annot);
+                continue;
+            }
+            QPDFAnnotationObjectHelper aoh(annot);
+            bool is_widget = aoh.getSubtype() == "/Widget";
+            auto appearance = aoh.getAppearanceStream("/N");
+            if ((need_appearances && is_widget) || !appearance.isStream()) {
+                kept.push_back(annot);
+                continue;
+            }
+
+            std::string name;
+            auto xobjects = resources.getKey("/XObject");
+            do {
+                name = "/Fxo" + std::to_string(next_fx++);
+            } while (xobjects.isDictionary() && xobjects.hasKey(name));
+            auto drawing = aoh.getPageContentForAppearance(name, rotate, required, forbidden);
+            if (drawing.empty()) {
+                kept.push_back(annot);
+                continue;
+            }
+            resources.mergeResources(QPDFObjectHandle::parse("<< /XObject << >> >>"));
+            resources.getKey("/XObject").replaceKey(name, appearance);
+            content += drawing;
+            if (is_widget)
+                flattened_widgets.push_back(annot);
+        }
+
+        if (kept.size() != static_cast<size_t>(n)) {
+            if (kept.empty())
+                page_oh.removeKey("/Annots");
+            else
+                page_oh.replaceKey("/Annots", QPDFObjectHandle::newArray(kept));
+        }
+        if (!content.empty()) {
+            page.addPageContents(QPDFObjectHandle::newStream(&q, "q\n"), true);
+            page.addPageContents(QPDFObjectHandle::newStream(&q, "\nQ\n" + content), false);
+        }
+    }
+    for (auto &widget : flattened_widgets)
+        remove_form_field(q, widget);
+}
+
 
 void init_annotation(py::module_ &m)
 {
@@ -112,4 +381,10 @@ void init_annotation(py::module_ &m)
             py::arg("forbidden_flags") = an_invisible | an_hidden
         )
         ;
+
+    m.def("_scan_annotations", scan_annotations,
+        "Read fields of all annotations into columns. Use pikepdf.Pdf.scan_annotations.",
+        py::arg("pdf"),
+        py::arg("fields") = scan_fields
+    );
 }
@@ -0,0 +1,197 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <exception>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFExc.hh>
+#include <qpdf/QPDFWriter.hh>
+#include <qpdf/QPDFPageDocumentHelper.hh>
+#include <qpdf/QPDFPageObjectHelper.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "parallel.h"
+
+// Batch processing works on many PDFs at once, each with its own QPDF on a
+// native worker thread. None of this may touch Python: the Python side
+// (pikepdf._batch) validates the edits and options and converts them to plain
+// C++ values before we begin.
+
+using batch_edit = std::tuple<std::string, std::string, std::string>;
+
+struct BatchSaveOptions {
+    bool static_id = false;
+    bool preserve_pdfa = true;
+    std::string min_version;
+    int min_extension_level = 0;
+    std::string force_version;
+    int force_extension_level = 0;
+    bool compress_streams = true;
+    bool set_decode_level = false;
+    qpdf_stream_decode_level_e decode_level = qpdf_dl_generalized;
+    qpdf_object_stream_e object_stream_mode = qpdf_o_preserve;
+    bool normalize_content = false;
+    bool linearize = false;
+    bool qdf = false;
+    bool recompress_flate = false;
+};
+
+struct BatchOutcome {
+    std::exception_ptr error;
+};
+
+static void batch_apply_edit(QPDF &q, const batch_edit &edit)
+{
+    const auto &op = std::get<0>(edit);
+    const auto &key = std::get<1>(edit);
+    const auto &value = std::get<2>(edit);
+
+    if (op == "set_docinfo") {
+        auto trailer = q.getTrailer();
+        auto info = trailer.getKey("/Info");
+        if (!info.isDictionary()) {
+            info = q.makeIndirectObject(QPDFObjectHandle::newDictionary());
+            trailer.replaceKey("/Info", info);
+        }
+        info.replaceKey(key, QPDFObjectHandle::newUnicodeString(value));
+    } else if (op == "delete_docinfo") {
+        auto info = q.getTrailer().getKey("/Info");
+        if (info.isDictionary())
+            info.removeKey(key);
+    } else if (op == "delete_xmp") {
+        q.getRoot().removeKey("/Metadata");
+    } else if (op == "rotate") {
+        int angle = std::stoi(key);
+        for (auto &page : QPDFPageDocumentHelper(q).getAllPages()) {
+            page.rotatePage(angle, true);
+        }
+    } else {
+        throw std::logic_error("pikepdf.batch_process: unknown edit " + op); // LCOV_EXCL_LINE
+    }
+}
+
+static void batch_run_job(
+    const std::string &input,
+    const std::string &output,
+    const std::vector<batch_edit> &edits,
+    const std::string &password,
+    bool inherit_page_attributes,
+    const BatchSaveOptions &opts)
+{
+    QPDF q;
+    qpdf_basic_settings(q);
+    q.processFile(input.c_str(), password.c_str());
+    if (inherit_page_attributes)
+        q.pushInheritedAttributesToPage();
+
+    for (const auto &edit : edits)
+        batch_apply_edit(q, edit);
+
+    QPDFWriter w(q, output.c_str());
+    w.setStaticID(opts.static_id);
+    w.setNewlineBeforeEndstream(opts.preserve_pdfa);
+    if (!opts.min_version.empty())
+        w.setMinimumPDFVersion(opts.min_version, opts.min_extension_level);
+    w.setCompressStreams(opts.compress_streams);
+    if (opts.set_decode_level)
+        w.setDecodeLevel(opts.decode_level);
+    w.setObjectStreamMode(opts.object_stream_mode);
+    w.setRecompressFlate(opts.recompress_flate);
+    w.setPreserveEncryption(false); // As Pdf.save() does with encryption=None
+    w.setContentNormalization(opts.normalize_content);
+    w.setLinearization(opts.linearize);
+    w.setQDFMode(opts.qdf);
+    if (!opts.force_version.empty())
+        w.forcePDFVersion(opts.force_version, opts.force_extension_level);
+    w.write();
+}
+
+void init_batch(py::module_ &m)
+{
+    py::class_<BatchSaveOptions>(m, "_BatchSaveOptions")
+        .def(py::init<>())
+        .def_readwrite("static_id", &BatchSaveOptions::static_id)
+        .def_readwrite("preserve_pdfa", &BatchSaveOptions::preserve_pdfa)
+        .def_readwrite("min_version", &BatchSaveOptions::min_version)
+        .def_readwrite("min_extension_level", &BatchSaveOptions::min_extension_level)
+        .def_readwrite("force_version", &BatchSaveOptions::force_version)
+        .def_readwrite("force_extension_level", &BatchSaveOptions::force_extension_level)
+        .def_readwrite("compress_streams", &BatchSaveOptions::compress_streams)
+        .def_property("stream_decode_level",
+            [](const BatchSaveOptions &opts) -> py::object {
+                if (!opts.set_decode_level)
+                    return py::none();
+                return py::cast(opts.decode_level);
+            },
+            [](BatchSaveOptions &opts, py::object level) {
+                opts.set_decode_level = !level.is_none();
+                if (opts.set_decode_level)
+                    opts.decode_level = level.cast<qpdf_stream_decode_level_e>();
+            }
+        )
+        .def_readwrite("object_stream_mode", &BatchSaveOptions::object_stream_mode)
+        .def_readwrite("normalize_content", &BatchSaveOptions::normalize_content)
+        .def_readwrite("linearize", &BatchSaveOptions::linearize)
+        .def_readwrite("qdf", &BatchSaveOptions::qdf)
+        .def_readwrite("recompress_flate", &BatchSaveOptions::recompress_flate);
+
+    py::class_<BatchOutcome>(m, "_BatchOutcome")
+        .def_property_readonly("ok",
+            [](const BatchOutcome &outcome) {
+                return !outcome.error;
+            }
+        )
+        .def("reraise",
+            [](const BatchOutcome &outcome) {
+                // Let the usual exception translators convert the error
+                if (outcome.error)
+                    std::rethrow_exception(outcome.error);
+            },
+            "Raise the exception that this job failed with, if any."
+        );
+
+    m.def("_batch_process",
+        [](const std::vector<std::pair<py::bytes, py::bytes>> &jobs,
+           const std::vector<batch_edit> &edits,
+           const std::string &password,
+           bool inherit_page_attributes,
+           const BatchSaveOptions &opts,
+           unsigned int workers) {
+            std::vector<std::pair<std::string, std::string>> paths;
+            paths.reserve(jobs.size());
+            for (const auto &job : jobs)
+                paths.emplace_back(std::string(job.first), std::string(job.second));
+
+            std::vector<BatchOutcome> outcomes(paths.size());
+            {
+                py::gil_scoped_release release;
+                parallel_for(paths.size(), workers, [&](size_t i) {
+                    try {
+                        batch_run_job(paths[i].first, paths[i].second,
+                            edits, password, inherit_page_attributes, opts);
+                    } catch (...) {
+                        outcomes[i].error = std::current_exception();
+                    }
+                });
+            }
+            return outcomes;
+        },
+        "Open, edit and save many PDFs on native worker threads. Use pikepdf.batch_process.",
+        py::arg("jobs"),
+        py::arg("edits"),
+        py::arg("password"),
+        py::arg("inherit_page_attributes"),
+        py::arg("save_options"),
+        py::arg("workers")
+    );
+}
@@ -0,0 +1,382 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <qpdf/Buffer.hh>
+#include <qpdf/Pl_Buffer.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFExc.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "scratch_stream.h"
+
+#ifdef PIKEPDF_HAVE_JBIG2DEC
+extern "C" {
+#include <jbig2.h>
+}
+#endif
+
+// Decoders for stream filters that qpdf does not implement, such as
+// /JBIG2Decode. qpdf 10 cannot be given filters of its own, so when a stream's
+// filters end in registered ones, qpdf decodes the filters before them in a
+// private QPDF, and the registered decoders are run on the result. All of this
+// happens with the GIL released; decoders written in Python reacquire it.
+
+// Filters that qpdf decodes itself, and which cannot be replaced
+static const std::set<std::string> QPDF_FILTERS = {
+    "/ASCII85Decode",
+    "/ASCIIHexDecode",
+    "/DCTDecode",
+    "/FlateDecode",
+    "/LZWDecode",
+    "/RunLengthDecode",
+    "/A85",
+    "/AHx",
+    "/DCT",
+    "/Fl",
+    "/LZW",
+    "/RL",
+};
+
+// Decoders written in Python take precedence over native ones for the same
+// filter, and the native one is used again when the Python one is removed.
+struct DecoderRegistry {
+    std::mutex mutex;
+    std::map<std::string, StreamDecoder> native;
+    std::map<std::string, StreamDecoder> python;
+
+    // Call with the mutex held
+    const StreamDecoder *find(const std::string &filter) const
+    {
+        auto found = this->python.find(filter);
+        if (found != this->python.end())
+            return &found->second;
+        found = this->native.find(filter);
+        if (found != this->native.end())
+            return &found->second;
+        return nullptr;
+    }
+};
+
+// Never destroyed, so that decoders written in Python are not released after
+// the interpreter has been finalized
+static DecoderRegistry &decoder_registry()
+{
+    static auto registry = new DecoderRegistry;
+    return *registry;
+}
+
+static void set_decoder(std::map<std::string, StreamDecoder> DecoderRegistry::*table,
+    const std::string &filter, StreamDecoder decoder)
+{
+    auto &registry = decoder_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (decoder)
+        (registry.*table)[filter] = decoder;
+    else
+        (registry.*table).erase(filter);
+}
+
+void register_stream_decoder(const std::string &filter, StreamDecoder decoder)
+{
+    set_decoder(&DecoderRegistry::native, filter, decoder);
+}
+
+static StreamDecoder python_decoder(py::object decoder)
+{
+    return [decoder](QPDFObjectHandle decode_parms) -> StreamDecodeFn {
+        py::object parms = py::none();
+        if (decode_parms.isDictionary())
+            parms = py::cast(decode_parms);
+        return [decoder, parms](const std::string &data) {
+            py::gil_scoped_acquire acquire;
+            py::object result = decoder(py::bytes(data), parms);
+            auto decoded = py::reinterpret_steal<py::bytes>(PyBytes_FromObject(result.ptr()));
+            if (!decoded)
+                throw py::error_already_set();
+            return std::string(decoded);
+        };
+    };
+}
+
+PointerHolder<Buffer> stream_decode_registered(
+    QPDFObjectHandle h, qpdf_stream_decode_level_e decode_level)
+{
+    if (decode_level < qpdf_dl_specialized)
+        return PointerHolder<Buffer>();
+
+    auto dict = h.getDict();
+    auto filter = dict.getKey("/Filter");
+    std::vector<QPDFObjectHandle> filters;
+    if (filter.isArray())
+        filters = filter.getArrayAsVector();
+    else if (filter.isName())
+        filters.push_back(filter);
+    auto decode_parms = dict.getKey("/DecodeParms");
+    std::vector<QPDFObjectHandle> parms;
+    if (decode_parms.isArray())
+        parms = decode_parms.getArrayAsVector();
+    else
+        parms.push_back(decode_parms);
+    parms.resize(filters.size(), QPDFObjectHandle::newNull());
+
+    // The registered filters must come last; qpdf decodes the rest
+    size_t first = filters.size();
+    std::vector<StreamDecoder> decoders;
+    {
+        auto &registry = decoder_registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (size_t i = 0; i < filters.size(); ++i) {
+            if (!filters[i].isName())
+                return PointerHolder<Buffer>();
+            auto found = registry.find(filters[i].getName());
+            if (!found) {
+                if (!decoders.empty())
+                    return PointerHolder<Buffer>();
+                continue;
+            }
+            if (decoders.empty())
+                first = i;
+            decoders.push_back(*found);
+        }
+    }
+    if (decoders.empty())
+        return PointerHolder<Buffer>();
+
+    // Everything that reads from the Pdf is done here, with the GIL held
+    std::vector<StreamDecodeFn> steps;
+    for (size_t i = 0; i < decoders.size(); ++i)
+        steps.push_back(decoders[i](parms[first + i]));
+    std::unique_ptr<ScratchStream> prefix;
+    if (first > 0) {
+        std::vector<QPDFObjectHandle> prefix_filters(
+            filters.begin(), filters.begin() + first);
+        std::vector<QPDFObjectHandle> prefix_parms(
+            parms.begin(), parms.begin() + first);
+        prefix.reset(new ScratchStream(h.getRawStreamData(),
+            QPDFObjectHandle::newArray(prefix_filters),
+            QPDFObjectHandle::newArray(prefix_parms)));
+    }
+    auto raw = prefix ? PointerHolder<Buffer>() : h.getRawStreamData();
+    auto owner = h.getOwningQPDF();
+    auto filename = owner ? owner->getFilename() : std::string();
+    auto objgen = h.getObjGen();
+    auto description = "object " + std::to_string(objgen.getObj()) + " " +
+                       std::to_string(objgen.getGen());
+
+    std::string data;
+    {
+        py::gil_scoped_release release;
+        if (prefix) {
+            Pl_Buffer decoded("registered decoder input");
+            if (!prefix->pipe(&decoded, 0, decode_level, false, false))
+                return PointerHolder<Buffer>();
+            PointerHolder<Buffer> buf(decoded.getBuffer());
+            data.assign(reinterpret_cast<const char *>(buf->getBuffer()), buf->getSize());
+        } else {
+            data.assign(reinterpret_cast<const char *>(raw->getBuffer()), raw->getSize());
+        }
+        for (size_t i = 0; i < steps.size(); ++i) {
+            try {
+                data = steps[i](data);
+            } catch (const py::error_already_set &) {
+                throw;
+            } catch (const QPDFExc &) {
+                throw;
+            } catch (const std::runtime_error &e) {
+                throw QPDFExc(qpdf_e_damaged_pdf, filename, description, 0,
+                    filters[first + i].getName() + ": " + e.what());
+            }
+        }
+    }
+
+    PointerHolder<Buffer> result(new Buffer(data.size()));
+    if (!data.empty())
+        memcpy(result->getBuffer(), data.data(), data.size());
+    return result;
+}
+
+#ifdef PIKEPDF_HAVE_JBIG2DEC
+#ifndef JBIG2_VERSION_MAJOR
+#error "PIKEPDF_JBIG2DEC requires jbig2dec 0.18 or newer"
+#endif
+
+// A jbig2dec decoding context, which remembers the first fatal error
+class Jbig2Context {
+public:
+    explicit Jbig2Context(Jbig2GlobalCtx *globals = nullptr)
+    {
+        this->ctx = jbig2_ctx_new(
+            nullptr, JBIG2_OPTIONS_EMBEDDED, globals, &Jbig2Context::on_error, this);
+        if (!this->ctx)
+            throw std::runtime_error("could not create a JBIG2 decoder");
+    }
+    Jbig2Context(const Jbig2Context &) = delete;
+    Jbig2Context &operator=(const Jbig2Context &) = delete;
+    ~Jbig2Context()
+    {
+        if (this->ctx)
+            jbig2_ctx_free(this->ctx);
+    }
+
+    void feed(const std::string &data)
+    {
+        auto p = reinterpret_cast<const unsigned char *>(data.data());
+        if (jbig2_data_in(this->ctx, p, data.size()) < 0)
+            this->fail();
+    }
+
+    // The segments fed so far, to be shared by the contexts of images that
+    // refer to them. The returned context owns this one's state.
+    Jbig2GlobalCtx *make_globals()
+    {
+        auto globals = jbig2_make_global_ctx(this->ctx);
+        this->ctx = nullptr;
+        return globals;
+    }
+
+    // The page, as JBIG2Decode produces it: rows padded to a byte, with 0 for
+    // black, the opposite of JBIG2 itself
+    std::string page()
+    {
+        if (jbig2_complete_page(this->ctx) < 0)
+            this->fail();
+        Jbig2Image *image = jbig2_page_out(this->ctx);
+        if (!image)
+            this->fail();
+        size_t row = (image->width + 7) / 8;
+        std::string out(row * image->height, '\0');
+        for (uint32_t y = 0; y < image->height; ++y) {
+            const uint8_t *src = image->data + size_t(y) * image->stride;
+            for (size_t x = 0; x < row; ++x)
+                out[y * row + x] = static_cast<char>(~src[x]);
+        }
+        jbig2_release_page(this->ctx, image);
+        return out;
+    }
+
+private:
+    static void on_error(
+        void *data, const char *msg, Jbig2Severity severity, uint32_t /*seg_idx*/)
+    {
+        auto self = static_cast<Jbig2Context *>(data);
+        if (severity == JBIG2_SEVERITY_FATAL && self->error.empty() && msg)
+            self->error = msg;
+    }
+    [[noreturn]] void fail()
+    {
+        throw std::runtime_error(
+            this->error.empty() ? "could not decode JBIG2 data" : this->error);
+    }
+
+    Jbig2Ctx *ctx = nullptr;
+    std::string error;
+};
+
+static StreamDecodeFn jbig2_decoder(QPDFObjectHandle decode_parms)
+{
+    std::string globals;
+    if (decode_parms.isDictionary()) {
+        auto globals_stream = decode_parms.getKey("/JBIG2Globals");
+        if (globals_stream.isStream()) {
+            auto buf = globals_stream.getStreamData(qpdf_dl_generalized);
+            globals.assign(reinterpret_cast<const char *>(buf->getBuffer()), buf->getSize());
+        }
+    }
+    return [globals](const std::string &data) {
+        // Declared in this order so that they are destroyed in reverse
+        Jbig2Context globals_ctx;
+        std::unique_ptr<Jbig2GlobalCtx, void (*)(Jbig2GlobalCtx *)> shared(
+            nullptr, [](Jbig2GlobalCtx *g) { jbig2_global_ctx_free(g); });
+        if (!globals.empty()) {
+            globals_ctx.feed(globals);
+            shared.reset(globals_ctx.make_globals());
+        }
+        Jbig2Context ctx(shared.get());
+        ctx.feed(data);
+        return ctx.page();
+    };
+}
+#endif
+
+void init_decoders(py::module_ &m)
+{
+#ifdef PIKEPDF_HAVE_JBIG2DEC
+    register_stream_decoder("/JBIG2Decode", jbig2_decoder);
+#endif
+
+    m.def("register_stream_decoder",
+        [](std::string filter, py::object decoder) {
+            if (filter.size() < 2 || filter[0] != '/')
+                throw py::value_error("filter must be a name beginning with '/'");
+            if (QPDF_FILTERS.count(filter))
+                throw py::value_error("qpdf already decodes " + filter);
+            if (decoder.is_none()) {
+                set_decoder(&DecoderRegistry::python, filter, StreamDecoder());
+                return;
+            }
+            if (!PyCallable_Check(decoder.ptr()))
+                throw py::type_error("decoder must be callable or None");
+            set_decoder(&DecoderRegistry::python, filter, python_decoder(decoder));
+        },
+        R"~~~(
+        Register a decoder for a stream filter that qpdf does not implement.
+
+        Once registered, streams whose filters end in ``filter`` can be read
+        with :meth:`pikepdf.Object.read_bytes` and similar methods, at
+        ``decode_level=StreamDecodeLevel.specialized`` or higher. qpdf decodes
+        any filters before it, and then ``decoder`` is called with the data,
+        as ``bytes``, and the filter's ``/DecodeParms`` dictionary, or ``None``.
+        It must return the decoded data, as a bytes-like object.
+
+        pikepdf may register native decoders of its own, such as
+        ``/JBIG2Decode`` when built with jbig2dec; these run with the GIL
+        released. A decoder registered here is used instead of the native one
+        for the same filter, until it is removed; pikepdf's native decoder is
+        then used again. Native decoders cannot be removed.
+
+        Args:
+            filter: The filter's name, such as ``'/JBIG2Decode'``.
+            decoder: The decoder, or ``None`` to remove the one registered
+                with this function.
+
+        .. versionadded:: 2.13
+        )~~~",
+        py::arg("filter"),
+        py::arg("decoder")
+    );
+    m.def("stream_decoders",
+        []() {
+            auto &registry = decoder_registry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            std::set<std::string> names;
+            for (auto &item : registry.native)
+                names.insert(item.first);
+            for (auto &item : registry.python)
+                names.insert(item.first);
+            return std::vector<std::string>(names.begin(), names.end());
+        },
+        R"~~~(
+        The names of the stream filters that have registered decoders.
+
+        .. versionadded:: 2.13
+        )~~~"
+    );
+}
@@ -0,0 +1,344 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "parallel.h"
+#include "qpdf_state.h"
+
+// Deduplication merges indirect objects that would be written identically:
+// streams with the same dictionary (less /Length) and raw data, and
+// dictionaries and arrays with the same unparsed text. References to the
+// duplicates are rewritten to refer to the first copy. The duplicates are left
+// as they are, so handles to them keep working, but nothing refers to them, so
+// they are not saved. Merging objects can make the objects that refer to them
+// identical, so this is repeated until nothing more merges.
+//
+// Raw stream data is read serially, a window at a time, since qpdf's input
+// sources are not thread-safe, and hashed on native worker threads. Streams
+// are read in order of their /Length, so that streams of the same size, the
+// only ones that can be identical, are usually in the same window, and are
+// compared there from the data already read. Stream data does not change as
+// objects are merged, so this is done once.
+
+// (streams merged, other objects merged, bytes saved)
+using dedup_result = std::tuple<long long, long long, long long>;
+
+// Most raw stream data to hold in memory at once
+constexpr size_t DEDUP_WINDOW = 64 * 1024 * 1024;
+
+struct DedupItem {
+    QPDFObjectHandle h;
+    bool is_stream = false;
+    bool readable = true;
+    bool dirty = true; // text must be recomputed
+    bool merged = false;
+    std::string text;
+    size_t text_hash = 0;
+    size_t data_hash = 0;
+    size_t data_size = 0;
+    size_t data_id = 0; // The first stream found with the same raw data
+    PointerHolder<Buffer> raw; // Only held while its window is read
+};
+
+static size_t hash_bytes(const unsigned char *data, size_t size)
+{
+    // 64-bit FNV-1a
+    unsigned long long h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+    return static_cast<size_t>(h);
+}
+
+// Annotations, as listed in each page's /Annots. /Type is optional for
+// annotations, so they cannot all be recognized by their dictionary.
+static std::unordered_set<QPDFObjGen, ObjGenHash> page_annotations(QPDF &q)
+{
+    std::unordered_set<QPDFObjGen, ObjGenHash> annots;
+    for (auto const &page : page_table(q)) {
+        auto page_annots = page.getKey("/Annots");
+        if (!page_annots.isArray())
+            continue;
+        for (auto const &annot : page_annots.getArrayAsVector()) {
+            if (annot.isIndirect())
+                annots.insert(annot.getObjGen());
+        }
+    }
+    return annots;
+}
+
+// Objects whose identity matters, even if another object has the same
+// contents: the document structure, annotations, objects that refer back to
+// their parent, and signed and encryption dictionaries.
+static bool mergeable(QPDFObjectHandle h, QPDFObjGen encrypt,
+    const std::unordered_set<QPDFObjGen, ObjGenHash> &annots)
+{
+    if (h.getObjGen() == encrypt || annots.count(h.getObjGen()))
+        return false;
+    if (h.isArray())
+        return true;
+    if (!h.isStream() && !h.isDictionary())
+        return false;
+    if (h.isPageObject() || h.isPagesObject())
+        return false;
+
+    static const std::set<std::string> identity_keys = {
+        "/Parent", "/P", "/Kids", "/FT", "/ByteRange"};
+    static const std::set<std::string> identity_types = {"/Catalog", "/Annot",
+        "/ObjStm", "/XRef", "/Sig", "/StructTreeRoot", "/StructElem", "/MCR",
+        "/OBJR", "/Outlines", "/OCG", "/OCMD"};
+
+    auto dict = h.isStream() ? h.getDict() : h;
+    for (auto const &key : identity_keys) {
+        if (dict.hasKey(key))
+            return false;
+    }
+    auto type = dict.getKey("/Type");
+    if (type.isName() && identity_types.count(type.getName()))
+        return false;
+    // An annotation without /Type that no page lists
+    if (!h.isStream() && dict.hasKey("/Subtype") && dict.hasKey("/Rect"))
+        return false;
+    return true;
+}
+
+static std::string object_text(QPDFObjectHandle h)
+{
+    // The objects are indirect, so unparse() would give "N G R"
+    if (!h.isStream())
+        return h.unparseResolved();
+    auto dict = h.getDict().shallowCopy();
+    dict.removeKey("/Length");
+    return dict.unparseResolved();
+}
+
+static bool same_data(const Buffer &a, const Buffer &b)
+{
+    return a.getSize() == b.getSize() &&
+        std::memcmp(a.getBuffer(), b.getBuffer(), a.getSize()) == 0;
+}
+
+static long long length_hint(QPDFObjectHandle h)
+{
+    auto length = h.getDict().getKey("/Length");
+    return length.isInteger() ? length.getIntValue() : -1;
+}
+
+// Hash each stream's raw data, and give streams with the same raw data the
+// same data_id
+static void classify_stream_data(std::vector<DedupItem> &items, unsigned int workers)
+{
+    std::vector<std::pair<long long, size_t>> order;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].is_stream)
+            order.emplace_back(length_hint(items[i].h), i);
+    }
+    std::sort(order.begin(), order.end());
+
+    // For each raw size and hash, the streams found with different data
+    std::map<std::pair<size_t, size_t>, std::vector<size_t>> distinct;
+
+    py::gil_scoped_release release;
+    size_t begin = 0;
+    while (begin < order.size()) {
+        size_t end = begin;
+        size_t window = 0;
+        while (end < order.size() && (end == begin || window < DEDUP_WINDOW)) {
+            auto &item = items[order[end].second];
+            try {
+                item.raw = item.h.getRawStreamData();
+                item.data_size = item.raw->getSize();
+                window += item.data_size;
+            } catch (const std::exception &) {
+                item.readable = false;
+            }
+            ++end;
+        }
+        parallel_for(end - begin, workers, [&](size_t i) {
+            auto &item = items[order[begin + i].second];
+            if (item.readable)
+                item.data_hash = hash_bytes(item.raw->getBuffer(), item.data_size);
+        });
+
+        for (size_t k = begin; k < end; ++k) {
+            auto index = order[k].second;
+            auto &item = items[index];
+            if (!item.readable)
+                continue;
+            auto &found = distinct[std::make_pair(item.data_size, item.data_hash)];
+            item.data_id = index;
+            for (auto other_index : found) {
+                auto &other = items[other_index];
+                // Read again only if it was in an earlier window
+                auto other_raw = other.raw.getPointer() ? other.raw : other.h.getRawStreamData();
+                if (same_data(*item.raw, *other_raw)) {
+                    item.data_id = other.data_id;
+                    break;
+                }
+            }
+            if (item.data_id == index)
+                found.push_back(index);
+        }
+        for (size_t k = begin; k < end; ++k)
+            items[order[k].second].raw = PointerHolder<Buffer>();
+        begin = end;
+    }
+}
+
+static bool same_object(const DedupItem &a, const DedupItem &b)
+{
+    if (a.is_stream != b.is_stream || a.data_size != b.data_size || a.text != b.text)
+        return false;
+    return !a.is_stream || a.data_id == b.data_id;
+}
+
+// Replace references in container, and its direct children, to objects in
+// replacements. Returns true if anything was replaced.
+static bool rewrite_references(QPDFObjectHandle container,
+    const std::unordered_map<QPDFObjGen, QPDFObjectHandle, ObjGenHash> &replacements)
+{
+    bool changed = false;
+    auto rewrite = [&](QPDFObjectHandle value, QPDFObjectHandle *replacement) {
+        if (value.isIndirect()) {
+            auto found = replacements.find(value.getObjGen());
+            if (found == replacements.end())
+                return false;
+            *replacement = found->second;
+            return true;
+        }
+        if (value.isDictionary() || value.isArray())
+            changed = rewrite_references(value, replacements) || changed;
+        return false;
+    };
+
+    if (container.isStream())
+        container = container.getDict();
+    if (container.isDictionary()) {
+        for (auto const &key : container.getKeys()) {
+            QPDFObjectHandle replacement;
+            if (rewrite(container.getKey(key), &replacement)) {
+                container.replaceKey(key, replacement);
+                changed = true;
+            }
+        }
+    } else if (container.isArray()) {
+        int n = container.getArrayNItems();
+        for (int i = 0; i < n; ++i) {
+            QPDFObjectHandle replacement;
+            if (rewrite(container.getArrayItem(i), &replacement)) {
+                container.setArrayItem(i, replacement);
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+static dedup_result deduplicate_pdf(QPDF &q, unsigned int workers)
+{
+    auto encrypt = q.getTrailer().getKey("/Encrypt").getObjGen();
+    auto annots = page_annotations(q);
+
+    std::vector<DedupItem> items;
+    std::unordered_map<QPDFObjGen, size_t, ObjGenHash> item_index;
+    for (auto &obj : q.getAllObjects()) {
+        if (!mergeable(obj, encrypt, annots))
+            continue;
+        item_index[obj.getObjGen()] = items.size();
+        items.emplace_back();
+        items.back().h = obj;
+        items.back().is_stream = obj.isStream();
+    }
+    classify_stream_data(items, workers);
+
+    long long streams_merged = 0, objects_merged = 0, bytes_saved = 0;
+    while (true) {
+        std::vector<size_t> dirty;
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto &item = items[i];
+            if (item.merged || !item.readable || !item.dirty)
+                continue;
+            item.text = object_text(item.h);
+            item.dirty = false;
+            dirty.push_back(i);
+        }
+        {
+            py::gil_scoped_release release;
+            parallel_for(dirty.size(), workers, [&](size_t i) {
+                auto &item = items[dirty[i]];
+                item.text_hash = std::hash<std::string>()(item.text);
+            });
+        }
+
+        // The first of each set of identical objects, in object order, is kept
+        std::unordered_map<size_t, std::vector<size_t>> groups;
+        std::unordered_map<QPDFObjGen, QPDFObjectHandle, ObjGenHash> replacements;
+        for (size_t i = 0; i < items.size(); ++i) {
+            auto &item = items[i];
+            if (item.merged || !item.readable)
+                continue;
+            auto key = item.text_hash ^ (item.data_hash * 31) ^ (item.is_stream ? 1 : 0);
+            auto &candidates = groups[key];
+            bool found = false;
+            for (auto candidate : candidates) {
+                if (same_object(items[candidate], item)) {
+                    replacements[item.h.getObjGen()] = items[candidate].h;
+                    item.merged = true;
+                    if (item.is_stream)
+                        ++streams_merged;
+                    else
+                        ++objects_merged;
+                    bytes_saved += item.text.size() + item.data_size;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+                candidates.push_back(i);
+        }
+        if (replacements.empty())
+            break;
+
+        for (auto &obj : q.getAllObjects()) {
+            auto found = item_index.find(obj.getObjGen());
+            // Nothing refers to the duplicates merged so far
+            if (found != item_index.end() && items[found->second].merged)
+                continue;
+            if (rewrite_references(obj, replacements) && found != item_index.end())
+                items[found->second].dirty = true;
+        }
+        rewrite_references(q.getTrailer(), replacements);
+    }
+    return dedup_result(streams_merged, objects_merged, bytes_saved);
+}
+
+void init_deduplicate(py::module_ &m)
+{
+    m.def("_deduplicate", deduplicate_pdf,
+        "Merge identical streams and objects. Use pikepdf.Pdf.deduplicate.",
+        py::arg("pdf"),
+        py::arg("workers")
+    );
+}
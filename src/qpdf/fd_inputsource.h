@@ -0,0 +1,230 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <vector>
+
+#include <qpdf/Constants.h>
+#include <qpdf/Types.h>
+#include <qpdf/DLL.h>
+#include <qpdf/QPDFExc.hh>
+#include <qpdf/PointerHolder.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/InputSource.hh>
+#include <qpdf/QUtil.hh>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "pdf_stats.h"
+#include "utils.h"
+
+constexpr size_t FD_READ_WINDOW_SIZE = 256 * 1024;
+
+// An InputSource that reads a Python file object's underlying file descriptor
+// with pread(), so that reading never calls back into Python.
+//
+// GIL usage:
+// The file descriptor is obtained when the input source is created. After that,
+// the GIL is only needed to close the stream. We keep a read-ahead window of
+// the file in memory; refilling the window is the only time we block on I/O.
+// Reads do not release the GIL themselves: qpdf reads while resolving objects,
+// and another thread must not call into the same Pdf in the middle of that.
+// Opening a file releases the GIL around all of its reads (see open_pdf).
+// The file must not be modified while it is open.
+class FileDescriptorInputSource : public InputSource
+{
+public:
+    FileDescriptorInputSource(py::object stream, const std::string& description,
+                              bool close_stream, std::shared_ptr<PdfStats> stats = nullptr,
+                              size_t window_size = FD_READ_WINDOW_SIZE) :
+            InputSource(), stream(stream), description(description),
+            close_stream(close_stream), stats(stats), window_size(window_size)
+    {
+        py::gil_scoped_acquire acquire;
+        this->fd = stream.attr("fileno")().cast<int>();
+        this->file_size = native_file_size(this->fd);
+        if (this->file_size < 0)
+            QUtil::throw_system_error(this->description);
+        this->window.reserve(window_size);
+    }
+    virtual ~FileDescriptorInputSource()
+    {
+        try {
+            py::gil_scoped_acquire acquire;
+            if (this->close_stream && py::hasattr(this->stream, "close")) {
+                this->stream.attr("close")();
+            }
+        } catch (py::error_already_set &e) {
+            e.discard_as_unraisable(__func__);
+        } catch (const std::runtime_error &e) {
+            if (!str_startswith(e.what(), "StopIteration"))
+                std::cerr << "Exception in " << __func__ << ": " << e.what();
+        }
+    }
+    FileDescriptorInputSource(const FileDescriptorInputSource&) = delete;
+    FileDescriptorInputSource& operator= (const FileDescriptorInputSource&) = delete;
+    FileDescriptorInputSource(FileDescriptorInputSource&&) = delete;
+    FileDescriptorInputSource& operator= (FileDescriptorInputSource&&) = delete;
+
+    std::string const& getName() const override
+    {
+        return this->description;
+    }
+
+    qpdf_offset_t tell() override
+    {
+        return this->offset;
+    }
+
+    void seek(qpdf_offset_t offset, int whence) override
+    {
+        switch (whence) {
+        case SEEK_SET:
+            break;
+        case SEEK_CUR:
+            offset += this->offset;
+            break;
+        case SEEK_END:
+            offset += this->file_size;
+            break;
+        default:
+            throw std::logic_error("INTERNAL ERROR: invalid argument to seek"); // LCOV_EXCL_LINE
+        }
+        if (offset < 0)
+            throw std::runtime_error(this->description + ": seek before beginning of file");
+        this->offset = offset;
+    }
+
+    // LCOV_EXCL_START
+    void rewind() override
+    {
+        // qpdf never seems to use this but still requires
+        this->offset = 0;
+    }
+    // LCOV_EXCL_STOP
+
+    size_t read(char* buffer, size_t length) override
+    {
+        if (this->offset >= this->file_size) {
+            this->last_offset = this->file_size;
+            return 0;
+        }
+        this->last_offset = this->offset;
+        length = std::min(length, static_cast<size_t>(this->file_size - this->offset));
+
+        if (length >= this->window_size) {
+            // Large reads, such as stream data, go directly to the caller's buffer
+            auto bytes_read = this->pread_fully(
+                reinterpret_cast<unsigned char*>(buffer), length, this->offset);
+            this->offset += bytes_read;
+            return bytes_read;
+        }
+
+        if (!this->in_window(this->offset, length))
+            this->fill_window(this->offset);
+        auto available = static_cast<size_t>(
+            this->window_offset + this->window.size() - this->offset);
+        length = std::min(length, available);
+        memcpy(buffer, this->window.data() + (this->offset - this->window_offset), length);
+        this->offset += length;
+        return length;
+    }
+
+    void unreadCh(char ch) override
+    {
+        if (this->offset > 0)
+            --this->offset;
+    }
+
+    qpdf_offset_t findAndSkipNextEOL() override
+    {
+        // Return the offset of the next end of line, and position ourselves
+        // after it, as BufferInputSource does
+        while (this->offset < this->file_size) {
+            if (!this->in_window(this->offset, 1)) {
+                this->fill_window(this->offset);
+                if (this->window.empty())
+                    break; // File was truncated under us
+            }
+            auto begin = this->window.data() + (this->offset - this->window_offset);
+            auto end = this->window.data() + this->window.size();
+            auto p = std::find_if(begin, end,
+                [](unsigned char c) { return c == '\r' || c == '\n'; });
+            this->offset += (p - begin);
+            if (p == end)
+                continue;
+
+            qpdf_offset_t result = this->offset;
+            ++this->offset;
+            char ch;
+            while (this->read(&ch, 1) == 1) {
+                if (ch != '\r' && ch != '\n') {
+                    this->unreadCh(ch);
+                    break;
+                }
+            }
+            return result;
+        }
+        this->offset = this->file_size;
+        return this->file_size;
+    }
+
+private:
+    bool in_window(qpdf_offset_t pos, size_t length) const
+    {
+        return pos >= this->window_offset &&
+            pos + static_cast<qpdf_offset_t>(length) <=
+                this->window_offset + static_cast<qpdf_offset_t>(this->window.size());
+    }
+
+    void fill_window(qpdf_offset_t pos)
+    {
+        auto length = static_cast<size_t>(
+            std::min(static_cast<qpdf_offset_t>(this->window_size), this->file_size - pos));
+        this->window.resize(length);
+        auto bytes_read = this->pread_fully(this->window.data(), length, pos);
+        this->window.resize(bytes_read);
+        this->window_offset = pos;
+    }
+
+    size_t pread_fully(unsigned char *buf, size_t length, qpdf_offset_t pos)
+    {
+        size_t total = 0;
+        while (total < length) {
+            auto bytes_read = native_file_pread(this->fd, buf + total, length - total, pos + total);
+            if (bytes_read < 0) {
+                if (errno == EINTR)
+                    continue;
+                QUtil::throw_system_error(this->description);
+            }
+            if (bytes_read == 0)
+                break; // File was truncated under us
+            stats_count_read(this->stats, bytes_read);
+            total += bytes_read;
+        }
+        return total;
+    }
+
+    py::object stream;
+    std::string description;
+    bool close_stream;
+    std::shared_ptr<PdfStats> stats;
+    int fd = -1;
+    qpdf_offset_t file_size = 0;
+    qpdf_offset_t offset = 0;
+    size_t window_size;
+    qpdf_offset_t window_offset = 0;
+    std::vector<unsigned char> window;
+};
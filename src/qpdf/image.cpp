@@ -0,0 +1,428 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <qpdf/Buffer.hh>
+#include <qpdf/Pipeline.hh>
+#include <qpdf/Pl_Buffer.hh>
+#include <qpdf/Pl_Flate.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "parallel.h"
+#include "scratch_stream.h"
+
+// Native image extraction. PdfImage decides how each image is to be extracted,
+// since that depends on much of its metadata; here we do the work that is
+// proportional to the size of the image: undoing stacked compression, decoding,
+// and building TIFF and PNG files, on native threads with the GIL released.
+// Raw image data is read serially, a window at a time, since qpdf's input
+// sources are not thread-safe.
+
+// Most raw image data to hold in memory at once
+constexpr size_t EXTRACT_WINDOW = 64 * 1024 * 1024;
+
+static void put_u16le(std::string &s, uint32_t v)
+{
+    s += static_cast<char>(v & 0xff);
+    s += static_cast<char>((v >> 8) & 0xff);
+}
+
+static void put_u32le(std::string &s, uint32_t v)
+{
+    put_u16le(s, v & 0xffff);
+    put_u16le(s, v >> 16);
+}
+
+static void put_u32be(std::string &s, uint32_t v)
+{
+    s += static_cast<char>((v >> 24) & 0xff);
+    s += static_cast<char>((v >> 16) & 0xff);
+    s += static_cast<char>((v >> 8) & 0xff);
+    s += static_cast<char>(v & 0xff);
+}
+
+// A little-endian TIFF header for CCITT data of the given size, which follows
+// the header (and the ICC profile, if any) in the file.
+static std::string ccitt_tiff_header(uint32_t width, uint32_t height, int k,
+    bool black_is_1, uint32_t data_length, const std::string &icc)
+{
+    enum : uint16_t { SHORT = 3, LONG = 4, UNDEFINED = 7 };
+    struct Entry {
+        uint16_t tag;
+        uint16_t type;
+        uint32_t count;
+        uint32_t value;
+    };
+
+    uint32_t ccitt_group = k < 0 ? 4 : (k > 0 ? 3 : 2);
+    // The TIFF specification says the opposite, but this is what works
+    uint32_t photometry = black_is_1 ? 1 : 0;
+
+    std::vector<Entry> entries = {
+        {256, LONG, 1, width},         // ImageWidth
+        {257, LONG, 1, height},        // ImageLength
+        {258, SHORT, 1, 1},            // BitsPerSample
+        {259, SHORT, 1, ccitt_group},  // Compression
+        {262, SHORT, 1, photometry},   // PhotometricInterpretation
+        {273, LONG, 1, 0},             // StripOffsets, set below
+        {278, LONG, 1, height},        // RowsPerStrip
+        {279, LONG, 1, data_length},   // StripByteCounts
+    };
+    if (!icc.empty())
+        entries.push_back({34675, UNDEFINED, static_cast<uint32_t>(icc.size()), 0});
+
+    auto icc_offset = static_cast<uint32_t>(10 + 12 * entries.size() + 4);
+    entries[5].value = icc_offset + static_cast<uint32_t>(icc.size());
+    if (!icc.empty())
+        entries.back().value = icc_offset;
+
+    std::string header = "II";
+    put_u16le(header, 42);
+    put_u32le(header, 8); // Offset to first IFD
+    put_u16le(header, static_cast<uint32_t>(entries.size()));
+    for (auto const &entry : entries) {
+        put_u16le(header, entry.tag);
+        put_u16le(header, entry.type);
+        put_u32le(header, entry.count);
+        put_u32le(header, entry.value);
+    }
+    put_u32le(header, 0); // No more IFDs
+    header += icc;
+    return header;
+}
+
+static uint32_t png_crc(const char *data, size_t len, uint32_t crc = 0)
+{
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int bit = 0; bit < 8; ++bit)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void png_chunk(std::string &png, const char *type, const std::string &data)
+{
+    put_u32be(png, static_cast<uint32_t>(data.size()));
+    auto start = png.size();
+    png.append(type, 4);
+    png += data;
+    put_u32be(png, png_crc(png.data() + start, png.size() - start));
+}
+
+static std::string flate(Pl_Flate::action_e action, const unsigned char *data, size_t len)
+{
+    Pl_Buffer out("image flate");
+    Pl_Flate pipe("image flate", &out, action);
+    if (len > 0)
+        pipe.write(const_cast<unsigned char *>(data), len);
+    pipe.finish();
+    std::unique_ptr<Buffer> buf(out.getBuffer());
+    return std::string(reinterpret_cast<const char *>(buf->getBuffer()), buf->getSize());
+}
+
+struct ImageJob {
+    QPDFObjectHandle stream;
+    std::string format; // ".jpg", ".tif" or ".png"
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // For .jpg and .tif: the number of /FlateDecode filters to undo before
+    // the data can be used as it is
+    int unstack = 0;
+    // For .tif
+    int k = 0;
+    bool black_is_1 = false;
+    // For .png: "1", "L", "RGB" or "P"
+    std::string mode;
+    std::string palette;
+    std::string palette_mode;
+    // For .tif and .png
+    std::string icc;
+
+    PointerHolder<Buffer> raw;
+    std::unique_ptr<ScratchStream> scratch;
+    bool done = false;
+    std::string output;
+};
+
+static ImageJob image_job(py::dict plan)
+{
+    ImageJob job;
+    job.stream = plan["stream"].cast<QPDFObjectHandle>();
+    job.format = plan["format"].cast<std::string>();
+    job.width = plan["width"].cast<uint32_t>();
+    job.height = plan["height"].cast<uint32_t>();
+    if (plan.contains("unstack"))
+        job.unstack = plan["unstack"].cast<int>();
+    if (plan.contains("k"))
+        job.k = plan["k"].cast<int>();
+    if (plan.contains("black_is_1"))
+        job.black_is_1 = plan["black_is_1"].cast<bool>();
+    if (plan.contains("mode"))
+        job.mode = plan["mode"].cast<std::string>();
+    if (plan.contains("palette") && !plan["palette"].is_none()) {
+        auto palette = plan["palette"].cast<py::tuple>();
+        job.palette_mode = palette[0].cast<std::string>();
+        job.palette = palette[1].cast<std::string>();
+    }
+    if (plan.contains("icc") && !plan["icc"].is_none())
+        job.icc = plan["icc"].cast<std::string>();
+    if (job.format != ".jpg" && job.format != ".tif" && job.format != ".png")
+        throw py::value_error("unknown image format " + job.format);
+    return job;
+}
+
+static std::string png_file(ImageJob &job, const unsigned char *pixels, size_t size)
+{
+    int bit_depth = job.mode == "1" ? 1 : 8;
+    int color_type = 0; // Grayscale
+    int channels = 1;
+    if (job.mode == "RGB") {
+        color_type = 2;
+        channels = 3;
+    } else if (job.mode == "P") {
+        color_type = 3;
+    } else if (job.mode != "1" && job.mode != "L") {
+        throw std::logic_error("unexpected mode for PNG");
+    }
+    size_t stride = (static_cast<size_t>(job.width) * channels * bit_depth + 7) / 8;
+    if (job.width == 0 || job.height == 0 || size < stride * job.height)
+        throw std::length_error("image data is shorter than its dimensions");
+
+    std::string png("\x89PNG\r\n\x1a\n", 8);
+
+    std::string ihdr;
+    put_u32be(ihdr, job.width);
+    put_u32be(ihdr, job.height);
+    ihdr += static_cast<char>(bit_depth);
+    ihdr += static_cast<char>(color_type);
+    ihdr += std::string(3, '\0'); // Deflate, adaptive filtering, no interlace
+    png_chunk(png, "IHDR", ihdr);
+
+    if (!job.icc.empty()) {
+        auto profile = flate(Pl_Flate::a_deflate,
+            reinterpret_cast<const unsigned char *>(job.icc.data()), job.icc.size());
+        png_chunk(png, "iCCP", std::string("ICC Profile\0\0", 13) + profile);
+    }
+
+    if (job.mode == "P") {
+        std::string plte;
+        if (job.palette_mode == "L") {
+            for (char gray : job.palette)
+                plte.append(3, gray);
+        } else if (job.palette_mode == "RGB") {
+            plte = job.palette.substr(0, job.palette.size() - job.palette.size() % 3);
+        } else {
+            throw std::logic_error("unexpected palette mode for PNG");
+        }
+        if (plte.empty() || plte.size() > 256 * 3)
+            throw std::length_error("palette has an invalid size");
+        // Pad to the full 256 entries, so that every index is valid
+        plte.resize(256 * 3, '\0');
+        png_chunk(png, "PLTE", plte);
+    }
+
+    // Every row gets filter type 0 (none)
+    std::string rows;
+    rows.reserve((stride + 1) * job.height);
+    for (uint32_t y = 0; y < job.height; ++y) {
+        rows += '\0';
+        rows.append(reinterpret_cast<const char *>(pixels) + y * stride, stride);
+    }
+    png_chunk(png, "IDAT", flate(Pl_Flate::a_deflate,
+        reinterpret_cast<const unsigned char *>(rows.data()), rows.size()));
+    png_chunk(png, "IEND", "");
+    return png;
+}
+
+static void image_read(ImageJob &job)
+{
+    try {
+        job.raw = job.stream.getRawStreamData();
+        if (job.format == ".png")
+            job.scratch = std::make_unique<ScratchStream>(job.stream, job.raw);
+    } catch (const std::exception &) {
+        job.raw = PointerHolder<Buffer>();
+        job.scratch.reset();
+    }
+}
+
+static void image_extract(ImageJob &job)
+{
+    if (!job.raw.getPointer())
+        return;
+    try {
+        if (job.format == ".png") {
+            Pl_Buffer out("image pixels");
+            bool decoded = job.scratch->pipe(&out, 0, qpdf_dl_specialized, false, false);
+            bool warned = !job.scratch->warnings().empty();
+            job.scratch.reset();
+            if (!decoded || warned)
+                return;
+            std::unique_ptr<Buffer> pixels(out.getBuffer());
+            job.output = png_file(job, pixels->getBuffer(), pixels->getSize());
+        } else {
+            std::string data(
+                reinterpret_cast<const char *>(job.raw->getBuffer()), job.raw->getSize());
+            for (int i = 0; i < job.unstack; ++i) {
+                data = flate(Pl_Flate::a_inflate,
+                    reinterpret_cast<const unsigned char *>(data.data()), data.size());
+            }
+            if (job.format == ".tif") {
+                job.output = ccitt_tiff_header(
+                    job.width, job.height, job.k, job.black_is_1, data.size(), job.icc);
+                job.output += data;
+            } else {
+                job.output = std::move(data);
+            }
+        }
+        job.done = true;
+    } catch (const std::exception &) {
+        // Left for PdfImage to extract, or to report the problem
+        job.output.clear();
+    }
+    job.raw = PointerHolder<Buffer>();
+}
+
+static std::vector<py::object> extract_images(py::list plans, unsigned int workers)
+{
+    std::vector<ImageJob> jobs;
+    jobs.reserve(plans.size());
+    for (auto plan : plans)
+        jobs.push_back(image_job(plan.cast<py::dict>()));
+
+    {
+        py::gil_scoped_release release;
+        size_t begin = 0;
+        while (begin < jobs.size()) {
+            size_t end = begin;
+            size_t window = 0;
+            while (end < jobs.size() && (end == begin || window < EXTRACT_WINDOW)) {
+                image_read(jobs[end]);
+                if (jobs[end].raw.getPointer())
+                    window += jobs[end].raw->getSize();
+                ++end;
+            }
+            parallel_for(end - begin, workers, [&](size_t i) {
+                image_extract(jobs[begin + i]);
+            });
+            begin = end;
+        }
+    }
+
+    std::vector<py::object> results;
+    results.reserve(jobs.size());
+    for (auto &job : jobs) {
+        if (job.done)
+            results.push_back(py::bytes(job.output));
+        else
+            results.push_back(py::none());
+    }
+    return results;
+}
+
+// Writes into memory that belongs to someone else, and remembers if there was
+// more data than would fit.
+class Pl_WriteInto : public Pipeline
+{
+public:
+    Pl_WriteInto(const char *identifier, unsigned char *data, size_t size) :
+        Pipeline(identifier, nullptr), data(data), size(size) {}
+    virtual ~Pl_WriteInto() = default;
+
+    void write(unsigned char *buf, size_t len) override
+    {
+        if (len > this->size - this->used) {
+            this->overflow = true;
+            len = this->size - this->used;
+        }
+        if (len > 0)
+            memcpy(this->data + this->used, buf, len);
+        this->used += len;
+    }
+    void finish() override {}
+
+    unsigned char *data;
+    size_t size;
+    size_t used = 0;
+    bool overflow = false;
+};
+
+static size_t read_stream_into(QPDFObjectHandle h, py::buffer buffer,
+    qpdf_stream_decode_level_e decode_level)
+{
+    if (!h.isStream())
+        throw py::type_error("object is not a stream");
+    auto info = buffer.request(true);
+    auto expected_stride = info.itemsize;
+    for (auto dim = info.ndim; dim-- > 0;) {
+        if (info.shape[dim] > 1 && info.strides[dim] != expected_stride)
+            throw py::value_error("buffer must be C-contiguous");
+        expected_stride *= info.shape[dim];
+    }
+
+    Pl_WriteInto into("read into buffer",
+        static_cast<unsigned char *>(info.ptr), info.size * info.itemsize);
+    bool filtered;
+    {
+        py::gil_scoped_release release;
+        filtered = h.pipeStreamData(&into, 0, decode_level, false, false);
+    }
+    if (into.overflow)
+        throw py::value_error("buffer is too small for the decoded stream data");
+    if (!filtered)
+        throw py::value_error("stream data cannot be decoded at this decode level");
+    return into.used;
+}
+
+void init_image(py::module_ &m)
+{
+    m.def("_ccitt_tiff_header",
+        [](uint32_t width, uint32_t height, int k, bool black_is_1,
+                uint32_t data_length, py::bytes icc) {
+            return py::bytes(ccitt_tiff_header(
+                width, height, k, black_is_1, data_length, icc.cast<std::string>()));
+        },
+        "Build a TIFF header for CCITT data. Use pikepdf.PdfImage.",
+        py::arg("width"),
+        py::arg("height"),
+        py::arg("k"),
+        py::arg("black_is_1"),
+        py::arg("data_length"),
+        py::arg("icc")
+    );
+    m.def("_extract_images", extract_images,
+        "Extract images as described by PdfImage. Use pikepdf.PdfImage.extract_many.",
+        py::arg("plans"),
+        py::arg("workers")
+    );
+    m.def("_read_stream_into", read_stream_into,
+        "Decode a stream into a writable buffer. Use pikepdf.PdfImage.read_into.",
+        py::arg("stream"),
+        py::arg("buffer"),
+        py::arg("decode_level")
+    );
+}
@@ -0,0 +1,471 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <qpdf/Buffer.hh>
+#include <qpdf/Pl_Buffer.hh>
+#include <qpdf/Pl_Flate.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+#include <qpdf/QPDFXRefEntry.hh>
+
+#include "pikepdf.h"
+#include "pipeline.h"
+#include "qpdf_state.h"
+
+// An incremental update leaves the original file as it is and appends the
+// objects that changed, followed by a cross-reference section and trailer
+// whose /Prev points to the original cross-reference section.
+//
+// qpdf does not record which objects were modified, and objects nested
+// directly in others have no link back to the object that contains them, so
+// modified objects are found by comparison: each object from the file is
+// unparsed, and compared to the same object read again from the original
+// input by a second QPDF. Stream data is not compared. Streams are always
+// indirect, so pikepdf records the streams whose data it replaced, and the
+// objects it replaced or swapped, instead (see stream_replace_data).
+//
+// After an update is appended to the original file, the Pdf's input source
+// is replaced by one that also returns the update, so that the next update
+// is compared with, and follows, the file as it now is.
+
+constexpr size_t COPY_BLOCK_SIZE = 1024 * 1024;
+
+// How much of the end of the file to search for startxref
+constexpr qpdf_offset_t STARTXREF_SEARCH = 1024;
+
+static std::string read_input(InputSource &input, qpdf_offset_t offset, size_t length)
+{
+    std::string data(length, '\0');
+    input.seek(offset, SEEK_SET);
+    size_t n = 0;
+    while (n < length) {
+        auto got = input.read(&data[n], length - n);
+        if (got == 0)
+            break;
+        n += got;
+    }
+    data.resize(n);
+    return data;
+}
+
+static qpdf_offset_t input_size(InputSource &input)
+{
+    input.seek(0, SEEK_END);
+    return input.tell();
+}
+
+// The offset of the file's last cross-reference section, and whether it is a
+// cross-reference stream
+static std::pair<qpdf_offset_t, bool> find_last_xref(InputSource &input, qpdf_offset_t size)
+{
+    auto start = std::max<qpdf_offset_t>(0, size - STARTXREF_SEARCH);
+    auto tail = read_input(input, start, static_cast<size_t>(size - start));
+    auto pos = tail.rfind("startxref");
+    if (pos == std::string::npos)
+        throw py::value_error("cannot save incrementally: the original file has no startxref");
+    auto digits = tail.find_first_of("0123456789", pos + 9);
+    if (digits == std::string::npos)
+        throw py::value_error("cannot save incrementally: the original file's startxref is invalid");
+    auto offset = static_cast<qpdf_offset_t>(std::stoll(tail.substr(digits, 20)));
+    auto keyword = read_input(input, offset, 4);
+    return std::make_pair(offset, keyword != "xref");
+}
+
+// The original input followed by an update that was appended to the file.
+// The update is kept in memory; the original is read from its own input
+// source, which the Pdf also reads from.
+class AppendedInputSource : public InputSource {
+public:
+    AppendedInputSource(PointerHolder<InputSource> base, qpdf_offset_t base_size,
+        std::string update) :
+        base(base), base_size(base_size), update(std::move(update)) {}
+    virtual ~AppendedInputSource() = default;
+
+    std::string const &getName() const override { return this->base->getName(); }
+
+    qpdf_offset_t tell() override { return this->pos; }
+
+    void seek(qpdf_offset_t offset, int whence) override
+    {
+        if (whence == SEEK_END)
+            offset += this->size();
+        else if (whence == SEEK_CUR)
+            offset += this->pos;
+        if (offset < 0)
+            throw std::runtime_error(this->getName() + ": seek before beginning of file");
+        this->pos = offset;
+    }
+
+    // LCOV_EXCL_START
+    void rewind() override { this->pos = 0; }
+    // LCOV_EXCL_STOP
+
+    size_t read(char *buffer, size_t length) override
+    {
+        this->last_offset = this->pos;
+        size_t n = 0;
+        if (this->pos < this->base_size) {
+            auto want = static_cast<size_t>(
+                std::min<qpdf_offset_t>(length, this->base_size - this->pos));
+            this->base->seek(this->pos, SEEK_SET);
+            while (n < want) {
+                auto got = this->base->read(buffer + n, want - n);
+                if (got == 0)
+                    break;
+                n += got;
+            }
+            this->pos += n;
+            if (n < want)
+                return n;
+        }
+        if (n < length && this->pos < this->size()) {
+            auto at = static_cast<size_t>(this->pos - this->base_size);
+            auto got = std::min(length - n, this->update.size() - at);
+            std::memcpy(buffer + n, this->update.data() + at, got);
+            n += got;
+            this->pos += got;
+        }
+        return n;
+    }
+
+    void unreadCh(char ch) override
+    {
+        if (this->pos > 0)
+            --this->pos;
+    }
+
+    // As BufferInputSource: skip to the end of the next run of EOL
+    // characters, and return the offset of the first of them
+    qpdf_offset_t findAndSkipNextEOL() override
+    {
+        char block[4096];
+        qpdf_offset_t eol = -1;
+        while (true) {
+            auto start = this->pos;
+            auto n = this->read(block, sizeof(block));
+            if (n == 0)
+                return eol >= 0 ? eol : this->pos;
+            for (size_t i = 0; i < n; ++i) {
+                if (block[i] == '\r' || block[i] == '\n') {
+                    if (eol < 0)
+                        eol = start + i;
+                } else if (eol >= 0) {
+                    this->pos = start + i;
+                    return eol;
+                }
+            }
+        }
+    }
+
+private:
+    qpdf_offset_t size() const
+    {
+        return this->base_size + static_cast<qpdf_offset_t>(this->update.size());
+    }
+
+    PointerHolder<InputSource> base;
+    qpdf_offset_t base_size;
+    std::string update;
+    qpdf_offset_t pos = 0;
+};
+
+class UpdateWriter {
+public:
+    UpdateWriter(py::object stream, qpdf_offset_t offset, std::shared_ptr<PdfStats> stats) :
+        out("incremental update", stream, PYTHON_OUTPUT_BLOCK_SIZE, stats), offset(offset) {}
+
+    void write(const std::string &s)
+    {
+        this->write(reinterpret_cast<const unsigned char *>(s.data()), s.size());
+    }
+    void write(const unsigned char *data, size_t size)
+    {
+        this->out.write(const_cast<unsigned char *>(data), size);
+        this->offset += size;
+        if (this->keep)
+            this->kept.append(reinterpret_cast<const char *>(data), size);
+    }
+    void finish() { this->out.finish(); }
+
+    Pl_PythonOutput out;
+    qpdf_offset_t offset;
+    // If set, a copy of what is written is kept
+    bool keep = false;
+    std::string kept;
+};
+
+static void write_object(UpdateWriter &w, QPDFObjectHandle h)
+{
+    auto og = h.getObjGen();
+    w.write(std::to_string(og.getObj()) + " " + std::to_string(og.getGen()) + " obj\n");
+    if (!h.isStream()) {
+        // unparse() would give a reference to the object itself
+        w.write(h.unparseResolved());
+        w.write("\nendobj\n");
+        return;
+    }
+
+    auto dict = h.getDict().shallowCopy();
+    auto data = h.getRawStreamData();
+    auto type = dict.getKey("/Type");
+    bool is_metadata = type.isName() && type.getName() == "/Metadata";
+    if (!dict.hasKey("/Filter") && !is_metadata && data->getSize() > 0) {
+        // As QPDFWriter would with compress_streams=True
+        Pl_Buffer compressed("compressed stream");
+        Pl_Flate flate("compress stream", &compressed, Pl_Flate::a_deflate);
+        flate.write(data->getBuffer(), data->getSize());
+        flate.finish();
+        data = PointerHolder<Buffer>(compressed.getBuffer());
+        dict.replaceKey("/Filter", QPDFObjectHandle::newName("/FlateDecode"));
+        dict.removeKey("/DecodeParms");
+    }
+    dict.replaceKey("/Length",
+        QPDFObjectHandle::newInteger(static_cast<long long>(data->getSize())));
+    w.write(dict.unparseResolved());
+    w.write("\nstream\n");
+    w.write(data->getBuffer(), data->getSize());
+    w.write("\nendstream\nendobj\n");
+}
+
+static bool object_changed(QPDFObjectHandle current, QPDFObjectHandle original,
+    const PdfState &state)
+{
+    if (current.isStream() != original.isStream())
+        return true;
+    if (current.isStream()) {
+        auto og = current.getObjGen();
+        if (state.replaced_streams.count(og))
+            return true;
+        auto dict = current.getDict().unparseResolved();
+        // An appended update may have compressed the stream, so compare with
+        // its dictionary from before that
+        auto appended = state.appended_stream_dicts.find(og);
+        if (appended != state.appended_stream_dicts.end())
+            return dict != appended->second;
+        return dict != original.getDict().unparseResolved();
+    }
+    // Both are indirect, so compare their contents rather than "N G R"
+    return current.unparseResolved() != original.unparseResolved();
+}
+
+static QPDFObjectHandle update_trailer(QPDF &q, long long size, qpdf_offset_t prev)
+{
+    auto trailer = q.getTrailer().shallowCopy();
+    for (auto key : {"/Prev", "/XRefStm", "/Type", "/W", "/Index", "/Filter",
+             "/DecodeParms", "/Length"})
+        trailer.removeKey(key);
+    trailer.replaceKey("/Size", QPDFObjectHandle::newInteger(size));
+    trailer.replaceKey("/Prev", QPDFObjectHandle::newInteger(prev));
+    return trailer;
+}
+
+// Runs of consecutive object numbers, as (first, count)
+static std::vector<std::pair<int, int>> subsections(const std::map<int, qpdf_offset_t> &entries)
+{
+    std::vector<std::pair<int, int>> runs;
+    for (auto const &entry : entries) {
+        if (!runs.empty() && runs.back().first + runs.back().second == entry.first)
+            ++runs.back().second;
+        else
+            runs.emplace_back(entry.first, 1);
+    }
+    return runs;
+}
+
+static void write_xref_table(UpdateWriter &w, const std::map<int, qpdf_offset_t> &offsets,
+    const std::map<int, int> &generations, QPDFObjectHandle trailer)
+{
+    auto xref_offset = w.offset;
+    w.write("xref\n");
+    for (auto const &run : subsections(offsets)) {
+        w.write(std::to_string(run.first) + " " + std::to_string(run.second) + "\n");
+        for (int objid = run.first; objid < run.first + run.second; ++objid) {
+            char entry[21];
+            std::snprintf(entry, sizeof(entry), "%010lld %05d n \n",
+                static_cast<long long>(offsets.at(objid)), generations.at(objid));
+            w.write(std::string(entry, 20));
+        }
+    }
+    w.write("trailer ");
+    w.write(trailer.unparse());
+    w.write("\nstartxref\n" + std::to_string(xref_offset) + "\n%%EOF\n");
+}
+
+static void write_xref_stream(UpdateWriter &w, std::map<int, qpdf_offset_t> offsets,
+    std::map<int, int> generations, QPDFObjectHandle trailer, int xref_objid)
+{
+    auto xref_offset = w.offset;
+    offsets[xref_objid] = xref_offset;
+    generations[xref_objid] = 0;
+    int offset_bytes = xref_offset > 0xffffffffLL ? 8 : 4;
+
+    std::string data;
+    auto put = [&data](unsigned long long value, int bytes) {
+        for (int i = bytes - 1; i >= 0; --i)
+            data += static_cast<char>((value >> (8 * i)) & 0xff);
+    };
+    auto index = QPDFObjectHandle::newArray();
+    for (auto const &run : subsections(offsets)) {
+        index.appendItem(QPDFObjectHandle::newInteger(run.first));
+        index.appendItem(QPDFObjectHandle::newInteger(run.second));
+        for (int objid = run.first; objid < run.first + run.second; ++objid) {
+            put(1, 1);
+            put(static_cast<unsigned long long>(offsets.at(objid)), offset_bytes);
+            put(static_cast<unsigned long long>(generations.at(objid)), 2);
+        }
+    }
+
+    auto w_array = QPDFObjectHandle::newArray();
+    w_array.appendItem(QPDFObjectHandle::newInteger(1));
+    w_array.appendItem(QPDFObjectHandle::newInteger(offset_bytes));
+    w_array.appendItem(QPDFObjectHandle::newInteger(2));
+    trailer.replaceKey("/Size", QPDFObjectHandle::newInteger(xref_objid + 1));
+    trailer.replaceKey("/Type", QPDFObjectHandle::newName("/XRef"));
+    trailer.replaceKey("/W", w_array);
+    trailer.replaceKey("/Index", index);
+    trailer.replaceKey("/Length",
+        QPDFObjectHandle::newInteger(static_cast<long long>(data.size())));
+
+    w.write(std::to_string(xref_objid) + " 0 obj\n");
+    w.write(trailer.unparse());
+    w.write("\nstream\n");
+    w.write(data);
+    w.write("\nendstream\nendobj\n");
+    w.write("startxref\n" + std::to_string(xref_offset) + "\n%%EOF\n");
+}
+
+size_t save_incremental(QPDF &q, py::object stream, bool append)
+{
+    auto &state = pdf_state(q);
+    if (!state.input.getPointer())
+        throw py::value_error("cannot save incrementally: this Pdf was not opened from a file");
+    if (q.isEncrypted())
+        throw py::value_error("cannot save incrementally: encrypted PDFs are not supported");
+    if (state.has_token_filters)
+        throw py::value_error("cannot save incrementally: token filters are attached");
+
+    auto &input = *state.input;
+    auto original_size = input_size(input);
+    auto last_xref = find_last_xref(input, original_size);
+
+    // The objects in the file, including any appended updates, and those
+    // created since, which qpdf numbers after them
+    auto original = make_qpdf();
+    qpdf_basic_settings(*original);
+    original->processInputSource(state.input);
+    std::vector<QPDFObjGen> file_objects;
+    int max_file_objid = 0;
+    for (auto const &entry : original->getXRefTable()) {
+        file_objects.push_back(entry.first);
+        max_file_objid = std::max(max_file_objid, entry.first.getObj());
+    }
+
+    std::vector<QPDFObjectHandle> changed;
+    for (auto const &og : file_objects) {
+        auto before = original->getObjectByObjGen(og);
+        // Cross-reference streams belong to the update that wrote them, and
+        // the Pdf has none for the updates appended since it was opened
+        if (before.isStream() && before.getDict().getKey("/Type").isName() &&
+                before.getDict().getKey("/Type").getName() == "/XRef")
+            continue;
+        auto current = q.getObjectByObjGen(og);
+        if (object_changed(current, before, state))
+            changed.push_back(current);
+    }
+    int last_objid = static_cast<int>(q.getObjectCount());
+    for (int objid = max_file_objid + 1; objid <= last_objid; ++objid) {
+        auto h = q.getObjectByID(objid, 0);
+        if (!h.isNull())
+            changed.push_back(h);
+    }
+    original.reset();
+    if (changed.empty() && append)
+        return 0;
+
+    if (append) {
+        // Appending to the file that was opened: check it is still the same
+        stream.attr("seek")(0, 2);
+        auto stream_size = stream.attr("tell")().cast<qpdf_offset_t>();
+        auto tail_start = std::max<qpdf_offset_t>(0, original_size - STARTXREF_SEARCH);
+        std::string expected_tail;
+        if (stream_size == original_size) {
+            expected_tail = read_input(input, tail_start,
+                static_cast<size_t>(original_size - tail_start));
+            stream.attr("seek")(tail_start);
+        }
+        if (stream_size != original_size ||
+                stream.attr("read")().cast<std::string>() != expected_tail)
+            throw py::value_error(
+                "cannot save incrementally: the file has changed since it was opened");
+        stream.attr("seek")(0, 2);
+    }
+
+    UpdateWriter w(stream, 0, state.stats);
+    char last_byte = '\n';
+    if (append) {
+        w.offset = original_size;
+        w.keep = true;
+        if (original_size > 0)
+            last_byte = read_input(input, original_size - 1, 1).back();
+    } else {
+        std::vector<char> block(COPY_BLOCK_SIZE);
+        input.seek(0, SEEK_SET);
+        while (true) {
+            auto n = input.read(block.data(), block.size());
+            if (n == 0)
+                break;
+            w.write(reinterpret_cast<unsigned char *>(block.data()), n);
+            last_byte = block[n - 1];
+        }
+    }
+    if (changed.empty()) {
+        w.finish();
+        return 0;
+    }
+    if (last_byte != '\n' && last_byte != '\r')
+        w.write("\n");
+
+    std::map<int, qpdf_offset_t> offsets;
+    std::map<int, int> generations;
+    for (auto &h : changed) {
+        auto og = h.getObjGen();
+        offsets[og.getObj()] = w.offset;
+        generations[og.getObj()] = og.getGen();
+        write_object(w, h);
+    }
+
+    auto trailer_size = q.getTrailer().getKey("/Size");
+    long long size = std::max<long long>(last_objid + 1,
+        trailer_size.isInteger() ? trailer_size.getIntValue() : 0);
+    auto trailer = update_trailer(q, size, last_xref.first);
+    if (last_xref.second)
+        write_xref_stream(w, offsets, generations, trailer, static_cast<int>(size));
+    else
+        write_xref_table(w, offsets, generations, trailer);
+    w.finish();
+
+    if (append) {
+        // The file now ends with this update, which the next one must follow
+        for (auto &h : changed) {
+            if (h.isStream())
+                state.appended_stream_dicts[h.getObjGen()] = h.getDict().unparseResolved();
+        }
+        state.replaced_streams.clear();
+        state.input = PointerHolder<InputSource>(
+            new AppendedInputSource(state.input, original_size, std::move(w.kept)));
+    }
+    return changed.size();
+}
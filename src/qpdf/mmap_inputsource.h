@@ -26,6 +26,7 @@
 #include <pybind11/stl.h>
 
 #include "pikepdf.h"
+#include "pdf_stats.h"
 #include "utils.h"
 
 // We could almost subclass BufferInputSource here, except that it expects Buffer
@@ -42,7 +43,8 @@
 class MmapInputSource : public InputSource
 {
 public:
-    MmapInputSource(py::object stream, const std::string& description, bool close_stream) :
+    MmapInputSource(py::object stream, const std::string& description, bool close_stream,
+                    std::shared_ptr<PdfStats> stats = nullptr) :
             InputSource(), stream(stream), close_stream(close_stream)
     {
         py::gil_scoped_acquire acquire;
@@ -70,6 +72,8 @@ public:
             qpdf_buffer.release(),
             false  // own_memory=false
         );
+        // The whole file is mapped at once; the OS pages it in as needed
+        stats_count_read(stats, this->buffer_info->size);
     }
     virtual ~MmapInputSource()
     {
@@ -125,7 +129,9 @@ public:
 
     size_t read(char* buffer, size_t length) override
     {
-        return this->bis->read(buffer, length);
+        auto result = this->bis->read(buffer, length);
+        this->last_offset = this->bis->getLastOffset();
+        return result;
     }
 
     void unreadCh(char ch) override
@@ -6,7 +6,15 @@
  * Copyright (C) 2017, James R. Barlow (https://github.com/jbarlow83/)
  */
 
+#include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
+#include <vector>
 
 #include <qpdf/Constants.h>
 #include <qpdf/Types.h>
@@ -19,6 +27,7 @@
 #include <qpdf/QPDFObjectHandle.hh>
 #include <qpdf/QPDF.hh>
 #include <qpdf/QPDFWriter.hh>
+#include <qpdf/MD5.hh>
 
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -27,6 +36,8 @@
 #include "utils.h"
 
 #include "object_parsers.h"
+#include "pybuffer.h"
+#include "qpdf_state.h"
 
 /*
 Type table
@@ -38,7 +49,7 @@ object is never returned to Python; a Python object is returned instead.
 Adding one of these to a QPDF container type causes the appropriate conversion.
     Boolean <-> bool
     Integer <-> int
-    Real <-> Decimal
+    Real <-> Decimal (or float, if settings.set_real_as_float(True))
     Real <- float
     Null <-> None
 
@@ -55,6 +66,76 @@ needed.
 */
 
 
+py::object float_array_memoryview(FloatArray &&array)
+{
+    auto owner = py::cast(std::move(array));
+    auto view = PyMemoryView_FromObject(owner.ptr());
+    if (!view)
+        throw py::error_already_set();
+    return py::reinterpret_steal<py::object>(view);
+}
+
+// Decoded stream data, exported read-only through the buffer protocol so that
+// a memoryview can keep it alive without copying it
+struct StreamBuffer {
+    PointerHolder<Buffer> buffer;
+};
+
+py::object buffer_memoryview(PointerHolder<Buffer> buffer)
+{
+    auto owner = py::cast(StreamBuffer{buffer});
+    auto view = PyMemoryView_FromObject(owner.ptr());
+    if (!view)
+        throw py::error_already_set();
+    return py::reinterpret_steal<py::object>(view);
+}
+
+py::object array_as_float_array(QPDFObjectHandle h)
+{
+    if (!h.isArray())
+        throw py::type_error("object is not an array");
+    int n_items = h.getArrayNItems();
+    FloatArray result;
+    result.values.reserve(n_items);
+    for (int i = 0; i < n_items; ++i) {
+        auto item = h.getArrayItem(i);
+        if (!item.isNumber())
+            throw py::type_error(
+                std::string("array item ") + std::to_string(i) +
+                std::string(" is not a number: ") + objecthandle_repr(item));
+        result.values.push_back(item.getNumericValue());
+    }
+    return float_array_memoryview(std::move(result));
+}
+
+QPDFObjectHandle array_from_floats(py::object values, uint places)
+{
+    auto new_real = [places](double value) {
+        if (!std::isfinite(value))
+            throw py::value_error("Can't convert NaN or Infinity to PDF real number");
+        return QPDFObjectHandle::newReal(value, places);
+    };
+
+    std::vector<QPDFObjectHandle> items;
+    if (PyObject_CheckBuffer(values.ptr())) {
+        auto info = py::reinterpret_borrow<py::buffer>(values).request();
+        if (info.ndim == 1 && info.format == py::format_descriptor<double>::format()) {
+            auto data = static_cast<const char *>(info.ptr);
+            items.reserve(info.shape[0]);
+            for (py::ssize_t i = 0; i < info.shape[0]; ++i) {
+                double value;
+                memcpy(&value, data + i * info.strides[0], sizeof(double));
+                items.push_back(new_real(value));
+            }
+            return QPDFObjectHandle::newArray(items);
+        }
+    }
+    for (auto item : py::reinterpret_borrow<py::iterable>(values)) {
+        items.push_back(new_real(py::float_(py::reinterpret_borrow<py::object>(item))));
+    }
+    return QPDFObjectHandle::newArray(items);
+}
+
 size_t list_range_check(QPDFObjectHandle h, int index)
 {
     if (!h.isArray())
@@ -67,81 +148,291 @@ size_t list_range_check(QPDFObjectHandle h, int index)
 }
 
 
-bool objecthandle_equal(QPDFObjectHandle self, QPDFObjectHandle other)
+// How indirect objects are compared when they are found inside the objects
+// being compared.
+enum class IndirectCompare {
+    // Objects with the same owner are equal if they are the same object;
+    // otherwise their contents are compared. This is what == does.
+    same_owner,
+    // Contents are always compared.
+    follow,
+    // References are equal only if they are to the same object.
+    reference,
+};
+
+// Compare two objects and everything they contain. Pending pairs of objects
+// are kept on an explicit stack rather than by recursing, and items are
+// visited in place rather than copied out of their containers. Each pair of
+// objects involving an indirect object is compared at most once, which also
+// ends cycles: a pair found again while it is being compared is assumed equal
+// for now, and any difference is found where it is.
+static bool objecthandle_deep_equal(
+    QPDFObjectHandle self, QPDFObjectHandle other, IndirectCompare mode)
 {
-    StackGuard sg(" objecthandle_equal");
-
-    // Uninitialized objects are never equal
-    if (!self.isInitialized() || !other.isInitialized())
-        return false;
-
-    // Indirect objects (objid != 0) with the same obj-gen are equal and same owner
-    // are equal (in fact, they are identical; they reference the same underlying
-    // QPDFObject, even if the handles are different).
-    // This lets us compare deeply nested and cyclic structures without recursing
-    // into them.
-    if (self.getObjectID() != 0
-        && other.getObjectID() != 0
-        && self.getOwningQPDF() == other.getOwningQPDF()) {
-        return self.getObjGen() == other.getObjGen();
-    }
+    using indirect_pair = std::tuple<QPDF *, QPDFObjGen, QPDF *, QPDFObjGen>;
+    std::set<indirect_pair> compared;
+    std::vector<std::pair<QPDFObjectHandle, QPDFObjectHandle>> pending;
+    pending.emplace_back(self, other);
+    bool nested = false;
 
-    // If 'self' is a numeric type, convert both to Decimal objects
-    // and compare them as such.
-    if (self.getTypeCode() == QPDFObject::object_type_e::ot_integer ||
-        self.getTypeCode() == QPDFObject::object_type_e::ot_real ||
-        self.getTypeCode() == QPDFObject::object_type_e::ot_boolean) {
-        try {
-            auto a = decimal_from_pdfobject(self);
-            auto b = decimal_from_pdfobject(other);
-            py::object pyresult = a.attr("__eq__")(b);
-            bool result = pyresult.cast<bool>();
-            return result;
-        } catch (const py::type_error&) {
+    while (!pending.empty()) {
+        auto a = pending.back().first;
+        auto b = pending.back().second;
+        pending.pop_back();
+
+        // Uninitialized objects are never equal
+        if (!a.isInitialized() || !b.isInitialized())
             return false;
+
+        // Indirect objects with the same obj-gen and same owner are identical;
+        // they reference the same underlying QPDFObject, even if the handles
+        // are different.
+        bool a_indirect = a.isIndirect();
+        bool b_indirect = b.isIndirect();
+        if (a_indirect || b_indirect) {
+            bool same_owner = a.getOwningQPDF() == b.getOwningQPDF();
+            if (a_indirect && b_indirect && same_owner) {
+                if (a.getObjGen() == b.getObjGen())
+                    continue;
+                if (mode == IndirectCompare::same_owner)
+                    return false;
+            }
+            if (mode == IndirectCompare::reference && nested)
+                return false;
+            auto key = indirect_pair(
+                a.getOwningQPDF(), a.getObjGen(), b.getOwningQPDF(), b.getObjGen());
+            if (!compared.insert(key).second)
+                continue;
+        }
+        nested = true;
+
+        // If 'a' is a numeric type, compare numerically, as Decimal would.
+        auto type_code = a.getTypeCode();
+        if (type_code == QPDFObject::object_type_e::ot_integer ||
+            type_code == QPDFObject::object_type_e::ot_real ||
+            type_code == QPDFObject::object_type_e::ot_boolean) {
+            if (!numeric_equal(a, b))
+                return false;
+            continue;
+        }
+
+        // Apart from numeric types, disimilar types are never equal
+        if (type_code != b.getTypeCode())
+            return false;
+
+        switch (type_code) {
+            case QPDFObject::object_type_e::ot_null:
+                break; // Both must be null
+            case QPDFObject::object_type_e::ot_name:
+                if (a.getName() != b.getName())
+                    return false;
+                break;
+            case QPDFObject::object_type_e::ot_operator:
+                if (a.getOperatorValue() != b.getOperatorValue())
+                    return false;
+                break;
+            case QPDFObject::object_type_e::ot_string:
+                // We don't know what encoding the string is in
+                // This ensures UTF-16 coded ASCII strings will compare equal to
+                // UTF-8/ASCII coded.
+                if (a.getStringValue() != b.getStringValue() &&
+                    a.getUTF8Value() != b.getUTF8Value())
+                    return false;
+                break;
+            case QPDFObject::object_type_e::ot_array:
+            {
+                int n = a.getArrayNItems();
+                if (n != b.getArrayNItems())
+                    return false;
+                // Pushed in reverse so that items are compared in order
+                for (int i = n - 1; i >= 0; --i)
+                    pending.emplace_back(a.getArrayItem(i), b.getArrayItem(i));
+                break;
+            }
+            case QPDFObject::object_type_e::ot_dictionary:
+            {
+                auto keys = a.getKeys();
+                if (keys != b.getKeys())
+                    return false;
+                for (auto key = keys.rbegin(); key != keys.rend(); ++key)
+                    pending.emplace_back(a.getKey(*key), b.getKey(*key));
+                break;
+            }
+            case QPDFObject::object_type_e::ot_stream:
+            {
+                // == only considers a stream equal to itself
+                if (mode == IndirectCompare::same_owner)
+                    return false;
+                auto raw_a = a.getRawStreamData();
+                auto raw_b = b.getRawStreamData();
+                if (raw_a->getSize() != raw_b->getSize() ||
+                    std::memcmp(raw_a->getBuffer(), raw_b->getBuffer(),
+                        raw_a->getSize()) != 0)
+                    return false;
+                pending.emplace_back(a.getDict(), b.getDict());
+                break;
+            }
+            default:
+                return false;
         }
     }
+    return true;
+}
 
-    // Apart from numeric types, disimilar types are never equal
-    if (self.getTypeCode() != other.getTypeCode())
-        return false;
-
-    switch (self.getTypeCode()) {
-        case QPDFObject::object_type_e::ot_null:
-            return true; // Both must be null
-        case QPDFObject::object_type_e::ot_boolean:
-            return self.getBoolValue() == other.getBoolValue();
-        case QPDFObject::object_type_e::ot_name:
-            return self.getName() == other.getName();
-        case QPDFObject::object_type_e::ot_operator:
-            return self.getOperatorValue() == other.getOperatorValue();
-        case QPDFObject::object_type_e::ot_string:
-        {
-            // We don't know what encoding the string is in
-            // This ensures UTF-16 coded ASCII strings will compare equal to
-            // UTF-8/ASCII coded.
-            return self.getStringValue() == other.getStringValue() ||
-                self.getUTF8Value() == other.getUTF8Value();
+bool objecthandle_equal(QPDFObjectHandle self, QPDFObjectHandle other)
+{
+    return objecthandle_deep_equal(self, other, IndirectCompare::same_owner);
+}
+
+// A 128-bit digest of an object and everything it contains, such that objects
+// that compare equal with follow_indirect have equal digests. Numbers are
+// hashed in canonical form and dictionaries in key order. Each indirect
+// object is hashed once, into a digest of its own that is hashed wherever the
+// object is referenced. A reference to an object that is still being hashed,
+// which is a cycle, is hashed as a marker.
+static py::bytes objecthandle_content_hash(
+    QPDFObjectHandle h, bool stream_data, bool follow_indirect)
+{
+    enum class Step { visit, emit, finish };
+    struct Task {
+        Step step;
+        QPDFObjectHandle h;
+        std::string token;
+    };
+    using indirect_key = std::pair<QPDF *, QPDFObjGen>;
+
+    // The outermost digest is the result; one more is open for each indirect
+    // object being hashed.
+    std::vector<std::unique_ptr<MD5>> digests;
+    std::vector<indirect_key> in_progress;
+    std::map<indirect_key, std::string> finished;
+    digests.push_back(std::make_unique<MD5>());
+
+    auto encode = [&digests](const std::string &token) {
+        // Prefixing the length keeps adjacent tokens from running together
+        auto prefix = std::to_string(token.size()) + ":";
+        digests.back()->encodeDataIncrementally(prefix.data(), prefix.size());
+        digests.back()->encodeDataIncrementally(token.data(), token.size());
+    };
+    auto digest_of = [](MD5 &md5) {
+        MD5::Digest digest;
+        md5.digest(digest);
+        return std::string(reinterpret_cast<char *>(digest), sizeof(digest));
+    };
+
+    std::vector<Task> pending;
+    pending.push_back({Step::visit, h, ""});
+    bool nested = false;
+    while (!pending.empty()) {
+        auto task = std::move(pending.back());
+        pending.pop_back();
+        if (task.step == Step::emit) {
+            encode(task.token);
+            continue;
         }
-        case QPDFObject::object_type_e::ot_array:
-        {
-            // Call operator==() on each element of the arrays, meaning this
-            // recurses into this function
-            return (self.getArrayAsVector() == other.getArrayAsVector());
+        if (task.step == Step::finish) {
+            auto digest = digest_of(*digests.back());
+            finished[in_progress.back()] = digest;
+            digests.pop_back();
+            in_progress.pop_back();
+            encode("R" + digest);
+            continue;
         }
-        case QPDFObject::object_type_e::ot_dictionary:
-        {
-            // Call operator==() on each element of the arrays, meaning this
-            // recurses into this function
-            return (self.getDictAsMap() == other.getDictAsMap());
+
+        auto obj = task.h;
+        if (obj.isIndirect()) {
+            auto og = obj.getObjGen();
+            if (nested && !follow_indirect) {
+                encode("r" + std::to_string(og.getObj()) + " " +
+                    std::to_string(og.getGen()));
+                continue;
+            }
+            auto key = indirect_key(obj.getOwningQPDF(), og);
+            auto found = finished.find(key);
+            if (found != finished.end()) {
+                encode("R" + found->second);
+                continue;
+            }
+            if (std::find(in_progress.begin(), in_progress.end(), key) !=
+                in_progress.end()) {
+                encode("C");
+                continue;
+            }
+            digests.push_back(std::make_unique<MD5>());
+            in_progress.push_back(key);
+            pending.push_back({Step::finish, QPDFObjectHandle(), ""});
+        }
+        nested = true;
+
+        switch (obj.getTypeCode()) {
+            case QPDFObject::object_type_e::ot_null:
+                encode("z");
+                break;
+            case QPDFObject::object_type_e::ot_boolean:
+            case QPDFObject::object_type_e::ot_integer:
+            case QPDFObject::object_type_e::ot_real:
+                encode("N" + numeric_key(obj));
+                break;
+            case QPDFObject::object_type_e::ot_name:
+                encode("n" + obj.getName());
+                break;
+            case QPDFObject::object_type_e::ot_string:
+                encode("s" + obj.getUTF8Value());
+                break;
+            case QPDFObject::object_type_e::ot_operator:
+                encode("o" + obj.getOperatorValue());
+                break;
+            case QPDFObject::object_type_e::ot_inlineimage:
+                encode("i" + obj.getInlineImageValue());
+                break;
+            case QPDFObject::object_type_e::ot_array:
+            {
+                int n = obj.getArrayNItems();
+                encode("a" + std::to_string(n));
+                for (int i = n - 1; i >= 0; --i)
+                    pending.push_back({Step::visit, obj.getArrayItem(i), ""});
+                break;
+            }
+            case QPDFObject::object_type_e::ot_dictionary:
+            {
+                auto keys = obj.getKeys();
+                encode("d" + std::to_string(keys.size()));
+                for (auto key = keys.rbegin(); key != keys.rend(); ++key) {
+                    pending.push_back({Step::visit, obj.getKey(*key), ""});
+                    pending.push_back({Step::emit, QPDFObjectHandle(), "k" + *key});
+                }
+                break;
+            }
+            case QPDFObject::object_type_e::ot_stream:
+            {
+                encode("S");
+                if (stream_data) {
+                    auto raw = obj.getRawStreamData();
+                    encode("D" + std::to_string(raw->getSize()));
+                    digests.back()->encodeDataIncrementally(
+                        reinterpret_cast<char *>(raw->getBuffer()), raw->getSize());
+                }
+                pending.push_back({Step::visit, obj.getDict(), ""});
+                break;
+            }
+            default:
+                throw py::value_error("can't hash an uninitialized object");
         }
-        default:
-            break;
     }
-    return false;
+    return py::bytes(digest_of(*digests.front()));
 }
 
 
+// Equivalent to hash(bytes(s)), without creating the bytes object
+static Py_hash_t bytes_hash(const std::string &s)
+{
+#if defined(PYPY_VERSION)
+    return py::hash(py::bytes(s));
+#else
+    return _Py_HashBytes(s.data(), static_cast<Py_ssize_t>(s.size()));
+#endif
+}
+
 bool operator==(QPDFObjectHandle self, QPDFObjectHandle other)
 {
     // A lot of functions in QPDFObjectHandle are not tagged const where they
@@ -187,6 +478,7 @@ void object_set_key(QPDFObjectHandle h, std::string const& key, QPDFObjectHandle
     QPDFObjectHandle dict = h.isStream() ? h.getDict() : h;
 
     // A stream dictionary has no owner, so use the stream object in this comparison
+    page_tree_edit(dict, key);
     dict.replaceKey(key, value);
 }
 
@@ -204,6 +496,7 @@ void object_del_key(QPDFObjectHandle h, std::string const& key)
     if (!dict.hasKey(key))
         throw py::key_error(key);
 
+    page_tree_edit(dict, key);
     dict.removeKey(key);
 }
 
@@ -213,6 +506,46 @@ std::pair<int, int> object_get_objgen(QPDFObjectHandle h)
     return std::pair<int, int>(objgen.getObj(), objgen.getGen());
 }
 
+// The stream's /Filter as it appears in Pdf.stats(): filter names separated by
+// spaces, or "none"
+static std::string stream_filter_key(QPDFObjectHandle h)
+{
+    auto filter = h.getDict().getKey("/Filter");
+    if (filter.isName())
+        return filter.getName();
+    std::string key;
+    if (filter.isArray()) {
+        for (auto &item : filter.getArrayAsVector()) {
+            if (!key.empty())
+                key += ' ';
+            key += item.isName() ? item.getName() : "?";
+        }
+    }
+    return key.empty() ? "none" : key;
+}
+
+// Decode a stream's data, with any registered decoders, counting it in the
+// owning Pdf's stats
+static PointerHolder<Buffer> stream_decoded_data(
+    QPDFObjectHandle h, qpdf_stream_decode_level_e decode_level)
+{
+    auto buf = stream_decode_registered(h, decode_level);
+    if (!buf.getPointer())
+        buf = h.getStreamData(decode_level);
+    auto owner = h.getOwningQPDF();
+    if (owner) {
+        auto length = h.getDict().getKey("/Length");
+        auto stats = pdf_state(*owner).stats;
+        std::lock_guard<std::mutex> lock(stats->filters_mutex);
+        auto &filter_stats = stats->filters[stream_filter_key(h)];
+        filter_stats.streams += 1;
+        if (length.isInteger() && length.getIntValue() > 0)
+            filter_stats.bytes_in += length.getIntValue();
+        filter_stats.bytes_out += buf->getSize();
+    }
+    return buf;
+}
+
 
 void init_object(py::module_& m)
 {
@@ -244,10 +577,78 @@ void init_object(py::module_& m)
             );
         });
 
+    py::class_<FloatArray>(m, "_FloatArray", py::buffer_protocol())
+        .def_buffer([](FloatArray &fa) -> py::buffer_info {
+            return py::buffer_info(
+                fa.values.data(),
+                sizeof(double),
+                py::format_descriptor<double>::format(),
+                1,
+                { fa.values.size() },
+                { sizeof(double) }
+            );
+        });
+
+    py::class_<StreamBuffer>(m, "_StreamBuffer", py::buffer_protocol())
+        .def_buffer([](StreamBuffer &sb) -> py::buffer_info {
+            return py::buffer_info(
+                sb.buffer->getBuffer(),
+                sizeof(unsigned char),
+                py::format_descriptor<unsigned char>::format(),
+                1,
+                { sb.buffer->getSize() },
+                { sizeof(unsigned char) },
+                true // readonly
+            );
+        });
+
+    py::class_<ContentStreamInstructions>(m, "ContentStreamInstructionList",
+            "A parsed content stream, which creates Python objects for each instruction only when accessed.")
+        .def("__len__", &ContentStreamInstructions::size)
+        .def("__getitem__",
+            [](const ContentStreamInstructions &csi, py::ssize_t index) {
+                if (index < 0)
+                    index += csi.size();
+                if (index < 0 || static_cast<size_t>(index) >= csi.size())
+                    throw py::index_error("instruction index out of range");
+                return csi.instruction(index);
+            }
+        )
+        .def("__getitem__",
+            [](const ContentStreamInstructions &csi, py::slice slice) {
+                size_t start, stop, step, slicelength;
+                if (!slice.compute(csi.size(), &start, &stop, &step, &slicelength))
+                    throw py::error_already_set();
+                auto PdfInlineImage = ContentStreamInstructions::inline_image_type();
+                py::list result;
+                for (size_t i = 0; i < slicelength; ++i) {
+                    result.append(csi.instruction(start, PdfInlineImage));
+                    start += step;
+                }
+                return result;
+            }
+        )
+        .def("__iter__",
+            [](py::object self) {
+                return py::reinterpret_steal<py::iterator>(PySeqIter_New(self.ptr()));
+            }
+        )
+        .def("operator_name", &ContentStreamInstructions::operator_name,
+            "Return the operator of an instruction as a string, without creating its operands.",
+            py::arg("index")
+        )
+        .def("__repr__",
+            [](const ContentStreamInstructions &csi) {
+                return std::string("<pikepdf._qpdf.ContentStreamInstructionList len=")
+                    + std::to_string(csi.size())
+                    + std::string(">");
+            }
+        );
+
     py::bind_vector<std::vector<QPDFObjectHandle>>(m, "_ObjectList");
     py::bind_map<std::map<std::string, QPDFObjectHandle>>(m, "_ObjectMapping");
 
-    py::class_<QPDFObjectHandle>(m, "Object")
+    py::class_<QPDFObjectHandle, ObjectHolder<QPDFObjectHandle>>(m, "Object")
         .def_property_readonly("_type_code", &QPDFObjectHandle::getTypeCode)
         .def_property_readonly("_type_name", &QPDFObjectHandle::getTypeName)
         .def("is_owned_by",
@@ -263,18 +664,77 @@ void init_object(py::module_& m)
             },
             "Test if two objects are owned by the same :class:`pikepdf.Pdf`."
         )
+        .def("deep_equal",
+            [](QPDFObjectHandle &self, QPDFObjectHandle &other, bool follow_indirect) {
+                return objecthandle_deep_equal(self, other,
+                    follow_indirect ? IndirectCompare::follow : IndirectCompare::reference);
+            },
+            R"~~~(
+            Compare this object to another, and everything they contain.
+
+            Unlike ``==``, which considers two indirect objects in the same
+            :class:`pikepdf.Pdf` equal only if they are the same object, and
+            a stream equal only to itself, this compares contents, including
+            the raw data of streams. The objects may belong to different
+            Pdfs. The comparison does not recurse, so deeply nested and
+            cyclic structures are compared without reaching Python's
+            recursion limit.
+
+            Args:
+                other: The object to compare to.
+                follow_indirect: If ``True``, indirect objects found inside
+                    this object are compared by their contents. If
+                    ``False``, they are equal only if they are the same
+                    object.
+
+            .. versionadded:: 2.13
+            )~~~",
+            py::arg("other"),
+            py::kw_only(),
+            py::arg("follow_indirect") = true
+        )
+        .def("content_hash", &objecthandle_content_hash,
+            R"~~~(
+            Return a 128-bit digest of this object and everything it contains.
+
+            The digest is a 16-byte ``bytes``, which may be used as a
+            dictionary key, for example to find duplicate objects or to
+            cache work done on them. It depends only on the contents of the
+            object, not on which :class:`pikepdf.Pdf` it belongs to, and is
+            the same from one run to the next. Objects that are equal by
+            :meth:`deep_equal` with the same ``follow_indirect`` have equal
+            digests, except that a structure that refers back to itself may
+            hash differently depending on where it is entered.
+
+            The digest is not cryptographically secure, and two different
+            objects may, rarely, have the same digest.
+
+            Args:
+                stream_data: If ``True``, the raw data of streams is hashed
+                    along with their dictionaries. Otherwise, streams with
+                    the same dictionary have the same digest.
+                follow_indirect: If ``True``, indirect objects found inside
+                    this object are hashed by their contents. If ``False``,
+                    only their object and generation numbers are hashed.
+
+            .. versionadded:: 2.13
+            )~~~",
+            py::kw_only(),
+            py::arg("stream_data") = false,
+            py::arg("follow_indirect") = true
+        )
         .def_property_readonly("is_indirect", &QPDFObjectHandle::isIndirect)
         .def("__repr__", &objecthandle_repr)
         .def("__hash__",
-            [](QPDFObjectHandle &self) -> py::int_ {
+            [](QPDFObjectHandle &self) -> Py_hash_t {
                 //Objects which compare equal must have the same hash value
                 switch (self.getTypeCode()) {
                     case QPDFObject::object_type_e::ot_string:
-                        return py::hash(py::bytes(self.getUTF8Value()));
+                        return bytes_hash(self.getUTF8Value());
                     case QPDFObject::object_type_e::ot_name:
-                        return py::hash(py::bytes(self.getName()));
+                        return bytes_hash(self.getName());
                     case QPDFObject::object_type_e::ot_operator:
-                        return py::hash(py::bytes(self.getOperatorValue()));
+                        return bytes_hash(self.getOperatorValue());
                     case QPDFObject::object_type_e::ot_array:
                     case QPDFObject::object_type_e::ot_dictionary:
                     case QPDFObject::object_type_e::ot_stream:
@@ -499,6 +959,23 @@ void init_object(py::module_& m)
             }
         )
         .def("as_list", &QPDFObjectHandle::getArrayAsVector)
+        .def("as_float_array", &array_as_float_array,
+            R"~~~(
+            Convert an array of numbers to a contiguous array of doubles.
+
+            The whole array is converted in one pass, without creating a Python
+            object for each element. The result is a ``memoryview`` of format
+            ``'d'``, which may be passed to ``numpy.asarray()`` or
+            ``array.array('d', ...)`` without further copying. It is a copy of
+            the array's values; changing it does not change the PDF.
+
+            Raises:
+                TypeError: If the object is not an array, or any element is
+                    not an integer or real number.
+
+            .. versionadded:: 2.13
+            )~~~"
+        )
         .def("as_dict", &QPDFObjectHandle::getDictAsMap)
         .def("__iter__",
             [](QPDFObjectHandle h) -> py::iterable {
@@ -546,7 +1023,7 @@ void init_object(py::module_& m)
                 if (h.isName())
                     return py::bytes(h.getName());
                 if (h.isStream()) {
-                    PointerHolder<Buffer> buf = h.getStreamData();
+                    PointerHolder<Buffer> buf = stream_decoded_data(h, qpdf_dl_generalized);
                     // py::bytes will make a copy of the buffer, so releasing is fine
                     return py::bytes((const char*)buf->getBuffer(), buf->getSize());
                 }
@@ -565,6 +1042,8 @@ void init_object(py::module_& m)
         .def("__setitem__",
             [](QPDFObjectHandle &h, int index, QPDFObjectHandle &value) {
                 size_t u_index = list_range_check(h, index);
+                page_tree_edit(h.getArrayItem(u_index));
+                page_tree_edit(value);
                 h.setArrayItem(u_index, value);
             }
         )
@@ -572,12 +1051,15 @@ void init_object(py::module_& m)
             [](QPDFObjectHandle &h, int index, py::object pyvalue) {
                 size_t u_index = list_range_check(h, index);
                 auto value = objecthandle_encode(pyvalue);
+                page_tree_edit(h.getArrayItem(u_index));
+                page_tree_edit(value);
                 h.setArrayItem(u_index, value);
             }
         )
         .def("__delitem__",
             [](QPDFObjectHandle &h, int index) {
                 size_t u_index = list_range_check(h, index);
+                page_tree_edit(h.getArrayItem(u_index));
                 h.eraseItem(u_index);
             }
         )
@@ -590,6 +1072,7 @@ void init_object(py::module_& m)
         .def("append",
             [](QPDFObjectHandle &h, py::object pyitem) {
                 auto item = objecthandle_encode(pyitem);
+                page_tree_edit(item);
                 return h.appendItem(item);
             },
             "Append another object to an array; fails if the object is not an array."
@@ -597,7 +1080,9 @@ void init_object(py::module_& m)
         .def("extend",
             [](QPDFObjectHandle &h, py::iterable iter) {
                 for (auto item: iter) {
-                    h.appendItem(objecthandle_encode(item));
+                    auto value = objecthandle_encode(item);
+                    page_tree_edit(value);
+                    h.appendItem(value);
                 }
             },
             "Extend a pikepdf.Array with an iterable of other objects."
@@ -607,7 +1092,7 @@ void init_object(py::module_& m)
         )
         .def("get_stream_buffer",
             [](QPDFObjectHandle &h, qpdf_stream_decode_level_e decode_level) {
-                PointerHolder<Buffer> phbuf = h.getStreamData(decode_level);
+                PointerHolder<Buffer> phbuf = stream_decoded_data(h, decode_level);
                 return phbuf;
             },
             "Return a buffer protocol buffer describing the decoded stream.",
@@ -620,9 +1105,36 @@ void init_object(py::module_& m)
             },
             "Return a buffer protocol buffer describing the raw, encoded stream"
         )
+        .def("read_memoryview",
+            [](QPDFObjectHandle &h, qpdf_stream_decode_level_e decode_level) {
+                return buffer_memoryview(stream_decoded_data(h, decode_level));
+            },
+            R"~~~(
+            Decode the stream and return a read-only :class:`memoryview` of
+            the decoded data.
+
+            Unlike :meth:`read_bytes`, the decoded data is not copied into a
+            new ``bytes`` object. The memory is released when the memoryview
+            and anything derived from it are released.
+
+            .. versionadded:: 2.13
+            )~~~",
+            py::arg("decode_level") = qpdf_dl_generalized
+        )
+        .def("read_raw_memoryview",
+            [](QPDFObjectHandle &h) {
+                return buffer_memoryview(h.getRawStreamData());
+            },
+            R"~~~(
+            Return a read-only :class:`memoryview` of the stream's raw,
+            encoded data, without copying it.
+
+            .. versionadded:: 2.13
+            )~~~"
+        )
         .def("read_bytes",
             [](QPDFObjectHandle &h, qpdf_stream_decode_level_e decode_level) {
-                PointerHolder<Buffer> buf = h.getStreamData(decode_level);
+                PointerHolder<Buffer> buf = stream_decoded_data(h, decode_level);
                 // py::bytes will make a copy of the buffer, so releasing is fine
                 return py::bytes((const char*)buf->getBuffer(), buf->getSize());
             },
@@ -638,11 +1150,10 @@ void init_object(py::module_& m)
             "Read the content stream associated with this object without decoding"
         )
         .def("_write",
-            [](QPDFObjectHandle &h, py::bytes data, py::object filter, py::object decode_parms) {
-                std::string sdata = data;
+            [](QPDFObjectHandle &h, py::buffer data, py::object filter, py::object decode_parms) {
                 QPDFObjectHandle h_filter = objecthandle_encode(filter);
                 QPDFObjectHandle h_decode_parms = objecthandle_encode(decode_parms);
-                h.replaceStreamData(sdata, h_filter, h_decode_parms);
+                stream_replace_data(h, data, h_filter, h_decode_parms);
             },
             R"~~~(
             Low level write/replace stream data without argument checking. Use .write().
@@ -722,6 +1233,14 @@ void init_object(py::module_& m)
                 return og.getInstructions();
             }
         )
+        .def("_parse_page_contents_lazy",
+            [](QPDFObjectHandle &h, std::string const& whitelist) {
+                OperandGrouper og(whitelist);
+                h.parsePageContents(&og);
+                return og.takeInstructions();
+            },
+            py::keep_alive<0, 1>() // operands may belong to the page's owner
+        )
         .def_static("_parse_stream",
             &QPDFObjectHandle::parseContentStream,
             "Helper for parsing PDF content stream; use ``pikepdf.parse_content_stream``."
@@ -737,6 +1256,18 @@ void init_object(py::module_& m)
                 return og.getInstructions();
             }
         )
+        .def_static("_parse_stream_lazy",
+            [](QPDFObjectHandle &h, std::string const& whitelist) {
+                OperandGrouper og(whitelist);
+                QPDFObjectHandle::parseContentStream(h, &og);
+                if (!og.getWarning().empty()) {
+                    auto warn = py::module_::import("warnings").attr("warn");
+                    warn(og.getWarning());
+                }
+                return og.takeInstructions();
+            },
+            py::keep_alive<0, 1>() // operands may belong to the stream's owner
+        )
         .def("unparse",
             [](QPDFObjectHandle &h, bool resolved) -> py::bytes {
                 if (resolved)
@@ -821,6 +1352,11 @@ void init_object(py::module_& m)
         },
         "Construct a PDF String object from UTF-8 bytes."
     );
+    m.def("_new_array_from_floats", &array_from_floats,
+        "Construct a PDF Array of real numbers from a buffer of doubles or an iterable of numbers.",
+        py::arg("values"),
+        py::arg("places") = 0
+    );
     m.def("_new_array",
         [](py::iterable iterable) {
             return QPDFObjectHandle::newArray(array_builder(iterable));
@@ -833,10 +1369,22 @@ void init_object(py::module_& m)
         },
         "Construct a PDF Dictionary from a mapping of PDF objects or Python types that can be coerced to PDF objects."
     );
+    m.def("_new_dictionaries",
+        [](py::iterable records, py::object templ, py::object owner) {
+            auto h = templ.is_none() ? QPDFObjectHandle::newNull() : templ.cast<QPDFObjectHandle>();
+            QPDF *q = owner.is_none() ? nullptr : &owner.cast<QPDF &>();
+            return dictionaries_from_records(records, h, q);
+        },
+        "Construct many PDF Dictionaries from mappings. Use pikepdf.Dictionary.from_records.",
+        py::arg("records"),
+        py::arg("template") = py::none(),
+        py::arg("owner") = py::none()
+    );
     m.def("_new_stream",
-        [](std::shared_ptr<QPDF> owner, py::bytes data) {
-            std::string s = data;
-            return QPDFObjectHandle::newStream(owner.get(), data); // This makes a copy of the data
+        [](std::shared_ptr<QPDF> owner, py::buffer data) {
+            auto h = QPDFObjectHandle::newStream(owner.get());
+            stream_replace_data(h, data, QPDFObjectHandle::newNull(), QPDFObjectHandle::newNull());
+            return h;
         },
         "Construct a PDF Stream object from binary data",
         py::keep_alive<0, 1>() // returned object references the owner
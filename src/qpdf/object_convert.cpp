@@ -13,6 +13,8 @@
 #include <vector>
 #include <map>
 #include <cmath>
+#include <cctype>
+#include <unordered_map>
 
 #include <qpdf/Constants.h>
 #include <qpdf/Types.h>
@@ -31,6 +33,27 @@
 #include "pikepdf.h"
 
 extern uint DECIMAL_PRECISION;
+extern bool REAL_AS_FLOAT;
+
+// Looking up decimal.Decimal on every conversion is surprisingly expensive, so
+// we look it up once. The references are deliberately leaked, since they must
+// remain valid until the interpreter shuts down. These are protected by the GIL;
+// if two threads race to initialize them, the worst case is a leaked reference.
+static py::handle decimal_type()
+{
+    static PyObject *decimal = nullptr;
+    if (!decimal)
+        decimal = py::module_::import("decimal").attr("Decimal").release().ptr();
+    return decimal;
+}
+
+static py::handle decimal_getcontext()
+{
+    static PyObject *getcontext = nullptr;
+    if (!getcontext)
+        getcontext = py::module_::import("decimal").attr("getcontext").release().ptr();
+    return getcontext;
+}
 
 
 std::map<std::string, QPDFObjectHandle>
@@ -68,7 +91,7 @@ array_builder(const py::iterable iter)
 class DecimalPrecision {
 public:
     DecimalPrecision(uint calc_precision) :
-        decimal_context(py::module_::import("decimal").attr("getcontext")()),
+        decimal_context(decimal_getcontext()()),
         saved_precision(decimal_context.attr("prec").cast<uint>())
     {
         decimal_context.attr("prec") = calc_precision;
@@ -91,11 +114,12 @@ QPDFObjectHandle objecthandle_encode(const py::handle handle)
         return QPDFObjectHandle::newNull();
 
     // Ensure that when we return QPDFObjectHandle/pikepdf.Object to the Py
-    // environment, that we can recover it
-    try {
+    // environment, that we can recover it. Check the type first, since a
+    // failed cast throws, and exceptions are expensive.
+    if (py::isinstance<QPDFObjectHandle>(handle)) {
         auto as_qobj = handle.cast<QPDFObjectHandle>();
         return as_qobj;
-    } catch (const py::cast_error&) {}
+    }
 
     // Special-case booleans since pybind11 coerces nonzero integers to boolean
     if (py::isinstance<py::bool_>(handle)) {
@@ -103,15 +127,7 @@ QPDFObjectHandle objecthandle_encode(const py::handle handle)
         return QPDFObjectHandle::newBool(as_bool);
     }
 
-    auto decimal_module = py::module_::import("decimal");
-    auto Decimal = decimal_module.attr("Decimal");
-    if (py::isinstance(handle, Decimal)) {
-        DecimalPrecision dp(DECIMAL_PRECISION);
-        auto rounded = py::reinterpret_steal<py::object>(PyNumber_Positive(handle.ptr()));
-        if (! rounded.attr("is_finite")().cast<bool>())
-            throw py::value_error("Can't convert NaN or Infinity to PDF real number");
-        return QPDFObjectHandle::newReal(py::str(rounded));
-    } else if (py::isinstance<py::int_>(handle)) {
+    if (py::isinstance<py::int_>(handle)) {
         auto as_int = handle.cast<long long>();
         return QPDFObjectHandle::newInteger(as_int);
     } else if (py::isinstance<py::float_>(handle)) {
@@ -119,6 +135,12 @@ QPDFObjectHandle objecthandle_encode(const py::handle handle)
         if (! std::isfinite(as_double))
             throw py::value_error("Can't convert NaN or Infinity to PDF real number");
         return QPDFObjectHandle::newReal(as_double);
+    } else if (py::isinstance(handle, decimal_type())) {
+        DecimalPrecision dp(DECIMAL_PRECISION);
+        auto rounded = py::reinterpret_steal<py::object>(PyNumber_Positive(handle.ptr()));
+        if (! rounded.attr("is_finite")().cast<bool>())
+            throw py::value_error("Can't convert NaN or Infinity to PDF real number");
+        return QPDFObjectHandle::newReal(py::str(rounded));
     }
 
     py::object obj = py::reinterpret_borrow<py::object>(handle);
@@ -149,9 +171,162 @@ QPDFObjectHandle objecthandle_encode(const py::handle handle)
 }
 
 
+// Encodes many records, which usually share their keys and value types, for
+// Dictionary.from_records. The exact types that records usually contain are
+// dispatched directly, without the isinstance checks of objecthandle_encode,
+// and each key is converted to a name once; since records typically use the
+// same str objects as keys, keys are cached by identity, holding a reference
+// so the address cannot be reused. Values are put straight into each new
+// dictionary rather than into a std::map that qpdf would then copy.
+class RecordEncoder {
+public:
+    RecordEncoder() :
+        object_type(reinterpret_cast<PyTypeObject *>(py::type::of<QPDFObjectHandle>().ptr()))
+    {
+    }
+
+    QPDFObjectHandle record(py::handle record, QPDFObjectHandle const &templ);
+    QPDFObjectHandle encode(py::handle value);
+
+private:
+    struct Key {
+        py::object ref;
+        std::string name;
+    };
+    std::string const &key_name(PyObject *key, bool top_level);
+    void fill(QPDFObjectHandle &dict, PyObject *mapping, bool top_level);
+
+    PyTypeObject *object_type;
+    std::unordered_map<PyObject *, Key> keys;
+};
+
+std::string const &RecordEncoder::key_name(PyObject *key, bool top_level)
+{
+    auto found = this->keys.find(key);
+    if (found == this->keys.end()) {
+        auto ref = py::reinterpret_borrow<py::object>(key);
+        auto name = ref.cast<std::string>();
+        found = this->keys.emplace(key, Key{ref, name}).first;
+    }
+    auto const &name = found->second.name;
+    if (top_level && (name.size() < 2 || name[0] != '/'))
+        throw py::key_error("Dictionary created from strings must begin with '/'");
+    return name;
+}
+
+void RecordEncoder::fill(QPDFObjectHandle &dict, PyObject *mapping, bool top_level)
+{
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(mapping, &pos, &key, &value))
+        dict.replaceKey(this->key_name(key, top_level), this->encode(value));
+}
+
+QPDFObjectHandle RecordEncoder::encode(py::handle value)
+{
+    auto type = Py_TYPE(value.ptr());
+    if (value.is_none())
+        return QPDFObjectHandle::newNull();
+    if (type == this->object_type)
+        return value.cast<QPDFObjectHandle>();
+    if (type == &PyBool_Type)
+        return QPDFObjectHandle::newBool(value.ptr() == Py_True);
+    if (type == &PyLong_Type) {
+        int overflow = 0;
+        auto as_int = PyLong_AsLongLongAndOverflow(value.ptr(), &overflow);
+        if (!overflow && !(as_int == -1 && PyErr_Occurred()))
+            return QPDFObjectHandle::newInteger(as_int);
+        PyErr_Clear();
+        return objecthandle_encode(value); // Raises the usual error
+    }
+    if (type == &PyFloat_Type) {
+        auto as_double = PyFloat_AS_DOUBLE(value.ptr());
+        if (!std::isfinite(as_double))
+            throw py::value_error("Can't convert NaN or Infinity to PDF real number");
+        return QPDFObjectHandle::newReal(as_double);
+    }
+    if (type == &PyUnicode_Type) {
+        Py_ssize_t size;
+        auto utf8 = PyUnicode_AsUTF8AndSize(value.ptr(), &size);
+        if (!utf8)
+            throw py::error_already_set();
+        return QPDFObjectHandle::newUnicodeString(std::string(utf8, size));
+    }
+    if (type == &PyBytes_Type) {
+        return QPDFObjectHandle::newString(
+            std::string(PyBytes_AS_STRING(value.ptr()), PyBytes_GET_SIZE(value.ptr())));
+    }
+    if (type == &PyDict_Type) {
+        StackGuard sg(" RecordEncoder::encode");
+        auto dict = QPDFObjectHandle::newDictionary();
+        this->fill(dict, value.ptr(), false);
+        return dict;
+    }
+    if (type == &PyList_Type || type == &PyTuple_Type) {
+        StackGuard sg(" RecordEncoder::encode");
+        auto seq = py::reinterpret_borrow<py::sequence>(value);
+        std::vector<QPDFObjectHandle> items;
+        items.reserve(seq.size());
+        for (auto item : seq)
+            items.push_back(this->encode(item));
+        return QPDFObjectHandle::newArray(items);
+    }
+    return objecthandle_encode(value);
+}
+
+// Copy a template and the direct containers in it, so that the dictionaries
+// made from it do not share them
+static QPDFObjectHandle copy_direct(QPDFObjectHandle h, bool top_level = false)
+{
+    if (!top_level && (h.isIndirect() || !(h.isArray() || h.isDictionary())))
+        return h;
+    StackGuard sg(" copy_direct");
+    auto copy = h.shallowCopy();
+    if (copy.isArray()) {
+        for (int i = 0; i < copy.getArrayNItems(); ++i)
+            copy.setArrayItem(i, copy_direct(copy.getArrayItem(i)));
+    } else {
+        for (auto const &key : copy.getKeys())
+            copy.replaceKey(key, copy_direct(copy.getKey(key)));
+    }
+    return copy;
+}
+
+QPDFObjectHandle RecordEncoder::record(py::handle record, QPDFObjectHandle const &templ)
+{
+    py::object mapping = py::reinterpret_borrow<py::object>(record);
+    if (!PyDict_Check(mapping.ptr())) {
+        if (!py::hasattr(mapping, "keys"))
+            throw py::type_error("records must be mappings");
+        mapping = py::dict(mapping);
+    }
+    auto dict = templ.isNull() ? QPDFObjectHandle::newDictionary() : copy_direct(templ, true);
+    this->fill(dict, mapping.ptr(), true);
+    return dict;
+}
+
+std::vector<QPDFObjectHandle> dictionaries_from_records(
+    py::iterable records, QPDFObjectHandle templ, QPDF *owner)
+{
+    if (!templ.isNull() && (!templ.isDictionary() || templ.isStream()))
+        throw py::type_error("template must be a pikepdf.Dictionary");
+    RecordEncoder encoder;
+    std::vector<QPDFObjectHandle> result;
+    auto hint = PyObject_LengthHint(records.ptr(), 0);
+    if (hint < 0)
+        throw py::error_already_set();
+    result.reserve(static_cast<size_t>(hint));
+    for (auto record : records) {
+        auto dict = encoder.record(record, templ);
+        result.push_back(owner ? owner->makeIndirectObject(dict) : dict);
+    }
+    return result;
+}
+
+
 py::object decimal_from_pdfobject(QPDFObjectHandle h)
 {
-    auto decimal_constructor = py::module_::import("decimal").attr("Decimal");
+    auto decimal_constructor = decimal_type();
 
     if (h.getTypeCode() == QPDFObject::object_type_e::ot_integer) {
         auto value = h.getIntValue();
@@ -165,3 +340,122 @@ py::object decimal_from_pdfobject(QPDFObjectHandle h)
     }
     throw py::type_error("object has no Decimal() representation");
 }
+
+
+py::object real_from_pdfobject(QPDFObjectHandle h)
+{
+    if (REAL_AS_FLOAT)
+        return py::float_(h.getNumericValue());
+    return decimal_from_pdfobject(h);
+}
+
+
+// Put a PDF number in a canonical form, so that numbers can be compared
+// exactly without converting them to Decimal: an optional minus sign, the
+// integer part without leading zeros, and the fractional part without trailing
+// zeros. PDF numbers never use exponents. Returns false if the string is not
+// in the plain form we expect, e.g. a real created from a Decimal in exponent
+// notation.
+static bool canonical_number(const std::string &s, std::string &result)
+{
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+        negative = (s[pos] == '-');
+        ++pos;
+    }
+    size_t int_begin = pos;
+    while (pos < s.size() && isdigit(static_cast<unsigned char>(s[pos])))
+        ++pos;
+    size_t int_end = pos;
+    size_t frac_begin = pos, frac_end = pos;
+    if (pos < s.size() && s[pos] == '.') {
+        frac_begin = ++pos;
+        while (pos < s.size() && isdigit(static_cast<unsigned char>(s[pos])))
+            ++pos;
+        frac_end = pos;
+    }
+    if (pos != s.size() || (int_end == int_begin && frac_end == frac_begin))
+        return false;
+
+    while (int_begin < int_end && s[int_begin] == '0')
+        ++int_begin;
+    while (frac_end > frac_begin && s[frac_end - 1] == '0')
+        --frac_end;
+
+    result.clear();
+    if (int_begin == int_end && frac_begin == frac_end) {
+        result = "0"; // Zero, including negative zero
+        return true;
+    }
+    if (negative)
+        result += '-';
+    if (int_begin == int_end)
+        result += '0';
+    else
+        result.append(s, int_begin, int_end - int_begin);
+    if (frac_begin != frac_end) {
+        result += '.';
+        result.append(s, frac_begin, frac_end - frac_begin);
+    }
+    return true;
+}
+
+static bool number_string(QPDFObjectHandle h, std::string &result)
+{
+    switch (h.getTypeCode()) {
+    case QPDFObject::object_type_e::ot_integer:
+        result = std::to_string(h.getIntValue());
+        return true;
+    case QPDFObject::object_type_e::ot_boolean:
+        result = h.getBoolValue() ? "1" : "0";
+        return true;
+    case QPDFObject::object_type_e::ot_real:
+        return canonical_number(h.getRealValue(), result);
+    default:
+        return false;
+    }
+}
+
+// Compare two numeric objects by exact value, as Decimal would. Returns false
+// if other is not a number.
+bool numeric_equal(QPDFObjectHandle self, QPDFObjectHandle other)
+{
+    auto is_integral = [](QPDFObjectHandle h) {
+        return h.isInteger() || h.isBool();
+    };
+    auto integral_value = [](QPDFObjectHandle h) -> long long {
+        return h.isBool() ? h.getBoolValue() : h.getIntValue();
+    };
+
+    if (!other.isNumber() && !other.isBool())
+        return false;
+    if (is_integral(self) && is_integral(other))
+        return integral_value(self) == integral_value(other);
+
+    std::string a, b;
+    if (number_string(self, a) && number_string(other, b))
+        return a == b;
+
+    // Unusual real number syntax - let Decimal sort it out
+    auto pyresult = decimal_from_pdfobject(self).attr("__eq__")(decimal_from_pdfobject(other));
+    return pyresult.cast<bool>();
+}
+
+// A string for a numeric object that is the same for all numbers that
+// numeric_equal() considers equal, for hashing.
+std::string numeric_key(QPDFObjectHandle h)
+{
+    std::string result;
+    if (number_string(h, result))
+        return result;
+
+    auto value = decimal_from_pdfobject(h);
+    if (value.attr("is_zero")().cast<bool>())
+        return "0";
+    auto plain = py::str("{:f}").attr("format")(value.attr("normalize")());
+    auto s = plain.cast<std::string>();
+    if (canonical_number(s, result))
+        return result;
+    return s;
+}
@@ -0,0 +1,116 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "pikepdf.h"
+#include "object_iterator.h"
+
+static std::string name_filter(py::object name, const char *what)
+{
+    if (name.is_none())
+        return "";
+    if (py::isinstance<QPDFObjectHandle>(name)) {
+        auto h = name.cast<QPDFObjectHandle>();
+        if (h.isName())
+            return h.getName();
+    } else if (py::isinstance<py::str>(name)) {
+        auto s = name.cast<std::string>();
+        if (s.size() > 1 && s[0] == '/')
+            return s;
+    }
+    throw py::value_error(std::string(what) + " must be a pikepdf.Name or a str beginning with '/'");
+}
+
+ObjectIterator::ObjectIterator(std::shared_ptr<QPDF> q, py::object type_code,
+    py::object type, py::object subtype, py::object stream)
+    : qpdf(q)
+{
+    if (!type_code.is_none()) {
+        this->filter_type_code = true;
+        this->type_code = type_code.cast<QPDFObject::object_type_e>();
+    }
+    this->type = name_filter(type, "type");
+    this->subtype = name_filter(subtype, "subtype");
+    if (!stream.is_none())
+        this->stream = stream.cast<bool>() ? 1 : 0;
+
+    // Only the object numbers are kept. Asking qpdf for all objects, or even
+    // the object count, resolves every object in the file first.
+    auto xref = q->getXRefTable();
+    this->file_objects.reserve(xref.size());
+    for (auto const &entry : xref)
+        this->file_objects.push_back(entry.first);
+}
+
+bool ObjectIterator::matches(QPDFObjectHandle &h) const
+{
+    if (this->filter_type_code && h.getTypeCode() != this->type_code)
+        return false;
+    bool is_stream = h.isStream();
+    if (this->stream != -1 && is_stream != (this->stream == 1))
+        return false;
+    if (this->type.empty() && this->subtype.empty())
+        return true;
+
+    QPDFObjectHandle dict;
+    if (is_stream)
+        dict = h.getDict();
+    else if (h.isDictionary())
+        dict = h;
+    else
+        return false;
+    auto name_is = [&dict](const char *key, const std::string &expected) {
+        if (expected.empty())
+            return true;
+        auto value = dict.getKey(key);
+        return value.isName() && value.getName() == expected;
+    };
+    return name_is("/Type", this->type) && name_is("/Subtype", this->subtype);
+}
+
+QPDFObjectHandle ObjectIterator::next()
+{
+    while (this->pos < this->file_objects.size()) {
+        auto og = this->file_objects[this->pos++];
+        auto h = this->qpdf->getObjectByObjGen(og);
+        if (!h.isNull() && this->matches(h))
+            return h;
+    }
+    if (!this->counted_new_objects) {
+        // By now every object in the file has been resolved, so counting
+        // them resolves nothing new. New objects are numbered consecutively
+        // after all others.
+        this->counted_new_objects = true;
+        int max_file_objid = 0;
+        for (auto const &og : this->file_objects)
+            max_file_objid = std::max(max_file_objid, og.getObj());
+        this->next_new_objid = max_file_objid + 1;
+        this->last_new_objid = static_cast<int>(this->qpdf->getObjectCount());
+    }
+    while (this->next_new_objid <= this->last_new_objid) {
+        auto h = this->qpdf->getObjectByID(this->next_new_objid++, 0);
+        if (!h.isNull() && this->matches(h))
+            return h;
+    }
+    throw py::stop_iteration();
+}
+
+void init_object_iterator(py::module_ &m)
+{
+    py::class_<ObjectIterator>(m, "_ObjectIterator")
+        .def("__iter__",
+            [](ObjectIterator &it) -> ObjectIterator & {
+                return it;
+            },
+            py::return_value_policy::reference_internal
+        )
+        .def("__next__", &ObjectIterator::next);
+}
@@ -0,0 +1,54 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFObjGen.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include "pikepdf.h"
+
+void init_object_iterator(py::module_ &m);
+
+// Iterates over the indirect objects of a Pdf in object order, resolving them
+// one at a time, and returns only those that match its filters. Null objects,
+// which include free and missing objects, are never returned. Unlike
+// QPDF::getAllObjects(), no vector of every object is built, and only the
+// matching objects are returned to Python.
+class ObjectIterator {
+public:
+    ObjectIterator(std::shared_ptr<QPDF> q, py::object type_code, py::object type,
+        py::object subtype, py::object stream);
+
+    QPDFObjectHandle next();
+
+public:
+    std::shared_ptr<QPDF> qpdf;
+
+private:
+    bool matches(QPDFObjectHandle &h) const;
+
+    // Objects in the xref table, then those created since the file was
+    // opened, which qpdf numbers after them
+    std::vector<QPDFObjGen> file_objects;
+    size_t pos = 0;
+    bool counted_new_objects = false;
+    int next_new_objid = 0;
+    int last_new_objid = 0;
+
+    bool filter_type_code = false;
+    QPDFObject::object_type_e type_code = QPDFObject::object_type_e::ot_uninitialized;
+    std::string type;
+    std::string subtype;
+    int stream = -1; // -1 for either, or 0 or 1
+};
@@ -8,6 +8,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <iterator>
+#include <set>
 #include <sstream>
 
 #include <pybind11/pybind11.h>
@@ -43,15 +48,193 @@ public:
 };
 
 
+// The operators defined by the PDF reference manual, Annex A. Operators are
+// stored as an index into this table; anything else (invalid or nonstandard
+// operators) is stored separately.
+const char *const CONTENT_STREAM_OPERATORS[] = {
+    "b", "B", "b*", "B*", "BDC", "BI", "BMC", "BT", "BX", "c", "cm", "CS", "cs",
+    "d", "d0", "d1", "Do", "DP", "EI", "EMC", "ET", "EX", "f", "F", "f*", "G",
+    "g", "gs", "h", "i", "ID", "j", "J", "K", "k", "l", "m", "M", "MP", "n",
+    "q", "Q", "re", "RG", "rg", "ri", "s", "S", "SC", "sc", "SCN", "scn", "sh",
+    "T*", "Tc", "Td", "TD", "Tf", "Tj", "TJ", "TL", "Tm", "Tr", "Ts", "Tw", "Tz",
+    "v", "w", "W", "W*", "y", "'", "\"",
+};
+constexpr uint32_t N_CONTENT_STREAM_OPERATORS =
+    sizeof(CONTENT_STREAM_OPERATORS) / sizeof(CONTENT_STREAM_OPERATORS[0]);
+
+// Pseudo-operator for a complete inline image (BI ... ID ... EI)
+constexpr uint32_t OPCODE_INLINE_IMAGE = N_CONTENT_STREAM_OPERATORS;
+// Opcodes from here on refer to ContentStreamInstructions::other_operators
+constexpr uint32_t OPCODE_OTHER = N_CONTENT_STREAM_OPERATORS + 1;
+constexpr uint32_t OPCODE_NONE = UINT32_MAX;
+
+// Perfect hash of the standard operators, which are all 1-3 characters long.
+// The multiplier is found on first use, by searching for one that maps every
+// operator to a different slot.
+class OperatorTable {
+public:
+    static const OperatorTable &instance()
+    {
+        static const OperatorTable table;
+        return table;
+    }
+
+    uint32_t opcode(const std::string &op) const
+    {
+        if (op.empty() || op.size() > 3)
+            return OPCODE_NONE;
+        auto key = pack(op);
+        auto slot = this->slots[this->hash(key)];
+        if (slot != OPCODE_NONE && this->keys[slot] == key)
+            return slot;
+        return OPCODE_NONE;
+    }
+
+private:
+    static constexpr uint32_t TABLE_BITS = 10;
+
+    OperatorTable()
+    {
+        for (uint32_t i = 0; i < N_CONTENT_STREAM_OPERATORS; ++i)
+            this->keys[i] = pack(CONTENT_STREAM_OPERATORS[i]);
+        for (this->multiplier = 0x9E3779B1u; ; this->multiplier += 2) {
+            std::fill(std::begin(this->slots), std::end(this->slots), OPCODE_NONE);
+            bool collision = false;
+            for (uint32_t i = 0; i < N_CONTENT_STREAM_OPERATORS && !collision; ++i) {
+                auto &slot = this->slots[this->hash(this->keys[i])];
+                collision = (slot != OPCODE_NONE);
+                slot = i;
+            }
+            if (!collision)
+                break;
+        }
+    }
+
+    static uint32_t pack(const std::string &op)
+    {
+        uint32_t key = static_cast<uint32_t>(op.size()) << 24;
+        for (size_t i = 0; i < op.size(); ++i)
+            key |= static_cast<uint32_t>(static_cast<unsigned char>(op[i])) << (8 * i);
+        return key;
+    }
+
+    uint32_t hash(uint32_t key) const
+    {
+        return (key * this->multiplier) >> (32 - TABLE_BITS);
+    }
+
+    uint32_t multiplier;
+    uint32_t keys[N_CONTENT_STREAM_OPERATORS];
+    uint32_t slots[1 << TABLE_BITS];
+};
+
+
+// A parsed content stream, stored compactly as a structure of arrays: one
+// opcode per instruction, and the operands of all instructions in one shared
+// pool. Python objects are only created when an instruction is accessed.
+//
+// For an inline image, the first operand is the image data, and the remaining
+// operands are the image's metadata (the tokens between BI and ID).
+class ContentStreamInstructions {
+public:
+    ContentStreamInstructions() : operand_offsets{0} {}
+
+    size_t size() const
+    {
+        return this->opcodes.size();
+    }
+
+    void add(uint32_t opcode, const std::vector<QPDFObjectHandle> &operands)
+    {
+        this->opcodes.push_back(opcode);
+        this->operand_pool.insert(this->operand_pool.end(), operands.begin(), operands.end());
+        this->operand_offsets.push_back(static_cast<uint32_t>(this->operand_pool.size()));
+    }
+
+    void add_other(const std::string &op, const std::vector<QPDFObjectHandle> &operands)
+    {
+        this->other_operators.push_back(op);
+        this->add(OPCODE_OTHER + static_cast<uint32_t>(this->other_operators.size() - 1), operands);
+    }
+
+    std::string operator_name(size_t index) const
+    {
+        auto opcode = this->opcodes.at(index);
+        if (opcode < N_CONTENT_STREAM_OPERATORS)
+            return CONTENT_STREAM_OPERATORS[opcode];
+        if (opcode == OPCODE_INLINE_IMAGE)
+            return "INLINE IMAGE";
+        return this->other_operators.at(opcode - OPCODE_OTHER);
+    }
+
+    static py::object inline_image_type()
+    {
+        return py::module_::import("pikepdf").attr("PdfInlineImage");
+    }
+
+    py::tuple instruction(size_t index) const
+    {
+        return this->instruction(index, inline_image_type());
+    }
+
+    py::tuple instruction(size_t index, const py::object &PdfInlineImage) const
+    {
+        auto begin = this->operand_pool.begin() + this->operand_offsets.at(index);
+        auto end = this->operand_pool.begin() + this->operand_offsets.at(index + 1);
+        auto op = QPDFObjectHandle::newOperator(this->operator_name(index));
+
+        if (this->opcodes[index] == OPCODE_INLINE_IMAGE) {
+            auto kwargs = py::dict();
+            kwargs["image_data"] = *begin;
+            kwargs["image_object"] = std::vector<QPDFObjectHandle>(begin + 1, end);
+            auto iimage = PdfInlineImage(**kwargs);
+
+            // Package as list with single element for consistency
+            auto iimage_list = py::list();
+            iimage_list.append(iimage);
+            return py::make_tuple(iimage_list, op);
+        }
+
+        py::list operand_list;
+        for (auto it = begin; it != end; ++it)
+            operand_list.append(*it);
+        return py::make_tuple(operand_list, op);
+    }
+
+    py::list instructions() const
+    {
+        auto PdfInlineImage = inline_image_type();
+        py::list result;
+        for (size_t i = 0; i < this->size(); ++i)
+            result.append(this->instruction(i, PdfInlineImage));
+        return result;
+    }
+
+private:
+    std::vector<uint32_t> opcodes;
+    std::vector<uint32_t> operand_offsets;
+    std::vector<QPDFObjectHandle> operand_pool;
+    std::vector<std::string> other_operators;
+};
+
+
 class OperandGrouper : public QPDFObjectHandle::ParserCallbacks {
 public:
     OperandGrouper(const std::string& operators)
         : parsing_inline_image(false), count(0)
     {
+        auto &table = OperatorTable::instance();
         std::istringstream f(operators);
         std::string s;
         while (std::getline(f, s, ' ')) {
-            this->whitelist.insert(s);
+            if (s.empty())
+                continue;
+            this->filtering = true;
+            auto opcode = table.opcode(s);
+            if (opcode != OPCODE_NONE)
+                this->allowed.set(opcode);
+            else
+                this->allowed_other.insert(s);
         }
     }
 
@@ -60,20 +243,13 @@ public:
         this->count++;
         if (obj.getTypeCode() == QPDFObject::object_type_e::ot_operator) {
             std::string op = obj.getOperatorValue();
+            auto opcode = OperatorTable::instance().opcode(op);
 
             // If we have a whitelist and this operator is not on the whitelist,
             // discard it and all the tokens we collected
-            if (!this->whitelist.empty()) {
-                if (op[0] == 'q' || op[0] == 'Q') {
-                    // We have token with multiple stack push/pops
-                    if (this->whitelist.count("q") == 0 && this->whitelist.count("Q") == 0) {
-                        this->tokens.clear();
-                        return;
-                    }
-                } else if (this->whitelist.count(op) == 0) {
-                    this->tokens.clear();
-                    return;
-                }
+            if (this->filtering && !this->is_allowed(op, opcode)) {
+                this->tokens.clear();
+                return;
             }
             if (op == "BI") {
                 this->parsing_inline_image = true;
@@ -81,29 +257,20 @@ public:
                 if (op == "ID") {
                     this->inline_metadata = this->tokens;
                 } else if (op == "EI") {
-                    auto PdfInlineImage = py::module_::import("pikepdf").attr("PdfInlineImage");
-                    auto kwargs = py::dict();
-                    kwargs["image_data"] = this->tokens.at(0);
-                    kwargs["image_object"] = this->inline_metadata;
-                    auto iimage = PdfInlineImage(**kwargs);
-
-                    // Package as list with single element for consistency
-                    auto iimage_list = py::list();
-                    iimage_list.append(iimage);
-
-                    auto instruction = py::make_tuple(
-                        iimage_list,
-                        QPDFObjectHandle::newOperator("INLINE IMAGE")
-                    );
-                    this->instructions.append(instruction);
+                    std::vector<QPDFObjectHandle> operands;
+                    operands.reserve(1 + this->inline_metadata.size());
+                    operands.push_back(this->tokens.at(0));
+                    operands.insert(operands.end(),
+                        this->inline_metadata.begin(), this->inline_metadata.end());
+                    this->result.add(OPCODE_INLINE_IMAGE, operands);
 
                     this->parsing_inline_image = false;
                     this->inline_metadata.clear();
                 }
+            } else if (opcode != OPCODE_NONE) {
+                this->result.add(opcode, this->tokens);
             } else {
-                py::list operand_list = py::cast(this->tokens);
-                auto instruction = py::make_tuple(operand_list, obj);
-                this->instructions.append(instruction);
+                this->result.add_other(op, this->tokens);
             }
             this->tokens.clear();
         } else {
@@ -119,7 +286,12 @@ public:
 
     py::list getInstructions() const
     {
-        return this->instructions;
+        return this->result.instructions();
+    }
+
+    ContentStreamInstructions takeInstructions()
+    {
+        return std::move(this->result);
     }
 
     std::string getWarning() const
@@ -128,11 +300,25 @@ public:
     }
 
 private:
-    std::set<std::string> whitelist;
+    bool is_allowed(const std::string &op, uint32_t opcode) const
+    {
+        if (op[0] == 'q' || op[0] == 'Q') {
+            // We have token with multiple stack push/pops
+            auto &table = OperatorTable::instance();
+            return this->allowed.test(table.opcode("q")) || this->allowed.test(table.opcode("Q"));
+        }
+        if (opcode != OPCODE_NONE)
+            return this->allowed.test(opcode);
+        return this->allowed_other.count(op) > 0;
+    }
+
+    bool filtering = false;
+    std::bitset<N_CONTENT_STREAM_OPERATORS> allowed;
+    std::set<std::string> allowed_other;
     std::vector<QPDFObjectHandle> tokens;
     bool parsing_inline_image;
     std::vector<QPDFObjectHandle> inline_metadata;
-    py::list instructions;
+    ContentStreamInstructions result;
     uint count;
     std::string warning;
 };
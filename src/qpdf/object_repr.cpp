@@ -13,12 +13,20 @@
  * even though repr() is const throughout.
  *
  * References are used for functions that are just passing handles around.
- * objecthandle_repr_inner cannot cannot use references because it calls itself.
+ *
+ * The repr of a container is written by ReprWriter, which does not recurse,
+ * and stops at the depth, item and length limits set by
+ * settings.set_repr_limits(), so that repr() of a large object graph, such as
+ * a page tree, takes bounded time and memory.
  */
 
+#include <algorithm>
+#include <iterator>
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <set>
+#include <vector>
 
 #include <qpdf/Constants.h>
 #include <qpdf/Types.h>
@@ -127,21 +135,104 @@ std::string objecthandle_repr_typename_and_value(QPDFObjectHandle h)
 }
 
 
-static
-std::string objecthandle_repr_inner(QPDFObjectHandle h, uint depth, std::set<QPDFObjGen>* visited, bool* pure_expr)
+// Writes the repr of a non-scalar object into a single string, using an
+// explicit stack of pending work instead of recursing, within the limits of
+// REPR_LIMITS. Parts of the object left out because of the limits are
+// replaced with markers, and make the result not a pure expression.
+class ReprWriter
 {
-    StackGuard sg(" objecthandle_repr_inner");
-    std::ostringstream ss;
+public:
+    ReprWriter(std::string &out) : out(out), limits(REPR_LIMITS)
+    {
+        this->out.reserve(this->limits.length ? std::min<size_t>(this->limits.length, 65536) : 4096);
+    }
+
+    // Returns true if the output is a pure Python expression
+    bool write(QPDFObjectHandle h)
+    {
+        this->pending.push_back(Task{h, "", 0, 0});
+        while (!this->pending.empty()) {
+            if (this->limits.length && this->out.size() > this->limits.length) {
+                // Cut at the start of a UTF-8 sequence
+                size_t cut = this->limits.length;
+                while (cut > 0 && (static_cast<unsigned char>(this->out[cut]) & 0xC0) == 0x80)
+                    --cut;
+                this->out.resize(cut);
+                this->out += "<...>";
+                this->pure_expr = false;
+                break;
+            }
+            auto task = std::move(this->pending.back());
+            this->pending.pop_back();
+            if (task.h.isInitialized())
+                this->visit(task.h, task.indent, task.level);
+            else
+                this->out += task.text;
+        }
+        return this->pure_expr;
+    }
+
+private:
+    struct Task {
+        QPDFObjectHandle h; // Object to write, or if uninitialized...
+        std::string text; // ...text to write
+        uint indent;
+        uint level;
+    };
+
+    void push_text(std::string text)
+    {
+        this->pending.push_back(Task{QPDFObjectHandle(), std::move(text), 0, 0});
+    }
+    void push_object(QPDFObjectHandle h, uint indent, uint level)
+    {
+        this->pending.push_back(Task{h, "", indent, level});
+    }
+
+    // Number of items of a container of size n to write, before the marker
+    size_t shown(size_t n) const
+    {
+        return this->limits.items ? std::min(n, this->limits.items) : n;
+    }
+
+    std::string more(size_t n, size_t shown)
+    {
+        this->pure_expr = false;
+        return "<... " + std::to_string(n - shown) + " more>";
+    }
+
+    bool too_deep(uint level)
+    {
+        if (this->limits.depth && level >= this->limits.depth) {
+            this->pure_expr = false;
+            return true;
+        }
+        return false;
+    }
+
+    void visit(QPDFObjectHandle h, uint indent, uint level);
+
+    std::string &out;
+    ReprLimits limits;
+    std::vector<Task> pending;
+    std::set<QPDFObjGen> visited;
+    bool pure_expr = true;
+};
+
+void ReprWriter::visit(QPDFObjectHandle h, uint indent, uint level)
+{
+    auto &ss = this->out;
 
     if (!h.isScalar()) {
-        if (visited->count(h.getObjGen()) > 0) {
-            *pure_expr = false;
-            ss << "<.get_object(" << h.getObjGen().getObj() << ", " << h.getObjGen().getGen() << ")>";
-            return ss.str();
+        if (this->visited.count(h.getObjGen()) > 0) {
+            this->pure_expr = false;
+            ss += "<.get_object(" + std::to_string(h.getObjGen().getObj()) + ", " +
+                std::to_string(h.getObjGen().getGen()) + ")>";
+            return;
         }
 
         if (!(h.getObjGen() == QPDFObjGen(0, 0)))
-            visited->insert(h.getObjGen());
+            this->visited.insert(h.getObjGen());
     }
 
     switch (h.getTypeCode()) {
@@ -151,75 +242,87 @@ std::string objecthandle_repr_inner(QPDFObjectHandle h, uint depth, std::set<QPD
     case QPDFObject::object_type_e::ot_real:
     case QPDFObject::object_type_e::ot_name:
     case QPDFObject::object_type_e::ot_string:
-        ss << objecthandle_scalar_value(h);
+        ss += objecthandle_scalar_value(h);
         break;
     case QPDFObject::object_type_e::ot_operator:
-        ss << objecthandle_repr_typename_and_value(h);
+        ss += objecthandle_repr_typename_and_value(h);
         break;
     case QPDFObject::object_type_e::ot_inlineimage:
         // LCOV_EXCL_START
         // Inline image objects are automatically promoted to higher level objects
         // in parse_content_stream, so objects of this type should not be returned
         // directly.
-        ss << objecthandle_pythonic_typename(h);
-        ss << "(";
-        ss << "data=<...>";
-        ss << ")";
+        ss += objecthandle_pythonic_typename(h);
+        ss += "(data=<...>)";
         break;
         // LCOV_EXCL_STOP
     case QPDFObject::object_type_e::ot_array:
-        ss << "[";
-        {
-            bool first = true;
-            ss << " ";
-            for (auto item: h.getArrayAsVector()) {
-                if (!first) ss << ", ";
-                first = false;
-                ss << objecthandle_repr_inner(item, depth, visited, pure_expr);
-            }
-            ss << " ";
+    {
+        if (this->too_deep(level)) {
+            ss += "[ <...> ]";
+            break;
+        }
+        ss += "[ ";
+        size_t n = h.getArrayNItems();
+        size_t shown = this->shown(n);
+        // Pushed in reverse, so they are written in order
+        this->push_text(" ]");
+        if (shown < n)
+            this->push_text(", " + this->more(n, shown));
+        for (size_t i = shown; i-- > 0;) {
+            this->push_object(h.getArrayItem(static_cast<int>(i)), indent, level + 1);
+            if (i > 0)
+                this->push_text(", ");
         }
-        ss << "]";
         break;
+    }
     case QPDFObject::object_type_e::ot_dictionary:
-        ss << "{"; // This will end the line
-        {
-            bool first = true;
-            ss << "\n";
-            for (auto item: h.getDictAsMap()) {
-                if (!first) ss << ",\n";
-                first = false;
-                ss << std::string((depth + 1) * 2, ' '); // Indent each line
-                if (item.first == "/Parent" && item.second.isPagesObject()) {
-                    // Don't visit /Parent keys since that just puts every page on the repr() of a single page
-                    ss << std::quoted(item.first) << ": <reference to /Pages>";
-                } else {
-                    ss << std::quoted(item.first) << ": " << objecthandle_repr_inner(item.second, depth + 1, visited, pure_expr);
-                }
+    {
+        if (this->too_deep(level)) {
+            ss += "{ <...> }";
+            break;
+        }
+        ss += "{\n"; // This will end the line
+        std::string item_indent((indent + 1) * 2, ' '); // Indent each line
+        auto keys = h.getKeys();
+        size_t n = keys.size();
+        size_t shown = this->shown(n);
+
+        this->push_text("\n" + std::string(indent * 2, ' ') + "}"); // Restore previous indent level
+        if (shown < n)
+            this->push_text(",\n" + item_indent + this->more(n, shown));
+        auto last = keys.begin();
+        std::advance(last, shown);
+        size_t i = shown;
+        for (auto it = std::make_reverse_iterator(last); it != keys.rend(); ++it) {
+            auto &key = *it;
+            auto value = h.getKey(key);
+            std::ostringstream quoted;
+            quoted << std::quoted(key);
+            if (key == "/Parent" && value.isPagesObject()) {
+                // Don't visit /Parent keys since that just puts every page on the repr() of a single page
+                this->push_text(": <reference to /Pages>");
+            } else {
+                this->push_object(value, indent + 1, level + 1);
+                this->push_text(": ");
             }
-            ss << "\n";
+            this->push_text((--i > 0 ? ",\n" : "") + item_indent + quoted.str());
         }
-        ss << std::string(depth * 2, ' '); // Restore previous indent level
-        ss << "}";
         break;
+    }
     case QPDFObject::object_type_e::ot_stream:
-        *pure_expr = false;
-        ss << objecthandle_pythonic_typename(h);
-        ss << "(";
-        ss << "stream_dict=";
-        ss << objecthandle_repr_inner(h.getDict(), depth + 1, visited, pure_expr);
-        ss << ", ";
-        ss << "data=<...>";
-        ss << ")";
+        this->pure_expr = false;
+        ss += objecthandle_pythonic_typename(h);
+        ss += "(stream_dict=";
+        this->push_text(", data=<...>)");
+        this->push_object(h.getDict(), indent + 1, level + 1);
         break;
     default:
         // LCOV_EXCL_START
-        ss << "Unexpected QPDF object type value: " << h.getTypeCode();
+        ss += "Unexpected QPDF object type value: " + std::to_string(h.getTypeCode());
         break;
         // LCOV_EXCL_STOP
     }
-
-    return ss.str();
 }
 
 std::string objecthandle_repr(QPDFObjectHandle h)
@@ -230,17 +333,15 @@ std::string objecthandle_repr(QPDFObjectHandle h)
         return objecthandle_repr_typename_and_value(h);
     }
 
-    std::set<QPDFObjGen> visited;
-    bool pure_expr = true;
-    std::string inner = objecthandle_repr_inner(h, 0, &visited, &pure_expr);
     std::string output;
-
-    if (h.isScalar() || h.isDictionary() || h.isArray()) {
-        output = objecthandle_pythonic_typename(h) + "(" + inner + ")";
-    } else {
-        output = inner;
+    bool wrap = h.isDictionary() || h.isArray();
+    if (wrap)
+        output += objecthandle_pythonic_typename(h) + "(";
+    bool pure_expr = ReprWriter(output).write(h);
+    if (wrap)
+        output += ")";
+    else
         pure_expr = false;
-    }
 
     if (pure_expr) {
         // The output contains no external or parent objects so this object
@@ -248,5 +349,7 @@ std::string objecthandle_repr(QPDFObjectHandle h)
         return output;
     }
     // Output cannot be fully described in a Python expression
-    return std::string("<") + output + ">";
+    output.insert(0, "<");
+    output += ">";
+    return output;
 }
@@ -0,0 +1,276 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFNameTreeObjectHelper.hh>
+#include <qpdf/QPDFObjGen.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "qpdf_state.h"
+
+// The outline of a Pdf, read in one pass without recursing, for
+// pikepdf.models.Outline to create OutlineItems from as they are needed.
+//
+// The tree is read as Outline would read it: each level is followed through
+// /Next until an object that has already been seen, and levels deeper than
+// max_depth are not read. The page each item's destination refers to is found
+// through the page index cache. Each item also records whether the subtree
+// below it is already exactly as Outline would write it back, so that writing
+// can leave untouched subtrees alone.
+
+struct OutlineNode {
+    QPDFObjectHandle obj;
+    std::vector<size_t> children;
+    size_t end = 0; // One past the last of this node's descendants
+    bool closed = false;
+    bool cut = false; // Children not read because of a loop or max_depth
+    bool clean = false;
+    long long visible = 0; // Descendants shown when this node is open
+    long long page = -1;
+};
+
+class OutlineIndex {
+public:
+    OutlineIndex(std::shared_ptr<QPDF> q, int max_depth) : qpdf(q)
+    {
+        auto outlines = q->getRoot().getKey("/Outlines");
+        if (outlines.isDictionary())
+            this->read(outlines.getKey("/First"), max_depth);
+        for (size_t i = this->nodes.size(); i-- > 0;)
+            this->check(i);
+    }
+
+    py::object reoccurred() const
+    {
+        if (!this->found_loop)
+            return py::none();
+        return py::make_tuple(this->loop_objgen.getObj(), this->loop_objgen.getGen());
+    }
+
+    OutlineNode &node(size_t i)
+    {
+        if (i >= this->nodes.size())
+            throw py::index_error("outline node out of range");
+        return this->nodes[i];
+    }
+
+    std::vector<std::pair<int, int>> descendants(size_t i)
+    {
+        auto &n = this->node(i);
+        std::vector<std::pair<int, int>> result;
+        for (size_t d = i + 1; d < n.end; ++d) {
+            auto og = this->nodes[d].obj.getObjGen();
+            result.emplace_back(og.getObj(), og.getGen());
+        }
+        return result;
+    }
+
+public:
+    std::shared_ptr<QPDF> qpdf;
+    std::vector<OutlineNode> nodes; // In the order Outline reads them
+    std::vector<size_t> top;
+
+private:
+    void read(QPDFObjectHandle first, int max_depth);
+    void check(size_t i);
+    long long destination_page(QPDFObjectHandle obj);
+
+    bool found_loop = false;
+    QPDFObjGen loop_objgen;
+    std::unique_ptr<QPDFNameTreeObjectHelper> dests_tree;
+};
+
+void OutlineIndex::read(QPDFObjectHandle first, int max_depth)
+{
+    struct Level {
+        QPDFObjectHandle next; // The next item to read on this level
+        long long parent;      // -1 for the top level
+        int depth;
+    };
+    std::vector<Level> levels;
+    levels.push_back(Level{first, -1, 0});
+    std::set<QPDFObjGen> visited;
+
+    while (!levels.empty()) {
+        auto current = levels.back().next;
+        auto parent = levels.back().parent;
+        auto depth = levels.back().depth;
+        if (!current.isDictionary() || current.getKeys().empty()) {
+            // The end of this level: its parent has been read completely
+            if (parent >= 0)
+                this->nodes[parent].end = this->nodes.size();
+            levels.pop_back();
+            continue;
+        }
+        auto og = current.getObjGen();
+        if (!visited.insert(og).second) {
+            if (!this->found_loop) {
+                this->found_loop = true;
+                this->loop_objgen = og;
+            }
+            if (parent >= 0) {
+                this->nodes[parent].cut = true;
+                this->nodes[parent].end = this->nodes.size();
+            }
+            levels.pop_back();
+            continue;
+        }
+
+        size_t index = this->nodes.size();
+        this->nodes.emplace_back();
+        auto &node = this->nodes.back();
+        node.obj = current;
+        node.page = this->destination_page(current);
+        if (parent >= 0)
+            this->nodes[parent].children.push_back(index);
+        else
+            this->top.push_back(index);
+        levels.back().next = current.getKey("/Next");
+
+        auto first_child = current.getKey("/First");
+        if (first_child.isNull()) {
+            node.end = index + 1;
+        } else if (depth < max_depth) {
+            auto count = current.getKey("/Count");
+            node.closed = count.isInteger() && count.getIntValue() < 0;
+            levels.push_back(Level{first_child, static_cast<long long>(index), depth + 1});
+        } else {
+            node.cut = true;
+            node.end = index + 1;
+        }
+    }
+}
+
+// Decide whether writing node i back would change the structure below it
+void OutlineIndex::check(size_t i)
+{
+    auto &node = this->nodes[i];
+    auto obj = node.obj;
+    bool clean = !node.cut && obj.isIndirect();
+
+    auto same = [](QPDFObjectHandle h, QPDFObjectHandle expected) {
+        return h.isIndirect() && h.getObjGen() == expected.getObjGen();
+    };
+    node.visible = 0;
+    for (size_t k = 0; k < node.children.size() && clean; ++k) {
+        auto &child = this->nodes[node.children[k]];
+        node.visible += 1 + (child.closed ? 0 : child.visible);
+        clean = child.clean && same(child.obj.getKey("/Parent"), obj);
+        if (k == 0)
+            clean = clean && !child.obj.hasKey("/Prev");
+        else
+            clean = clean && same(child.obj.getKey("/Prev"), this->nodes[node.children[k - 1]].obj);
+        if (k + 1 == node.children.size())
+            clean = clean && !child.obj.hasKey("/Next");
+    }
+    if (node.children.empty()) {
+        clean = clean && !obj.hasKey("/First") && !obj.hasKey("/Last");
+    } else {
+        clean = clean && same(obj.getKey("/First"), this->nodes[node.children.front()].obj) &&
+            same(obj.getKey("/Last"), this->nodes[node.children.back()].obj);
+    }
+
+    auto count = obj.getKey("/Count");
+    long long written = node.closed ? -node.visible : node.visible;
+    if (count.isNull())
+        clean = clean && written == 0;
+    else
+        clean = clean && count.isInteger() && count.getIntValue() == written;
+    node.clean = clean;
+}
+
+// The index of the page an outline item's destination refers to, or -1
+long long OutlineIndex::destination_page(QPDFObjectHandle obj)
+{
+    auto dest = obj.getKey("/Dest");
+    if (dest.isNull()) {
+        auto action = obj.getKey("/A");
+        if (!action.isDictionary())
+            return -1;
+        auto type = action.getKey("/S");
+        if (!type.isName() || type.getName() != "/GoTo")
+            return -1;
+        dest = action.getKey("/D");
+    }
+
+    auto &q = *this->qpdf;
+    if (dest.isName()) {
+        auto dests = q.getRoot().getKey("/Dests");
+        if (!dests.isDictionary())
+            return -1;
+        dest = dests.getKey(dest.getName());
+    } else if (dest.isString()) {
+        if (!this->dests_tree) {
+            auto names = q.getRoot().getKey("/Names");
+            auto tree = names.isDictionary() ? names.getKey("/Dests") : QPDFObjectHandle::newNull();
+            if (!tree.isDictionary())
+                return -1;
+            this->dests_tree = std::make_unique<QPDFNameTreeObjectHelper>(tree);
+        }
+        QPDFObjectHandle found;
+        if (!this->dests_tree->findObject(dest.getUTF8Value(), found))
+            return -1;
+        dest = found;
+    }
+    if (dest.isDictionary())
+        dest = dest.getKey("/D");
+    if (!dest.isArray() || dest.getArrayNItems() == 0)
+        return -1;
+    auto page = dest.getArrayItem(0);
+    if (!page.isIndirect() || page.getOwningQPDF() != &q)
+        return -1;
+    return page_table_index(q, page.getObjGen());
+}
+
+void init_outline(py::module_ &m)
+{
+    py::class_<OutlineIndex>(m, "_OutlineIndex")
+        .def(py::init<std::shared_ptr<QPDF>, int>(),
+            py::arg("pdf"),
+            py::arg("max_depth")
+        )
+        .def_readonly("top", &OutlineIndex::top)
+        .def_property_readonly("reoccurred", &OutlineIndex::reoccurred)
+        .def("object",
+            [](OutlineIndex &index, size_t i) {
+                return index.node(i).obj;
+            }
+        )
+        .def("children",
+            [](OutlineIndex &index, size_t i) {
+                return index.node(i).children;
+            }
+        )
+        .def("is_closed",
+            [](OutlineIndex &index, size_t i) {
+                return index.node(i).closed;
+            }
+        )
+        .def("is_clean",
+            [](OutlineIndex &index, size_t i) {
+                return index.node(i).clean;
+            }
+        )
+        .def("page_index",
+            [](OutlineIndex &index, size_t i) -> py::object {
+                auto page = index.node(i).page;
+                if (page < 0)
+                    return py::none();
+                return py::int_(page);
+            }
+        )
+        .def("descendants", &OutlineIndex::descendants);
+}
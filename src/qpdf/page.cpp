@@ -13,6 +13,7 @@
 
 #include "pikepdf.h"
 #include "object_parsers.h"
+#include "qpdf_state.h"
 
 #include <qpdf/QPDFPageObjectHelper.hh>
 #include <qpdf/QPDFPageLabelDocumentHelper.hh>
@@ -27,6 +28,8 @@ public:
     using Token = QPDFTokenizer::Token;
 
     void handleToken(Token const& token) override {
+        // Token filters may run while the GIL is released, e.g. during save
+        py::gil_scoped_acquire acquire;
         py::object result = this->handle_token(token);
         if (result.is_none())
             return;
@@ -68,21 +71,58 @@ size_t page_index(QPDF& owner, QPDFObjectHandle page)
 {
     if (&owner != page.getOwningQPDF())
         throw py::value_error("Page is not in this Pdf");
-    auto all_pages = owner.getAllPages();
 
-    auto page_objgen = page.getObjGen();
-    auto it = std::find_if(all_pages.begin(), all_pages.end(),
-        [&page_objgen](const QPDFObjectHandle& iter_page) {
-            return (page_objgen == iter_page.getObjGen());
-        }
-    );
-    if (it == all_pages.end())
+    auto idx = page_table_index(owner, page.getObjGen());
+    if (idx < 0)
         throw py::value_error("Page is not consistently registered with Pdf");
-    auto idx = it - all_pages.begin();
-    assert(idx >= 0);
     return idx;
 }
 
+// Equivalent to QPDFPageLabelDocumentHelper::getLabelForPage. The helper
+// flattens the whole /PageLabels number tree each time it is constructed, so
+// when the tree is a single node, look up the page's label range directly in
+// its /Nums table instead.
+static QPDFObjectHandle page_label_dict(QPDF &owner, long long index)
+{
+    auto page_labels = owner.getRoot().getKey("/PageLabels");
+    if (!page_labels.isDictionary() || page_labels.hasKey("/Kids")) {
+        QPDFPageLabelDocumentHelper pldh(owner);
+        return pldh.getLabelForPage(index);
+    }
+
+    auto nums = page_labels.getKey("/Nums");
+    if (!nums.isArray())
+        return QPDFObjectHandle::newNull();
+
+    // Find the range that starts at or below this page
+    QPDFObjectHandle label;
+    long long range_start = 0;
+    int n_items = nums.getArrayNItems();
+    for (int i = 0; i + 1 < n_items; i += 2) {
+        auto key = nums.getArrayItem(i);
+        if (!key.isInteger())
+            continue;
+        auto start = key.getIntValue();
+        if (start <= index && (!label.isInitialized() || start >= range_start)) {
+            range_start = start;
+            label = nums.getArrayItem(i + 1);
+        }
+    }
+    if (!label.isInitialized())
+        return QPDFObjectHandle::newNull();
+
+    long long st = 1;
+    auto label_st = label.getKey("/St");
+    if (label_st.isInteger())
+        st = label_st.getIntValue();
+
+    auto result = QPDFObjectHandle::newDictionary();
+    result.replaceOrRemoveKey("/S", label.getKey("/S"));
+    result.replaceOrRemoveKey("/P", label.getKey("/P"));
+    result.replaceOrRemoveKey("/St", QPDFObjectHandle::newInteger(st + index - range_start));
+    return result;
+}
+
 std::string label_string_from_dict(QPDFObjectHandle label_dict)
 {
     auto impl = py::module_::import("pikepdf._cpphelpers").attr("label_from_label_dict");
@@ -177,7 +217,7 @@ void init_page(py::module_& m)
             )~~~"
         )
         .def("get_filtered_contents",
-            [](QPDFPageObjectHelper &poh, TokenFilter &tf) {
+            [](QPDFPageObjectHelper &poh, QPDFObjectHandle::TokenFilter &tf) {
                 Pl_Buffer pl_buffer("filter_page");
                 poh.filterPageContents(&tf, &pl_buffer);
 
@@ -188,7 +228,8 @@ void init_page(py::module_& m)
             },
             py::arg("tf"),
             R"~~~(
-                Apply a :class:`pikepdf.TokenFilter` to a content stream, without modifying it.
+                Apply a :class:`pikepdf.TokenFilter` or :class:`pikepdf.NativeTokenFilter`
+                to a content stream, without modifying it.
 
                 This may be used when the results of a token filter do not need
                 to be applied, such as when filtering is being used to retrieve
@@ -214,16 +255,21 @@ void init_page(py::module_& m)
                 py::detail::keep_alive_impl(pyqpdf, pytf);
 
                 poh.addContentTokenFilter(tf);
+                pdf_state(*poh.getObjectHandle().getOwningQPDF()).has_token_filters = true;
             },
             py::keep_alive<1, 2>(), py::arg("tf"),
             R"~~~(
-                Attach a :class:`pikepdf.TokenFilter` to a page's content stream.
+                Attach a :class:`pikepdf.TokenFilter` or :class:`pikepdf.NativeTokenFilter`
+                to a page's content stream.
 
                 This function applies token filters lazily, if/when the page's
                 content stream is read for any reason, such as when the PDF is
                 saved. If never access, the token filter is not applied.
 
                 Multiple token filters may be added to a page/content stream.
+                Each is applied in a separate pass; to apply several native
+                filters in one pass, combine them with
+                :meth:`pikepdf.NativeTokenFilter.chain` first.
 
                 Token filters may not be removed after being attached to a Pdf.
                 Close and reopen the Pdf to remove token filters.
@@ -260,9 +306,10 @@ void init_page(py::module_& m)
                 A ``ValueError`` exception is thrown if the page is not attached
                 to a ``Pdf``.
 
-                Requires O(n) search.
-
                 .. versionadded: 2.2
+
+                .. versionchanged: 2.13
+                    No longer requires an O(n) search.
             )~~~"
         )
         .def_property_readonly("label",
@@ -274,8 +321,7 @@ void init_page(py::module_& m)
                 auto& owner = *p_owner;
                 auto index = page_index(owner, this_page);
 
-                QPDFPageLabelDocumentHelper pldh(owner);
-                auto label_dict = pldh.getLabelForPage(index);
+                auto label_dict = page_label_dict(owner, index);
                 if (label_dict.isNull())
                     return std::to_string(index + 1);
 
@@ -293,14 +339,14 @@ void init_page(py::module_& m)
                 pages have the same labels. Labels are not guaranteed to
                 be unique.
 
-                Note that this requires a O(n) search over all pages, to look up
-                the page's index.
-
                 .. versionadded: 2.2
 
                 .. versionchanged: 2.9
                     Returns the ordinary page number if no special rules for page
                     numbers are defined.
+
+                .. versionchanged: 2.13
+                    No longer requires an O(n) search.
             )~~~"
         )
         ;
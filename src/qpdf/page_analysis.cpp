@@ -0,0 +1,496 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <qpdf/BufferInputSource.hh>
+#include <qpdf/Pl_Buffer.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFPageObjectHelper.hh>
+#include <qpdf/QPDFTokenizer.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "parallel.h"
+#include "qpdf_state.h"
+#include "scratch_stream.h"
+
+// Per-page content analysis. As in verify.cpp, raw content stream data is read
+// serially, a window at a time, on the calling thread, so the Pdf's input is
+// never read concurrently. Worker threads then decode each page's content in
+// a private QPDF, and tokenize it without creating objects, so only the
+// summaries are ever converted to Python.
+
+// Most raw content stream data to hold in memory at once
+constexpr size_t ANALYSIS_WINDOW = 64 * 1024 * 1024;
+
+struct AnalysisOptions {
+    bool operators = false;
+    bool resources = false;
+    bool images = false;
+    bool text = false;
+};
+
+struct Matrix {
+    double a = 1, b = 0, c = 0, d = 1, e = 0, f = 0;
+
+    // This matrix applied first, then other
+    Matrix then(const Matrix &o) const
+    {
+        Matrix r;
+        r.a = a * o.a + b * o.c;
+        r.b = a * o.b + b * o.d;
+        r.c = c * o.a + d * o.c;
+        r.d = c * o.b + d * o.d;
+        r.e = e * o.a + f * o.c + o.e;
+        r.f = e * o.b + f * o.d + o.f;
+        return r;
+    }
+};
+
+struct Placement {
+    std::string name; // Empty for an inline image
+    Matrix ctm;
+};
+
+struct PageSummary {
+    std::map<std::string, size_t> operators;
+    std::map<std::string, std::vector<std::string>> resources;
+    std::vector<Placement> placements;
+    size_t text_shows = 0;
+    size_t text_bytes = 0;
+    bool has_text_bbox = false;
+    double text_bbox[4] = {0, 0, 0, 0};
+    std::string error;
+};
+
+struct AnalysisPage {
+    std::vector<std::unique_ptr<ScratchStream>> parts;
+    size_t raw_size = 0;
+    PageSummary summary;
+};
+
+struct Operand {
+    QPDFTokenizer::token_type_e type;
+    std::string value;
+    size_t string_bytes = 0; // Of the strings in an array
+};
+
+static double operand_number(const Operand &op, bool &ok)
+{
+    if (op.type != QPDFTokenizer::tt_integer && op.type != QPDFTokenizer::tt_real) {
+        ok = false;
+        return 0;
+    }
+    return std::strtod(op.value.c_str(), nullptr);
+}
+
+// Reads the numeric operands of an operator into m, if there are n of them
+static bool numeric_operands(const std::vector<Operand> &operands, size_t n, double *m)
+{
+    if (operands.size() != n)
+        return false;
+    bool ok = true;
+    for (size_t i = 0; i < n; ++i)
+        m[i] = operand_number(operands[i], ok);
+    return ok;
+}
+
+class ContentAnalyzer {
+public:
+    ContentAnalyzer(const AnalysisOptions &options, PageSummary &summary) :
+            options(options), summary(summary)
+    {
+    }
+
+    void run(const std::string &content);
+
+private:
+    void operate(const std::string &op);
+    void use_resource(const char *category, const Operand &operand);
+    void show_text(size_t bytes);
+    void next_line(double tx, double ty)
+    {
+        Matrix t;
+        t.e = tx;
+        t.f = ty;
+        this->tlm = t.then(this->tlm);
+        this->tm = this->tlm;
+    }
+
+    const AnalysisOptions &options;
+    PageSummary &summary;
+    std::vector<Operand> operands;
+    std::set<std::pair<std::string, std::string>> seen_resources;
+
+    struct GraphicsState {
+        Matrix ctm;
+        double leading = 0;
+    };
+    GraphicsState gs;
+    std::vector<GraphicsState> gs_stack;
+    Matrix tm, tlm;
+};
+
+void ContentAnalyzer::run(const std::string &content)
+{
+    using tt = QPDFTokenizer::token_type_e;
+    const std::string description = "content stream";
+    PointerHolder<InputSource> input(new BufferInputSource(description, content));
+    QPDFTokenizer tokenizer;
+    tokenizer.allowEOF();
+    int nesting = 0;
+
+    while (true) {
+        auto token = tokenizer.readToken(input, description, true);
+        auto type = token.getType();
+        if (type == tt::tt_eof)
+            return;
+        if (type == tt::tt_bad) {
+            this->summary.error = token.getErrorMessage() + " at offset " +
+                std::to_string(input->getLastOffset());
+            return;
+        }
+        if (type == tt::tt_space || type == tt::tt_comment)
+            continue;
+
+        if (nesting > 0) {
+            // Inside an array or dictionary operand, for TJ, BDC and the like
+            if (type == tt::tt_array_open || type == tt::tt_dict_open)
+                ++nesting;
+            else if (type == tt::tt_array_close || type == tt::tt_dict_close)
+                --nesting;
+            else if (type == tt::tt_string)
+                this->operands.back().string_bytes += token.getValue().size();
+            continue;
+        }
+        switch (type) {
+        case tt::tt_array_open:
+        case tt::tt_dict_open:
+            ++nesting;
+            this->operands.push_back(Operand{type, ""});
+            break;
+        case tt::tt_word: {
+            auto op = token.getValue();
+            if (op == "ID") {
+                // The inline image's data, up to and including EI
+                tokenizer.expectInlineImage(input);
+                auto image = tokenizer.readToken(input, description, true);
+                if (image.getType() != tt::tt_inline_image) {
+                    this->summary.error = "inline image has no EI at offset " +
+                        std::to_string(input->getLastOffset());
+                    return;
+                }
+                if (this->options.images)
+                    this->summary.placements.push_back(Placement{"", this->gs.ctm});
+            } else {
+                this->operate(op);
+            }
+            this->operands.clear();
+            break;
+        }
+        default:
+            this->operands.push_back(Operand{type, token.getValue()});
+            break;
+        }
+    }
+}
+
+void ContentAnalyzer::use_resource(const char *category, const Operand &operand)
+{
+    if (!this->options.resources || operand.type != QPDFTokenizer::tt_name)
+        return;
+    if (this->seen_resources.emplace(category, operand.value).second)
+        this->summary.resources[category].push_back(operand.value);
+}
+
+void ContentAnalyzer::show_text(size_t bytes)
+{
+    if (!this->options.text)
+        return;
+    this->summary.text_shows += 1;
+    this->summary.text_bytes += bytes;
+    auto origin = this->tm.then(this->gs.ctm);
+    auto &bbox = this->summary.text_bbox;
+    if (!this->summary.has_text_bbox) {
+        this->summary.has_text_bbox = true;
+        bbox[0] = bbox[2] = origin.e;
+        bbox[1] = bbox[3] = origin.f;
+    } else {
+        bbox[0] = std::min(bbox[0], origin.e);
+        bbox[1] = std::min(bbox[1], origin.f);
+        bbox[2] = std::max(bbox[2], origin.e);
+        bbox[3] = std::max(bbox[3], origin.f);
+    }
+}
+
+void ContentAnalyzer::operate(const std::string &op)
+{
+    if (this->options.operators)
+        this->summary.operators[op] += 1;
+
+    auto &ops = this->operands;
+    double m[6];
+    if (op == "q") {
+        this->gs_stack.push_back(this->gs);
+    } else if (op == "Q") {
+        if (!this->gs_stack.empty()) {
+            this->gs = this->gs_stack.back();
+            this->gs_stack.pop_back();
+        }
+    } else if (op == "cm") {
+        if (numeric_operands(ops, 6, m))
+            this->gs.ctm = Matrix{m[0], m[1], m[2], m[3], m[4], m[5]}.then(this->gs.ctm);
+    } else if (op == "BT") {
+        this->tm = this->tlm = Matrix();
+    } else if (op == "Tm") {
+        if (numeric_operands(ops, 6, m))
+            this->tm = this->tlm = Matrix{m[0], m[1], m[2], m[3], m[4], m[5]};
+    } else if (op == "Td" || op == "TD") {
+        if (numeric_operands(ops, 2, m)) {
+            if (op == "TD")
+                this->gs.leading = -m[1];
+            this->next_line(m[0], m[1]);
+        }
+    } else if (op == "TL") {
+        if (numeric_operands(ops, 1, m))
+            this->gs.leading = m[0];
+    } else if (op == "T*") {
+        this->next_line(0, -this->gs.leading);
+    } else if (op == "Tj" || op == "'" || op == "\"") {
+        if (op != "Tj")
+            this->next_line(0, -this->gs.leading);
+        if (!ops.empty() && ops.back().type == QPDFTokenizer::tt_string)
+            this->show_text(ops.back().value.size());
+    } else if (op == "TJ") {
+        if (!ops.empty() && ops.back().type == QPDFTokenizer::tt_array_open)
+            this->show_text(ops.back().string_bytes);
+    } else if (op == "Tf") {
+        if (!ops.empty())
+            this->use_resource("/Font", ops.front());
+    } else if (op == "Do") {
+        if (!ops.empty()) {
+            this->use_resource("/XObject", ops.back());
+            if (this->options.images && ops.back().type == QPDFTokenizer::tt_name)
+                this->summary.placements.push_back(Placement{ops.back().value, this->gs.ctm});
+        }
+    } else if (op == "gs") {
+        if (!ops.empty())
+            this->use_resource("/ExtGState", ops.back());
+    } else if (op == "cs" || op == "CS") {
+        static const std::set<std::string> device = {
+            "/DeviceGray", "/DeviceRGB", "/DeviceCMYK", "/Pattern"};
+        if (!ops.empty() && !device.count(ops.back().value))
+            this->use_resource("/ColorSpace", ops.back());
+    } else if (op == "scn" || op == "SCN") {
+        if (!ops.empty())
+            this->use_resource("/Pattern", ops.back());
+    } else if (op == "sh") {
+        if (!ops.empty())
+            this->use_resource("/Shading", ops.back());
+    } else if (op == "BDC" || op == "DP") {
+        if (ops.size() == 2)
+            this->use_resource("/Properties", ops.back());
+    }
+}
+
+static void analysis_read(AnalysisPage &page, QPDFObjectHandle part)
+{
+    PointerHolder<Buffer> raw;
+    try {
+        raw = part.getRawStreamData();
+    } catch (const std::exception &e) {
+        page.summary.error = e.what();
+        return;
+    }
+    page.raw_size += raw->getSize();
+    try {
+        page.parts.push_back(std::make_unique<ScratchStream>(part, raw));
+    } catch (const std::exception &) {
+        page.summary.error = "content stream uses filters that cannot be decoded";
+    }
+}
+
+static void analysis_run(AnalysisPage &page, const AnalysisOptions &options)
+{
+    std::string content;
+    bool readable = page.summary.error.empty();
+    for (auto &part : page.parts) {
+        if (!readable)
+            break;
+        Pl_Buffer out("analyze content stream");
+        try {
+            readable = part->pipe(&out, 0, qpdf_dl_all, false, false);
+        } catch (const std::exception &e) {
+            page.summary.error = e.what();
+            readable = false;
+        }
+        if (!readable)
+            break;
+        // As qpdf does when it concatenates content streams
+        if (!content.empty())
+            content += '\n';
+        PointerHolder<Buffer> buf(out.getBuffer());
+        content.append(reinterpret_cast<const char *>(buf->getBuffer()), buf->getSize());
+    }
+    page.parts.clear();
+    if (!readable) {
+        if (page.summary.error.empty())
+            page.summary.error = "content stream uses filters that cannot be decoded";
+        return;
+    }
+    ContentAnalyzer(options, page.summary).run(content);
+}
+
+// Names and operators are bytes in PDF; keep any that are not UTF-8
+static py::str bytes_to_str(const std::string &s)
+{
+    return py::reinterpret_steal<py::str>(
+        PyUnicode_DecodeUTF8(s.data(), s.size(), "surrogateescape"));
+}
+
+static py::tuple analysis_result(
+    QPDFObjectHandle page, PageSummary &summary, const AnalysisOptions &options)
+{
+    py::object operators = py::none();
+    if (options.operators) {
+        py::dict d;
+        for (auto const &item : summary.operators)
+            d[bytes_to_str(item.first)] = item.second;
+        operators = d;
+    }
+    py::object resources = py::none();
+    if (options.resources) {
+        py::dict d;
+        for (auto const &item : summary.resources) {
+            py::list names;
+            for (auto const &name : item.second)
+                names.append(bytes_to_str(name));
+            d[py::str(item.first)] = names;
+        }
+        resources = d;
+    }
+    py::object images = py::none();
+    if (options.images) {
+        // Only placements of image XObjects, not of forms
+        auto xobjects = QPDFPageObjectHelper(page).getAttribute("/Resources", false);
+        xobjects = xobjects.isDictionary() ? xobjects.getKey("/XObject") : xobjects;
+        py::list placements;
+        for (auto const &p : summary.placements) {
+            if (!p.name.empty()) {
+                if (!xobjects.isDictionary())
+                    continue;
+                auto xobject = xobjects.getKey(p.name);
+                if (!xobject.isStream())
+                    continue;
+                auto subtype = xobject.getDict().getKey("/Subtype");
+                if (!subtype.isName() || subtype.getName() != "/Image")
+                    continue;
+            }
+            auto const &m = p.ctm;
+            placements.append(py::make_tuple(
+                p.name.empty() ? py::object(py::none()) : bytes_to_str(p.name),
+                py::make_tuple(m.a, m.b, m.c, m.d, m.e, m.f)));
+        }
+        images = placements;
+    }
+    py::object text_shows = py::none(), text_bytes = py::none(), text_bbox = py::none();
+    if (options.text) {
+        text_shows = py::int_(summary.text_shows);
+        text_bytes = py::int_(summary.text_bytes);
+        if (summary.has_text_bbox) {
+            auto const &b = summary.text_bbox;
+            text_bbox = py::make_tuple(b[0], b[1], b[2], b[3]);
+        }
+    }
+    py::object error = py::none();
+    if (!summary.error.empty())
+        error = py::str(summary.error);
+    return py::make_tuple(
+        operators, resources, images, text_shows, text_bytes, text_bbox, error);
+}
+
+static py::list analyze_pages(QPDF &q, std::vector<std::string> collect, unsigned int workers)
+{
+    AnalysisOptions options;
+    for (auto const &kind : collect) {
+        if (kind == "operators")
+            options.operators = true;
+        else if (kind == "resources")
+            options.resources = true;
+        else if (kind == "images")
+            options.images = true;
+        else if (kind == "text")
+            options.text = true;
+        else
+            throw py::value_error("unknown page analysis: " + kind);
+    }
+
+    auto const &pages = page_table(q);
+    std::vector<AnalysisPage> jobs(pages.size());
+    std::vector<std::vector<QPDFObjectHandle>> contents(pages.size());
+    for (size_t i = 0; i < pages.size(); ++i) {
+        auto c = pages[i].getKey("/Contents");
+        if (c.isArray())
+            contents[i] = c.getArrayAsVector();
+        else if (!c.isNull())
+            contents[i].push_back(c);
+        for (auto const &part : contents[i]) {
+            if (!part.isStream()) {
+                jobs[i].summary.error = "/Contents is not a stream or array of streams";
+                contents[i].clear();
+                break;
+            }
+        }
+    }
+
+    {
+        py::gil_scoped_release release;
+        size_t begin = 0;
+        while (begin < jobs.size()) {
+            size_t end = begin;
+            size_t window = 0;
+            while (end < jobs.size() && (end == begin || window < ANALYSIS_WINDOW)) {
+                for (auto &part : contents[end]) {
+                    if (!jobs[end].summary.error.empty())
+                        break;
+                    analysis_read(jobs[end], part);
+                }
+                window += jobs[end].raw_size;
+                ++end;
+            }
+            parallel_for(end - begin, workers, [&](size_t i) {
+                analysis_run(jobs[begin + i], options);
+            });
+            begin = end;
+        }
+    }
+
+    py::list results;
+    for (size_t i = 0; i < jobs.size(); ++i)
+        results.append(analysis_result(pages[i], jobs[i].summary, options));
+    return results;
+}
+
+void init_page_analysis(py::module_ &m)
+{
+    m.def("_analyze_pages", analyze_pages,
+        "Summarize the content of every page. Use pikepdf.Pdf.pages.analyze.",
+        py::arg("pdf"),
+        py::arg("collect"),
+        py::arg("workers")
+    );
+}
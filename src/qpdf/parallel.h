@@ -0,0 +1,74 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use when the caller asks for 0 (automatic)
+inline unsigned int default_worker_count()
+{
+    auto n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+// Call fn(i) for each i in [0, n) on up to `workers` native threads. Work is
+// handed out one index at a time, so uneven jobs balance themselves.
+//
+// fn must not touch Python objects unless it acquires the GIL, and callers
+// should release the GIL before calling, or it will deadlock. If fn throws,
+// no new work is started and the first exception is rethrown once every
+// thread has finished.
+template <typename Fn>
+void parallel_for(size_t n, unsigned int workers, Fn fn)
+{
+    if (workers == 0)
+        workers = default_worker_count();
+    workers = static_cast<unsigned int>(std::min<size_t>(workers, n));
+    if (workers <= 1) {
+        for (size_t i = 0; i < n; ++i)
+            fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr first_error;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        while (!failed.load()) {
+            size_t i = next.fetch_add(1);
+            if (i >= n)
+                break;
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!first_error)
+                    first_error = std::current_exception();
+                failed.store(true);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (unsigned int t = 0; t < workers; ++t)
+        threads.emplace_back(worker);
+    for (auto &thread : threads)
+        thread.join();
+
+    if (first_error)
+        std::rethrow_exception(first_error);
+}
@@ -0,0 +1,76 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+// Counters for diagnosing slow files, kept for every Pdf and reported by
+// Pdf.stats(). Input sources may be used without the GIL, and may outlive
+// their Pdf's state, so they share ownership of the counters, which are
+// atomic.
+//
+// Input sources count their own reads of the file, stream or memory that
+// they read from, each time they go to it, such as to refill a read-ahead
+// window, rather than each call qpdf makes to them, which is often for a
+// single byte.
+struct PdfStats {
+    using counter = std::atomic<unsigned long long>;
+
+    std::string input_kind;
+    counter bytes_read{0};
+    counter read_calls{0};
+    // Only Python streams are seeked; others read at an offset
+    counter seek_calls{0};
+
+    // Acquisitions of the GIL by input sources, output pipelines and the
+    // progress reporter, when called back from qpdf
+    counter gil_acquisitions{0};
+
+    struct FilterStats {
+        unsigned long long streams = 0;
+        unsigned long long bytes_in = 0;
+        unsigned long long bytes_out = 0;
+    };
+    // Streams decoded through pikepdf, keyed by their /Filter
+    std::mutex filters_mutex;
+    std::map<std::string, FilterStats> filters;
+};
+
+inline void stats_count(PdfStats::counter &c, unsigned long long n = 1)
+{
+    c.fetch_add(n, std::memory_order_relaxed);
+}
+
+// Count a read of the underlying input by an input source
+inline void stats_count_read(const std::shared_ptr<PdfStats> &stats, unsigned long long bytes)
+{
+    if (stats) {
+        stats_count(stats->read_calls);
+        stats_count(stats->bytes_read, bytes);
+    }
+}
+
+// Acquire the GIL in a callback from qpdf, and count it
+class stats_gil_acquire {
+public:
+    explicit stats_gil_acquire(const std::shared_ptr<PdfStats> &stats)
+    {
+        if (stats)
+            stats_count(stats->gil_acquisitions);
+    }
+
+private:
+    pybind11::gil_scoped_acquire gil;
+};
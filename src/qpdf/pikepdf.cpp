@@ -6,12 +6,14 @@
  * Copyright (C) 2019, James R. Barlow (https://github.com/jbarlow83/)
  */
 
+#include <array>
 #include <sstream>
 #include <type_traits>
 #include <cerrno>
 #include <cstring>
 #include <cstdio>
 #include <regex>
+#include <tuple>
 #include <vector>
 #include <utility>
 
@@ -31,6 +33,9 @@
 
 uint DECIMAL_PRECISION = 15;
 bool MMAP_DEFAULT = false;
+bool REAL_AS_FLOAT = false;
+bool INTERN_SCALARS = false;
+ReprLimits REPR_LIMITS = {32, 1000, 100000};
 
 class TemporaryErrnoChange {
 public:
@@ -78,6 +83,19 @@ auto translate_qpdf_error(const std::exception& e)
     return translate_qpdf_error(std::string(e.what()));
 }
 
+// PDFDocEncoding maps each byte to one character, so strings can be decoded by
+// looking up each byte's UTF-8, once qpdf has supplied it
+static const std::array<std::string, 256> &pdf_doc_utf8_table()
+{
+    static const auto table = [] {
+        std::array<std::string, 256> t;
+        for (int c = 0; c < 256; ++c)
+            t[c] = QUtil::pdf_doc_to_utf8(std::string(1, static_cast<char>(c)));
+        return t;
+    }();
+    return table;
+}
+
 PYBIND11_MODULE(_qpdf, m) {
     //py::options options;
     //options.disable_function_signatures();
@@ -91,6 +109,16 @@ PYBIND11_MODULE(_qpdf, m) {
     init_object(m);
     init_annotation(m);
     init_page(m);
+    init_token_filters(m);
+    init_batch(m);
+    init_verify(m);
+    init_image(m);
+    init_deduplicate(m);
+    init_object_iterator(m);
+    init_outline(m);
+    init_xmp(m);
+    init_page_analysis(m);
+    init_decoders(m);
 
     m.def("utf8_to_pdf_doc",
         [](py::str utf8, char unknown) {
@@ -104,6 +132,53 @@ PYBIND11_MODULE(_qpdf, m) {
             return py::str(QUtil::pdf_doc_to_utf8(pdfdoc));
         }
     );
+    m.def("utf8_to_pdf_doc_many",
+        [](py::iterable strings, char unknown) {
+            std::vector<std::string> utf8;
+            for (auto item : strings) {
+                Py_ssize_t size;
+                const char *data = PyUnicode_AsUTF8AndSize(item.ptr(), &size);
+                if (!data)
+                    throw py::error_already_set();
+                utf8.emplace_back(data, size);
+            }
+            std::vector<std::pair<bool, std::string>> converted(utf8.size());
+            {
+                py::gil_scoped_release release;
+                for (size_t i = 0; i < utf8.size(); ++i)
+                    converted[i].first = QUtil::utf8_to_pdf_doc(
+                        utf8[i], converted[i].second, unknown);
+            }
+            py::list result;
+            for (auto &item : converted)
+                result.append(py::make_tuple(item.first, py::bytes(item.second)));
+            return result;
+        },
+        "As utf8_to_pdf_doc, for each of many strings",
+        py::arg("strings"),
+        py::arg("unknown")
+    );
+    m.def("pdf_doc_to_utf8_many",
+        [](py::iterable items) {
+            auto &table = pdf_doc_utf8_table();
+            py::list result;
+            std::string utf8;
+            for (auto item : items) {
+                char *data;
+                Py_ssize_t size;
+                if (!PyBytes_Check(item.ptr()))
+                    throw py::type_error("expected bytes");
+                PyBytes_AsStringAndSize(item.ptr(), &data, &size);
+                utf8.clear();
+                for (Py_ssize_t i = 0; i < size; ++i)
+                    utf8 += table[static_cast<unsigned char>(data[i])];
+                result.append(py::str(utf8));
+            }
+            return result;
+        },
+        "As pdf_doc_to_utf8, for each of many byte strings",
+        py::arg("pdfdocs")
+    );
 
     m.def("_test_file_not_found",
         []() -> void {
@@ -131,6 +206,57 @@ PYBIND11_MODULE(_qpdf, m) {
         },
         "Get the number of decimal digits to use when converting floats."
     );
+    m.def("set_real_as_float",
+        [](bool enabled) {
+            REAL_AS_FLOAT = enabled;
+            return REAL_AS_FLOAT;
+        },
+        "If set to true, PDF real numbers are returned as float instead of Decimal."
+    );
+    m.def("get_real_as_float",
+        []() {
+            return REAL_AS_FLOAT;
+        },
+        "Get whether PDF real numbers are returned as float instead of Decimal."
+    );
+    m.def("set_intern_scalars",
+        [](bool enabled) {
+            INTERN_SCALARS = enabled;
+            if (!enabled)
+                interned_scalars().clear();
+            return INTERN_SCALARS;
+        },
+        "If set to true, names and short strings are returned as shared Python objects."
+    );
+    m.def("get_intern_scalars",
+        []() {
+            return INTERN_SCALARS;
+        },
+        "Get whether names and short strings are returned as shared Python objects."
+    );
+    m.def("set_repr_limits",
+        [](size_t depth, size_t items, size_t length) {
+            REPR_LIMITS = ReprLimits{depth, items, length};
+            return std::make_tuple(REPR_LIMITS.depth, REPR_LIMITS.items, REPR_LIMITS.length);
+        },
+        R"~~~(
+        Limit how much of an object ``repr()`` shows.
+
+        Containers nested more than *depth* levels deep, items of a container
+        after the first *items*, and output after the first *length* bytes
+        are replaced with ``<...>`` markers. Zero means no limit. Returns the
+        limits as a tuple ``(depth, items, length)``.
+        )~~~",
+        py::arg("depth"),
+        py::arg("items"),
+        py::arg("length")
+    );
+    m.def("get_repr_limits",
+        []() {
+            return std::make_tuple(REPR_LIMITS.depth, REPR_LIMITS.items, REPR_LIMITS.length);
+        },
+        "Get the limits on ``repr()`` of an object, as a tuple ``(depth, items, length)``."
+    );
     m.def("set_access_default_mmap",
         [](bool mmap) {
             MMAP_DEFAULT = mmap;
@@ -9,9 +9,15 @@
 #pragma once
 
 #include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <map>
 
+#include <qpdf/Buffer.hh>
+#include <qpdf/Constants.h>
 #include <qpdf/PointerHolder.hh>
 #include <qpdf/QPDF.hh>
 #include <qpdf/QPDFObjectHandle.hh>
@@ -37,8 +43,59 @@ namespace pybind11 { namespace detail {
     };
 }}
 
+// Holder for the Python instances of pikepdf.Object. Besides owning the
+// handle, it holds a reference to the Python Pdf that owns the object, if any,
+// so the Pdf outlives it. This does the job of py::keep_alive without adding
+// an entry to pybind11's internal table of patients for every object.
+template <typename T>
+class ObjectHolder {
+public:
+    ObjectHolder() = default;
+    explicit ObjectHolder(T *p) : ptr(p) {}
+    T *get() const { return ptr.get(); }
+    void set_owner(pybind11::handle pyqpdf)
+    {
+        owner = pybind11::reinterpret_borrow<pybind11::object>(pyqpdf);
+    }
+
+private:
+    // Declared first so that it is released after the handle
+    pybind11::object owner;
+    std::shared_ptr<T> ptr;
+};
+PYBIND11_DECLARE_HOLDER_TYPE(T, ObjectHolder<T>);
+
 // From object_convert.cpp
 pybind11::object decimal_from_pdfobject(QPDFObjectHandle h);
+pybind11::object real_from_pdfobject(QPDFObjectHandle h);
+
+// From pikepdf.cpp
+extern bool INTERN_SCALARS;
+
+// Limits on the repr() of an object: how deeply nested containers are shown,
+// how many items of each container are shown, and roughly how many bytes are
+// written. Zero means no limit.
+struct ReprLimits {
+    size_t depth;
+    size_t items;
+    size_t length;
+};
+extern ReprLimits REPR_LIMITS;
+
+// Most names and strings to intern, and the longest string to intern
+constexpr size_t INTERN_LIMIT = 4096;
+constexpr size_t INTERN_MAX_STRING = 64;
+
+// Python objects for the names and short strings returned so far, when
+// settings.set_intern_scalars(True). Like the cached references in
+// object_convert.cpp, this is deliberately leaked, since the objects must
+// remain valid until the interpreter shuts down, and it is protected by the
+// GIL.
+inline std::unordered_map<std::string, pybind11::object> &interned_scalars()
+{
+    static auto *interned = new std::unordered_map<std::string, pybind11::object>();
+    return *interned;
+}
 
 namespace pybind11 { namespace detail {
     template <> struct type_caster<QPDFObjectHandle> : public type_caster_base<QPDFObjectHandle> {
@@ -91,7 +148,7 @@ namespace pybind11 { namespace detail {
                     h = pybind11::bool_(src->getBoolValue()).release();
                     break;
                 case QPDFObject::object_type_e::ot_real:
-                    h = decimal_from_pdfobject(*src).release();
+                    h = real_from_pdfobject(*src).release();
                     break;
                 default:
                     primitive = false;
@@ -107,6 +164,21 @@ namespace pybind11 { namespace detail {
             }
 
             QPDF *owner = src->getOwningQPDF();
+            std::string intern_key;
+            if (INTERN_SCALARS && !owner) {
+                // The key is prefixed with the type, so a name and a string
+                // with the same text are different keys
+                if (src->isName())
+                    intern_key = "n" + src->getName();
+                else if (src->isString() && src->getStringValue().size() <= INTERN_MAX_STRING)
+                    intern_key = "s" + src->getStringValue();
+                if (!intern_key.empty()) {
+                    auto found = interned_scalars().find(intern_key);
+                    if (found != interned_scalars().end())
+                        return found->second.inc_ref();
+                }
+            }
+
             if (policy == return_value_policy::take_ownership) {
                 // LCOV_EXCL_START
                 // See explanation above - does not happen.
@@ -116,16 +188,30 @@ namespace pybind11 { namespace detail {
             } else {
                 h = base::cast(*csrc, policy, parent);
             }
+            if (!h)
+                return h;
+            auto v_h = reinterpret_cast<instance *>(h.ptr())->get_value_and_holder();
             if (owner) {
                 // Find the Python object that refers to our owner
                 // Can do that by casting or more direct lookup
                 //auto pyqpdf = pybind11::cast(owner);
-                auto tinfo = get_type_info(typeid(QPDF));
-                handle pyqpdf = get_object_handle(owner, tinfo);
+                static const type_info *qpdf_tinfo = nullptr;
+                if (!qpdf_tinfo)
+                    qpdf_tinfo = get_type_info(typeid(QPDF));
+                handle pyqpdf = get_object_handle(owner, qpdf_tinfo);
 
-                // Tell pybind11 that it must keep pyqpdf alive as long as h is
-                // alive
-                keep_alive_impl(h, pyqpdf);
+                // The instance must keep pyqpdf alive as long as h is alive.
+                // Instances that own their handle keep a reference in their
+                // holder. pybind11 creates instances that refer to a handle
+                // held elsewhere, such as in an _ObjectList, without a
+                // holder, so those still need keep_alive.
+                if (v_h.holder_constructed())
+                    v_h.holder<ObjectHolder<QPDFObjectHandle>>().set_owner(pyqpdf);
+                else
+                    keep_alive_impl(h, pyqpdf);
+            } else if (!intern_key.empty() && v_h.holder_constructed() &&
+                    interned_scalars().size() < INTERN_LIMIT) {
+                interned_scalars()[intern_key] = reinterpret_borrow<object>(h);
             }
             return h;
         }
@@ -152,9 +238,65 @@ PYBIND11_MAKE_OPAQUE(ObjectMap);
 
 // From qpdf.cpp
 void init_qpdf(py::module_& m);
+void qpdf_basic_settings(QPDF& q);
+
+// From batch.cpp
+void init_batch(py::module_& m);
+
+// From verify.cpp
+void init_verify(py::module_& m);
+
+// From image.cpp
+void init_image(py::module_& m);
+
+// From deduplicate.cpp
+void init_deduplicate(py::module_& m);
+
+// From object_iterator.cpp
+void init_object_iterator(py::module_& m);
+
+// From outline.cpp
+void init_outline(py::module_& m);
+
+// From page_analysis.cpp
+void init_page_analysis(py::module_& m);
+
+// From xmp.cpp
+struct XmpValue {
+    enum Status { absent, simple, complex };
+    Status status = absent;
+    size_t begin = 0; // The value's bytes within the packet
+    size_t end = 0;
+    bool alternative = false; // The first item of an rdf:Alt
+};
+XmpValue xmp_find_simple(const std::string &xmp, const std::string &ns, const std::string &name);
+void update_xmp_pdfversion(QPDF& q, std::string version);
+void init_xmp(py::module_& m);
+
+// From decoders.cpp
+// A decoder for a stream filter that qpdf does not implement. It is called
+// with the GIL held and the filter's /DecodeParms, and returns the function
+// that decodes, which is called without the GIL.
+typedef std::function<std::string(const std::string &)> StreamDecodeFn;
+typedef std::function<StreamDecodeFn(QPDFObjectHandle decode_parms)> StreamDecoder;
+// Register a native decoder. Decoders registered from Python take precedence.
+void register_stream_decoder(const std::string &filter, StreamDecoder decoder);
+PointerHolder<Buffer> stream_decode_registered(
+    QPDFObjectHandle h, qpdf_stream_decode_level_e decode_level);
+void init_decoders(py::module_& m);
+
+// From incremental.cpp
+size_t save_incremental(QPDF& q, py::object stream, bool append);
 
 // From object.cpp
 size_t list_range_check(QPDFObjectHandle h, int index);
+
+// A contiguous array of doubles, exposed to Python through the buffer protocol
+// so that it can be used from NumPy etc. without copying
+struct FloatArray {
+    std::vector<double> values;
+};
+py::object float_array_memoryview(FloatArray &&array);
 void init_object(py::module_& m);
 
 // From object_repr.cpp
@@ -165,17 +307,26 @@ std::string objecthandle_repr(QPDFObjectHandle h);
 
 // From object_convert.cpp
 py::object decimal_from_pdfobject(QPDFObjectHandle h);
+bool numeric_equal(QPDFObjectHandle self, QPDFObjectHandle other);
+std::string numeric_key(QPDFObjectHandle h);
 QPDFObjectHandle objecthandle_encode(const py::handle handle);
 std::vector<QPDFObjectHandle> array_builder(const py::iterable iter);
 std::map<std::string, QPDFObjectHandle> dict_builder(const py::dict dict);
+std::vector<QPDFObjectHandle> dictionaries_from_records(
+    py::iterable records, QPDFObjectHandle templ, QPDF *owner);
 
 // From annotation.cpp
 void init_annotation(py::module_ &m);
+void generate_appearance_streams(QPDF &q, py::object annotations);
+void flatten_annotations(QPDF &q, std::string mode, py::object annotations);
 
 // From page.cpp
 void init_page(py::module_ &m);
 size_t page_index(QPDF& owner, QPDFObjectHandle page);
 
+// From token_filters.cpp
+void init_token_filters(py::module_ &m);
+
 inline char *fix_pypy36_const_char(const char *s)
 {
     // PyPy 7.3.1 (=Python 3.6) has a few functions incorrectly defined as requiring
@@ -6,6 +6,8 @@
  * Copyright (C) 2017, James R. Barlow (https://github.com/jbarlow83/)
  */
 
+#include <algorithm>
+#include <cerrno>
 
 #include <qpdf/Constants.h>
 #include <qpdf/Types.h>
@@ -27,7 +29,30 @@
 
 void Pl_PythonOutput::write(unsigned char *buf, size_t len)
 {
-    py::gil_scoped_acquire gil;
+    if (this->buffer.size() + len <= this->block_size) {
+        this->buffer.insert(this->buffer.end(), buf, buf + len);
+        return;
+    }
+    this->flush_buffer();
+    if (len < this->block_size) {
+        this->buffer.insert(this->buffer.end(), buf, buf + len);
+        return;
+    }
+    // Large writes bypass the buffer entirely
+    this->write_to_stream(buf, len);
+}
+
+void Pl_PythonOutput::flush_buffer()
+{
+    if (this->buffer.empty())
+        return;
+    this->write_to_stream(this->buffer.data(), this->buffer.size());
+    this->buffer.clear();
+}
+
+void Pl_PythonOutput::write_to_stream(unsigned char *buf, size_t len)
+{
+    stats_gil_acquire gil(this->stats);
     ssize_t so_far = 0;
     while (len > 0) {
         auto view_buffer = py::memoryview::from_memory(buf, len);
@@ -51,10 +76,87 @@ void Pl_PythonOutput::write(unsigned char *buf, size_t len)
 
 void Pl_PythonOutput::finish()
 {
-    py::gil_scoped_acquire gil;
+    this->flush_buffer();
+
+    stats_gil_acquire gil(this->stats);
     try {
         this->stream.attr("flush")();
     } catch (const py::attr_error &e) {
         // Suppress
     }
 }
+
+
+void Pl_PythonChunks::write(unsigned char *buf, size_t len)
+{
+    while (len > 0) {
+        auto n = std::min(len, this->chunk_size - this->buffer.size());
+        this->buffer.insert(this->buffer.end(), buf, buf + n);
+        buf += n;
+        len -= n;
+        if (this->buffer.size() == this->chunk_size)
+            this->send_chunk();
+    }
+}
+
+void Pl_PythonChunks::send_chunk()
+{
+    stats_gil_acquire gil(this->stats);
+    auto chunk = py::bytes(
+        reinterpret_cast<const char *>(this->buffer.data()), this->buffer.size());
+    this->count += this->buffer.size();
+    this->buffer.clear();
+    if (!this->hasher.is_none())
+        this->hasher.attr("update")(chunk);
+    this->callback(chunk);
+}
+
+void Pl_PythonChunks::finish()
+{
+    if (!this->buffer.empty())
+        this->send_chunk();
+}
+
+
+void Pl_FileDescriptorOutput::write(unsigned char *buf, size_t len)
+{
+    if (this->buffer.size() + len <= this->block_size) {
+        this->buffer.insert(this->buffer.end(), buf, buf + len);
+        return;
+    }
+    this->flush_buffer();
+    if (len < this->block_size) {
+        this->buffer.insert(this->buffer.end(), buf, buf + len);
+        return;
+    }
+    this->write_to_fd(buf, len);
+}
+
+void Pl_FileDescriptorOutput::flush_buffer()
+{
+    if (this->buffer.empty())
+        return;
+    this->write_to_fd(this->buffer.data(), this->buffer.size());
+    this->buffer.clear();
+}
+
+void Pl_FileDescriptorOutput::write_to_fd(unsigned char *buf, size_t len)
+{
+    while (len > 0) {
+        auto written = native_file_write(this->fd, buf, len);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            QUtil::throw_system_error(this->identifier);
+        }
+        if (written == 0) // Should not happen for a regular file
+            QUtil::throw_system_error(this->identifier); // LCOV_EXCL_LINE
+        buf += written;
+        len -= written;
+    }
+}
+
+void Pl_FileDescriptorOutput::finish()
+{
+    this->flush_buffer();
+}
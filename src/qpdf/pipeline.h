@@ -10,6 +10,7 @@
 
 #include <cstdio>
 #include <cstring>
+#include <vector>
 
 #include <qpdf/Constants.h>
 #include <qpdf/Types.h>
@@ -25,15 +26,29 @@
 #include <pybind11/stl.h>
 
 #include "pikepdf.h"
+#include "pdf_stats.h"
+
+
+// QPDFWriter emits many small writes (often a single token at a time), so
+// both pipelines below coalesce output into large blocks before passing it on.
+// Neither requires the GIL to be held by the caller; Pl_PythonOutput acquires
+// it only when a block is handed to Python.
+constexpr size_t PYTHON_OUTPUT_BLOCK_SIZE = 4 * 1024 * 1024;
+constexpr size_t FILE_OUTPUT_BLOCK_SIZE = 1024 * 1024;
 
 
 class Pl_PythonOutput : public Pipeline
 {
 public:
-    Pl_PythonOutput(const char *identifier, py::object stream) :
+    Pl_PythonOutput(const char *identifier, py::object stream,
+                    size_t block_size = PYTHON_OUTPUT_BLOCK_SIZE,
+                    std::shared_ptr<PdfStats> stats = nullptr) :
         Pipeline(identifier, nullptr),
-        stream(stream)
+        stream(stream),
+        block_size(block_size),
+        stats(stats)
     {
+        this->buffer.reserve(block_size);
     }
 
     virtual ~Pl_PythonOutput() = default;
@@ -46,5 +61,91 @@ public:
     void finish() override;
 
 private:
+    void write_to_stream(unsigned char *buf, size_t len);
+    void flush_buffer();
+
     py::object stream;
+    size_t block_size;
+    std::vector<unsigned char> buffer;
+    std::shared_ptr<PdfStats> stats;
+};
+
+
+// Pass output to a Python callable in chunks of exactly chunk_size bytes (the
+// last may be shorter), for sinks that cannot seek, such as network uploads.
+// Each chunk is a new bytes object, so the callable may keep it. The optional
+// hasher, e.g. from hashlib, is updated with each chunk as it is sent.
+class Pl_PythonChunks : public Pipeline
+{
+public:
+    Pl_PythonChunks(const char *identifier, py::object callback, size_t chunk_size,
+                    py::object hasher = py::none(),
+                    std::shared_ptr<PdfStats> stats = nullptr) :
+        Pipeline(identifier, nullptr),
+        callback(callback),
+        hasher(hasher),
+        chunk_size(chunk_size),
+        stats(stats)
+    {
+        if (chunk_size == 0)
+            throw py::value_error("chunk_size must be positive");
+        this->buffer.reserve(chunk_size);
+    }
+
+    virtual ~Pl_PythonChunks() = default;
+    Pl_PythonChunks(const Pl_PythonChunks&) = delete;
+    Pl_PythonChunks& operator= (const Pl_PythonChunks&) = delete;
+    Pl_PythonChunks(Pl_PythonChunks&&) = delete;
+    Pl_PythonChunks& operator= (Pl_PythonChunks&&) = delete;
+
+    void write(unsigned char *buf, size_t len) override;
+    void finish() override;
+
+    unsigned long long bytes_written() const
+    {
+        return this->count;
+    }
+
+private:
+    void send_chunk();
+
+    py::object callback;
+    py::object hasher;
+    size_t chunk_size;
+    std::vector<unsigned char> buffer;
+    unsigned long long count = 0;
+    std::shared_ptr<PdfStats> stats;
+};
+
+
+// Write to an operating system file descriptor without involving Python.
+// The file descriptor is borrowed and is not closed.
+class Pl_FileDescriptorOutput : public Pipeline
+{
+public:
+    Pl_FileDescriptorOutput(const char *identifier, int fd,
+                            size_t block_size = FILE_OUTPUT_BLOCK_SIZE) :
+        Pipeline(identifier, nullptr),
+        fd(fd),
+        block_size(block_size)
+    {
+        this->buffer.reserve(block_size);
+    }
+
+    virtual ~Pl_FileDescriptorOutput() = default;
+    Pl_FileDescriptorOutput(const Pl_FileDescriptorOutput&) = delete;
+    Pl_FileDescriptorOutput& operator= (const Pl_FileDescriptorOutput&) = delete;
+    Pl_FileDescriptorOutput(Pl_FileDescriptorOutput&&) = delete;
+    Pl_FileDescriptorOutput& operator= (Pl_FileDescriptorOutput&&) = delete;
+
+    void write(unsigned char *buf, size_t len) override;
+    void finish() override;
+
+private:
+    void write_to_fd(unsigned char *buf, size_t len);
+    void flush_buffer();
+
+    int fd;
+    size_t block_size;
+    std::vector<unsigned char> buffer;
 };
@@ -0,0 +1,185 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#pragma once
+
+#include <cstring>
+#include <memory>
+
+#include <qpdf/Buffer.hh>
+#include <qpdf/BufferInputSource.hh>
+#include <qpdf/InputSource.hh>
+#include <qpdf/Pipeline.hh>
+#include <qpdf/PointerHolder.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include <pybind11/pybind11.h>
+
+#include "pikepdf.h"
+#include "qpdf_state.h"
+
+// Zero-copy access to the memory of Python objects that support the buffer
+// protocol, for qpdf to read from.
+//
+// GIL usage:
+// The buffer is requested with the GIL held. While it is held, the exporting
+// object is pinned (e.g. a bytearray cannot be resized), so its memory may be
+// read without the GIL. Releasing the buffer acquires the GIL, since qpdf may
+// destroy its input sources and stream data providers at any time.
+class PinnedPyBuffer {
+public:
+    explicit PinnedPyBuffer(py::handle obj) : owner(py::reinterpret_borrow<py::object>(obj))
+    {
+        // PyBUF_SIMPLE fails for buffers that are not C contiguous
+        if (PyObject_GetBuffer(obj.ptr(), &this->view, PyBUF_SIMPLE) != 0)
+            throw py::error_already_set();
+    }
+    ~PinnedPyBuffer()
+    {
+        py::gil_scoped_acquire acquire;
+        PyBuffer_Release(&this->view);
+        this->owner = py::object();
+    }
+    PinnedPyBuffer(const PinnedPyBuffer&) = delete;
+    PinnedPyBuffer& operator= (const PinnedPyBuffer&) = delete;
+
+    unsigned char *data() const
+    {
+        return static_cast<unsigned char*>(this->view.buf);
+    }
+    size_t size() const
+    {
+        return static_cast<size_t>(this->view.len);
+    }
+    bool readonly() const
+    {
+        return this->view.readonly;
+    }
+
+private:
+    py::object owner;
+    Py_buffer view;
+};
+
+// An InputSource over a Python buffer, which keeps the buffer alive for as long
+// as qpdf needs it.
+class PyBufferInputSource : public InputSource
+{
+public:
+    PyBufferInputSource(py::handle obj, const std::string& description,
+        std::shared_ptr<PdfStats> stats = nullptr) :
+            InputSource(), buffer(new PinnedPyBuffer(obj))
+    {
+        // All of the data is in memory from the start
+        stats_count_read(stats, this->buffer->size());
+        // This Buffer refers to the Python buffer's memory without owning it
+        this->qpdf_buffer = std::make_unique<Buffer>(
+            this->buffer->data(), this->buffer->size());
+        this->bis = std::make_unique<BufferInputSource>(
+            description,
+            this->qpdf_buffer.get(),
+            false  // own_memory=false
+        );
+    }
+    virtual ~PyBufferInputSource() = default;
+    PyBufferInputSource(const PyBufferInputSource&) = delete;
+    PyBufferInputSource& operator= (const PyBufferInputSource&) = delete;
+
+    std::string const& getName() const override
+    {
+        return this->bis->getName();
+    }
+
+    qpdf_offset_t tell() override
+    {
+        return this->bis->tell();
+    }
+
+    void seek(qpdf_offset_t offset, int whence) override
+    {
+        this->bis->seek(offset, whence);
+    }
+
+    // LCOV_EXCL_START
+    void rewind() override
+    {
+        this->bis->rewind();
+    }
+    // LCOV_EXCL_STOP
+
+    size_t read(char* buffer, size_t length) override
+    {
+        auto result = this->bis->read(buffer, length);
+        this->last_offset = this->bis->getLastOffset();
+        return result;
+    }
+
+    void unreadCh(char ch) override
+    {
+        this->bis->unreadCh(ch);
+    }
+
+    qpdf_offset_t findAndSkipNextEOL() override
+    {
+        return this->bis->findAndSkipNextEOL();
+    }
+
+private:
+    // Declared first so that it is destroyed last
+    std::unique_ptr<PinnedPyBuffer> buffer;
+    std::unique_ptr<Buffer> qpdf_buffer;
+    std::unique_ptr<BufferInputSource> bis;
+};
+
+// Provides stream data directly from a read-only Python buffer.
+class PyBufferStreamProvider : public QPDFObjectHandle::StreamDataProvider
+{
+public:
+    PyBufferStreamProvider(std::unique_ptr<PinnedPyBuffer> buffer) :
+            buffer(std::move(buffer)) {}
+    virtual ~PyBufferStreamProvider() = default;
+
+    void provideStreamData(int objid, int generation, Pipeline* pipeline) override
+    {
+        pipeline->write(this->buffer->data(), this->buffer->size());
+        pipeline->finish();
+    }
+
+private:
+    std::unique_ptr<PinnedPyBuffer> buffer;
+};
+
+// Replace a stream's data with the contents of a Python buffer. Read-only
+// buffers, such as bytes, are referenced rather than copied; writable buffers
+// are copied once, so that later changes to them do not alter the stream.
+// The stream is recorded as replaced, for save_incremental.
+inline void stream_replace_data(
+    QPDFObjectHandle h,
+    py::handle data,
+    QPDFObjectHandle filter,
+    QPDFObjectHandle decode_parms)
+{
+    auto owner = h.getOwningQPDF();
+    if (owner)
+        pdf_state(*owner).replaced_streams.insert(h.getObjGen());
+    auto buffer = std::make_unique<PinnedPyBuffer>(data);
+    auto size = buffer->size();
+    if (!buffer->readonly()) {
+        PointerHolder<Buffer> copy(new Buffer(size));
+        if (size > 0)
+            std::memcpy(copy->getBuffer(), buffer->data(), size);
+        h.replaceStreamData(copy, filter, decode_parms);
+        return;
+    }
+    PointerHolder<QPDFObjectHandle::StreamDataProvider> provider(
+        new PyBufferStreamProvider(std::move(buffer)));
+    h.replaceStreamData(provider, filter, decode_parms);
+    // qpdf leaves /Length unset for provided data, but we know it, and qpdf
+    // checks that the provider delivers exactly this much
+    h.getDict().replaceKey("/Length", QPDFObjectHandle::newInteger(size));
+}
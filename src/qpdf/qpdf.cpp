@@ -6,6 +6,8 @@
  * Copyright (C) 2017, James R. Barlow (https://github.com/jbarlow83/)
  */
 
+#include <chrono>
+#include <set>
 #include <sstream>
 #include <type_traits>
 #include <cerrno>
@@ -22,15 +24,18 @@
 #include <qpdf/QPDFWriter.hh>
 #include <qpdf/QPDFPageDocumentHelper.hh>
 #include <qpdf/Pl_Discard.hh>
-#include <qpdf/QPDFAcroFormDocumentHelper.hh>
 
 #include <pybind11/stl.h>
 #include <pybind11/iostream.h>
 #include <pybind11/buffer_info.h>
 
 #include "qpdf_pagelist.h"
+#include "object_iterator.h"
 #include "qpdf_inputsource.h"
 #include "mmap_inputsource.h"
+#include "fd_inputsource.h"
+#include "pybuffer.h"
+#include "qpdf_state.h"
 #include "pipeline.h"
 #include "utils.h"
 #include "gsl.h"
@@ -38,7 +43,7 @@
 
 extern bool MMAP_DEFAULT;
 
-enum access_mode_e { access_default, access_stream, access_mmap, access_mmap_only };
+enum access_mode_e { access_default, access_stream, access_mmap, access_mmap_only, access_fd };
 
 
 void check_stream_is_usable(py::object stream)
@@ -65,9 +70,10 @@ open_pdf(
     bool suppress_warnings=true,
     bool attempt_recovery=true,
     bool inherit_page_attributes=true,
-    access_mode_e access_mode=access_mode_e::access_default)
+    access_mode_e access_mode=access_mode_e::access_default,
+    bool lazy=false)
 {
-    auto q = std::make_shared<QPDF>();
+    auto q = make_qpdf();
 
     qpdf_basic_settings(*q);
     q->setSuppressWarnings(suppress_warnings);
@@ -95,47 +101,78 @@ open_pdf(
         description = py::str(filename);
     }
 
+    auto &state = pdf_state(*q);
+    auto read_start = std::chrono::steady_clock::now();
     bool success = false;
-    if (access_mode == access_default)
+    if (access_mode == access_default) {
         access_mode = MMAP_DEFAULT ? access_mmap : access_stream;
+    }
 
     if (access_mode == access_mmap || access_mode == access_mmap_only) {
         try {
             py::gil_scoped_release release;
-            auto mmap_input_source = std::make_unique<MmapInputSource>(
-                stream, description, closing_stream
-            );
-            auto input_source = PointerHolder<InputSource>(mmap_input_source.release());
+            state.stats->input_kind = "mmap";
+            auto input_source = PointerHolder<InputSource>(new MmapInputSource(
+                stream, description, closing_stream, state.stats
+            ));
+            state.input = input_source;
             q->processInputSource(input_source, password.c_str());
             success = true;
         } catch (const py::error_already_set &e) {
             if (access_mode == access_mmap) {
-                // Prepare to fallback to stream access
+                // Prepare to fallback to file descriptor or stream access
                 stream.attr("seek")(0);
-                access_mode = access_stream;
+                access_mode = access_fd;
             } else {
                 throw;
             }
         }
     }
 
+    if (!success && access_mode == access_fd) {
+        try {
+            py::gil_scoped_release release;
+            state.stats->input_kind = "fd";
+            auto input_source = PointerHolder<InputSource>(new FileDescriptorInputSource(
+                stream, description, closing_stream, state.stats
+            ));
+            state.input = input_source;
+            q->processInputSource(input_source, password.c_str());
+            success = true;
+        } catch (const py::error_already_set &e) {
+            // No usable file descriptor; fall back to stream access
+            stream.attr("seek")(0);
+            access_mode = access_stream;
+        }
+    }
+
     if (!success && access_mode == access_stream) {
         py::gil_scoped_release release;
-        auto stream_input_source = std::make_unique<PythonStreamInputSource>(
-            stream, description, closing_stream
-        );
-        auto input_source = PointerHolder<InputSource>(stream_input_source.release());
+        state.stats->input_kind = "stream";
+        auto input_source = PointerHolder<InputSource>(new PythonStreamInputSource(
+            stream, description, closing_stream, state.stats
+        ));
+        state.input = input_source;
         q->processInputSource(input_source, password.c_str());
         success = true;
     }
 
     // At this point, either we succeeded or threw an exception
+    std::chrono::duration<double> read_time = std::chrono::steady_clock::now() - read_start;
+    state.read_seconds = read_time.count();
 
-    if (inherit_page_attributes) {
+    if (inherit_page_attributes && lazy) {
+        // Done page by page as pages are accessed, and for the rest, on save
+        state.inherit_pending = true;
+    } else if (inherit_page_attributes) {
         // This could be expensive for a large file, plausibly (not tested),
         // so release the GIL again.
         py::gil_scoped_release release;
+        auto inherit_start = std::chrono::steady_clock::now();
         q->pushInheritedAttributesToPage();
+        std::chrono::duration<double> inherit_time =
+            std::chrono::steady_clock::now() - inherit_start;
+        state.inherit_seconds = inherit_time.count();
     }
 
     return q;
@@ -143,7 +180,8 @@ open_pdf(
 
 class PikeProgressReporter : public QPDFWriter::ProgressReporter {
 public:
-    PikeProgressReporter(py::function callback)
+    PikeProgressReporter(py::function callback, std::shared_ptr<PdfStats> stats = nullptr) :
+        stats(stats)
     {
         this->callback = callback;
     }
@@ -152,22 +190,15 @@ public:
 
     virtual void reportProgress(int percent) override
     {
-        py::gil_scoped_acquire acquire;
+        stats_gil_acquire acquire(this->stats);
         this->callback(percent);
     }
 private:
     py::function callback;
+    std::shared_ptr<PdfStats> stats;
 };
 
 
-void update_xmp_pdfversion(QPDF &q, std::string version)
-{
-    auto impl = py::module_::import("pikepdf._cpphelpers").attr("update_xmp_pdfversion");
-    auto pypdf = py::cast(q);
-    impl(pypdf, version);
-}
-
-
 void setup_encryption(
     QPDFWriter &w,
     py::object encryption
@@ -343,7 +374,7 @@ pdf_version_extension get_version_extension(py::object ver_ext)
     return pdf_version_extension(version, extension);
 }
 
-void save_pdf(
+py::object save_pdf(
     QPDF& q,
     py::object filename_or_stream,
     bool static_id=false,
@@ -360,10 +391,14 @@ void save_pdf(
     py::object progress=py::none(),
     py::object encryption=py::none(),
     bool samefile_check=true,
-    bool recompress_flate=false)
+    bool recompress_flate=false,
+    py::object chunk_callback=py::none(),
+    size_t chunk_size=0,
+    py::object hasher=py::none())
 {
     std::string description;
     QPDFWriter w(q);
+    auto stats = pdf_state(q).stats;
 
     if (static_id) {
         w.setStaticID(true);
@@ -383,15 +418,19 @@ void save_pdf(
     w.setObjectStreamMode(object_stream_mode);
     w.setRecompressFlate(recompress_flate);
 
-    py::object stream;
+    py::object stream = py::none();
     bool should_close_stream = false;
     auto close_stream = gsl::finally([&stream, &should_close_stream] {
         if (should_close_stream && !stream.is_none() && py::hasattr(stream, "close"))
             stream.attr("close")();
     });
 
-    if (py::hasattr(filename_or_stream, "write") && py::hasattr(filename_or_stream, "seek")) {
-        // Python code gave us an object with a stream interface
+    if (!chunk_callback.is_none()) {
+        // Output goes to chunk_callback; there is no stream
+        description = "chunked output";
+    } else if (py::hasattr(filename_or_stream, "write")) {
+        // Python code gave us an object with a stream interface. QPDFWriter
+        // only ever appends, so the stream need not be seekable.
         stream = filename_or_stream;
         check_stream_is_usable(stream);
         description = py::repr(stream);
@@ -425,9 +464,24 @@ void save_pdf(
         description = py::str(output_filename);
     }
 
-    // We must set up the output pipeline before we configure encryption
-    Pl_PythonOutput output_pipe(description.c_str(), stream);
-    w.setOutputPipeline(&output_pipe);
+    // We must set up the output pipeline before we configure encryption.
+    // Plain files are written natively so that we need not reacquire the GIL
+    // during the write.
+    std::unique_ptr<Pipeline> output_pipe;
+    Pl_PythonChunks *chunks = nullptr;
+    int fd = stream.is_none() ? -1 : native_file_descriptor(stream);
+    if (!chunk_callback.is_none()) {
+        auto pipe = std::make_unique<Pl_PythonChunks>(
+            description.c_str(), chunk_callback, chunk_size, hasher, stats);
+        chunks = pipe.get();
+        output_pipe = std::move(pipe);
+    } else if (fd >= 0) {
+        output_pipe = std::make_unique<Pl_FileDescriptorOutput>(description.c_str(), fd);
+    } else {
+        output_pipe = std::make_unique<Pl_PythonOutput>(
+            description.c_str(), stream, PYTHON_OUTPUT_BLOCK_SIZE, stats);
+    }
+    w.setOutputPipeline(output_pipe.get());
 
     if (encryption.is(py::bool_(true)) && !q.isEncrypted()) {
         throw py::value_error("can't perserve encryption parameters on a file with no encryption");
@@ -459,16 +513,41 @@ void save_pdf(
         auto version_ext = get_version_extension(force_version);
         w.forcePDFVersion(version_ext.first, version_ext.second);
     }
+
+    // The output must not depend on whether the Pdf was opened lazily
+    page_inherit_attributes_all(q);
+
     if (fix_metadata_version) {
         update_xmp_pdfversion(q, w.getFinalVersion());
     }
 
     if (!progress.is_none()) {
-        auto reporter = PointerHolder<QPDFWriter::ProgressReporter>(new PikeProgressReporter(progress));
+        auto reporter = PointerHolder<QPDFWriter::ProgressReporter>(new PikeProgressReporter(progress, stats));
         w.registerProgressReporter(reporter);
     }
 
-    w.write();
+    std::chrono::duration<double> write_time;
+    {
+        // Anything that calls back into Python during the write, such as the
+        // progress reporter, token filters or Pl_PythonOutput, must acquire
+        // the GIL itself.
+        py::gil_scoped_release release;
+        auto write_start = std::chrono::steady_clock::now();
+        w.write();
+        write_time = std::chrono::steady_clock::now() - write_start;
+    }
+    pdf_state(q).write_seconds += write_time.count();
+
+    if (fd >= 0) {
+        // Bring the Python stream's idea of its position up to date. A
+        // buffered stream caches the position of its file descriptor, which
+        // flush() refreshes and, if readable, also discards its read buffer.
+        stream.attr("flush")();
+        stream.attr("seek")(native_file_tell(fd));
+    }
+    if (chunks)
+        return py::int_(chunks->bytes_written());
+    return py::none();
 }
 
 
@@ -496,12 +575,13 @@ void init_qpdf(py::module_ &m)
         .value("default", access_mode_e::access_default)
         .value("stream", access_mode_e::access_stream)
         .value("mmap", access_mode_e::access_mmap)
-        .value("mmap_only", access_mode_e::access_mmap_only);
+        .value("mmap_only", access_mode_e::access_mmap_only)
+        .value("fd", access_mode_e::access_fd);
 
     py::class_<QPDF, std::shared_ptr<QPDF>>(m, "Pdf", "In-memory representation of a PDF", py::dynamic_attr())
         .def_static("new",
             []() {
-                auto q = std::make_shared<QPDF>();
+                auto q = make_qpdf();
                 q->emptyPDF();
                 qpdf_basic_settings(*q);
                 return q;
@@ -516,7 +596,91 @@ void init_qpdf(py::module_ &m)
             py::arg("suppress_warnings") = true,
             py::arg("attempt_recovery") = true,
             py::arg("inherit_page_attributes") = true,
-            py::arg("access_mode") = access_mode_e::access_default
+            py::arg("access_mode") = access_mode_e::access_default,
+            py::arg("lazy") = false
+        )
+        .def_property_readonly("open_timings",
+            [](QPDF &q) {
+                auto const &state = pdf_state(q);
+                py::dict timings;
+                timings["read"] = state.read_seconds;
+                timings["inherit_page_attributes"] = state.inherit_seconds;
+                return timings;
+            },
+            R"~~~(
+            Time spent opening this PDF, in seconds, for each phase of opening.
+
+            ``read`` is the time spent reading the file's structure, including
+            reconstructing a damaged cross-reference table. ``inherit_page_attributes``
+            is the time spent pushing inherited attributes down to pages; for
+            a PDF opened with ``lazy=True``, this grows as pages are accessed.
+
+            .. versionadded:: 2.13
+            )~~~"
+        )
+        .def("stats",
+            [](QPDF &q) {
+                auto const &state = pdf_state(q);
+                auto &stats = *state.stats;
+                py::dict input;
+                input["kind"] = stats.input_kind;
+                input["bytes_read"] = stats.bytes_read.load();
+                input["read_calls"] = stats.read_calls.load();
+                // Only a Python stream is itself seeked; other inputs are
+                // read at an offset, or are in memory
+                if (stats.input_kind == "stream")
+                    input["seek_calls"] = stats.seek_calls.load();
+
+                py::dict streams_decoded;
+                {
+                    std::lock_guard<std::mutex> lock(stats.filters_mutex);
+                    for (auto const &kv : stats.filters) {
+                        py::dict filter;
+                        filter["streams"] = kv.second.streams;
+                        filter["bytes_in"] = kv.second.bytes_in;
+                        filter["bytes_out"] = kv.second.bytes_out;
+                        streams_decoded[py::str(kv.first)] = filter;
+                    }
+                }
+
+                py::dict seconds;
+                seconds["read"] = state.read_seconds;
+                seconds["inherit_page_attributes"] = state.inherit_seconds;
+                seconds["write"] = state.write_seconds;
+
+                py::dict result;
+                result["input"] = input;
+                result["gil_acquisitions"] = stats.gil_acquisitions.load();
+                result["objects"] = q.getObjectCount();
+                result["streams_decoded"] = streams_decoded;
+                result["seconds"] = seconds;
+                return result;
+            },
+            R"~~~(
+            Return counters that describe the work done on this PDF so far.
+
+            These are meant for finding out why a particular file is slow.
+            The result is a dictionary:
+
+            * ``input``: how the file is read (``kind`` is ``mmap``, ``fd``,
+              ``stream`` or ``buffer``), and the number of bytes read and
+              reads of the file or stream itself. Reads from a file are
+              of a read-ahead window or of large stream data, and a memory
+              map or buffer counts as one read of its whole size. For a
+              ``stream``, ``seek_calls`` is the number of its seeks; other
+              kinds of input are not seeked.
+            * ``gil_acquisitions``: times that reading or saving called back
+              into Python, such as to read from a Python stream
+            * ``objects``: the number of objects in the file. qpdf resolves
+              objects without telling us, so this is the count it would
+              resolve, not the count resolved so far.
+            * ``streams_decoded``: for each ``/Filter``, the number of streams
+              decoded by pikepdf, and their encoded and decoded sizes
+            * ``seconds``: time spent reading the file, pushing inherited
+              attributes to pages, and writing, over all saves
+
+            .. versionadded:: 2.13
+            )~~~"
         )
         .def("__repr__",
             [](QPDF& q) {
@@ -599,9 +763,10 @@ void init_qpdf(py::module_ &m)
         .def("get_warnings", // this is a def because it modifies state by clearing warnings
             [](QPDF& q) {
                 py::list warnings;
-                for (auto w: q.getWarnings()) {
+                for (auto const &w: peek_warnings(q)) {
                     warnings.append(w.what());
                 }
+                pdf_state(q).held_warnings.clear();
                 return warnings;
             }
         )
@@ -614,6 +779,7 @@ void init_qpdf(py::module_ &m)
         .def("_add_page",
             [](QPDF& q, QPDFObjectHandle& page, bool first=false) {
                 q.addPage(page, first);
+                page_table_updated(q);
             },
             R"~~~(
             Attach a page to this PDF.
@@ -629,8 +795,19 @@ void init_qpdf(py::module_ &m)
             py::arg("first")=false,
             py::keep_alive<1, 2>()
         )
-        .def("_add_page_at", &QPDF::addPageAt, py::keep_alive<1, 2>())
-        .def("_remove_page", &QPDF::removePage)
+        .def("_add_page_at",
+            [](QPDF &q, QPDFObjectHandle page, bool before, QPDFObjectHandle refpage) {
+                q.addPageAt(page, before, refpage);
+                page_table_updated(q);
+            },
+            py::keep_alive<1, 2>()
+        )
+        .def("_remove_page",
+            [](QPDF &q, QPDFObjectHandle page) {
+                q.removePage(page);
+                page_table_updated(q);
+            }
+        )
         .def("remove_unreferenced_resources",
             [](QPDF& q) {
                 QPDFPageDocumentHelper helper(q);
@@ -671,7 +848,15 @@ void init_qpdf(py::module_ &m)
             py::arg("progress")=py::none(),
             py::arg("encryption")=py::none(),
             py::arg("samefile_check")=true,
-            py::arg("recompress_flate")=false
+            py::arg("recompress_flate")=false,
+            py::arg("chunk_callback")=py::none(),
+            py::arg("chunk_size")=0,
+            py::arg("hasher")=py::none()
+        )
+        .def("_save_incremental", save_incremental,
+            "Append changed objects to the original file. Use pikepdf.Pdf.save_incremental.",
+            py::arg("stream"),
+            py::arg("append")
         )
         .def("_get_object_id", &QPDF::getObjectByID)
         .def("get_object",
@@ -716,6 +901,40 @@ void init_qpdf(py::module_ &m)
             )~~~",
             py::return_value_policy::reference_internal
         )
+        .def("iter_objects",
+            [](std::shared_ptr<QPDF> q, py::object type_code, py::object type,
+                    py::object subtype, py::object stream) {
+                return ObjectIterator(q, type_code, type, subtype, stream);
+            },
+            R"~~~(
+            Iterate over the objects in the PDF that match all of the filters given.
+
+            Objects are visited in object order, and those that do not match are
+            skipped natively, without creating Python objects for them. No list of
+            all objects is built, so this uses far less memory than
+            :attr:`objects` for large files.
+
+            Null objects, including free and missing objects, are skipped.
+            Objects created while iterating may not be visited.
+
+            Args:
+                type_code (pikepdf.ObjectType): Only objects of this type.
+                type (pikepdf.Name or str): Only dictionaries and streams whose
+                    ``/Type`` is this name, such as ``"/Font"``.
+                subtype (pikepdf.Name or str): Only dictionaries and streams whose
+                    ``/Subtype`` is this name, such as ``"/Image"``.
+                stream (bool): If ``True``, only streams; if ``False``, only
+                    objects that are not streams.
+
+            .. versionadded:: 2.13
+            )~~~",
+            py::kw_only(),
+            py::arg("type_code") = py::none(),
+            py::arg("type") = py::none(),
+            py::arg("subtype") = py::none(),
+            py::arg("stream") = py::none(),
+            py::keep_alive<0, 1>()
+        )
         .def("make_indirect", &QPDF::makeIndirectObject,
             R"~~~(
             Attach an object to the Pdf as an indirect object
@@ -784,9 +1003,68 @@ void init_qpdf(py::module_ &m)
             py::keep_alive<1, 2>(),
             py::arg("h")
         )
+        .def("copy_foreign_many",
+            [](QPDF &q, py::iterable objects) {
+                py::list result;
+                std::set<QPDF *> owners;
+                for (auto obj : objects) {
+                    auto h = obj.cast<QPDFObjectHandle>();
+                    if (owners.insert(h.getOwningQPDF()).second)
+                        keep_foreign_owner_alive(q, h.getOwningQPDF());
+                    result.append(q.copyForeignObject(h));
+                }
+                return result;
+            },
+            R"~~~(
+            Copy many objects from foreign ``Pdf`` to this one.
+
+            Equivalent to calling :meth:`copy_foreign` on each object, but
+            without a round trip through Python for each. Objects that the given
+            objects share, such as fonts, are copied only once for each foreign
+            ``Pdf``, as they would be by :meth:`copy_foreign`.
+
+            Returns:
+                list: The copies, in the same order.
+
+            .. versionadded:: 2.13
+            )~~~",
+            py::keep_alive<1, 2>(),
+            py::arg("objects")
+        )
+        .def("import_pages",
+            [](std::shared_ptr<QPDF> q, py::iterable sources, bool deduplicate_streams) {
+                import_pages(q, sources, deduplicate_streams);
+            },
+            R"~~~(
+            Append the pages of many PDFs to this one, in one operation.
+
+            This is much faster than calling ``pdf.pages.extend()`` for each
+            source when merging many files, since the page tree is updated
+            once rather than once per page.
+
+            Args:
+                sources: An iterable, each item of which is a :class:`pikepdf.Pdf`
+                    whose pages are all imported, a :attr:`Pdf.pages` list, or an
+                    iterable of pages.
+                deduplicate_streams (bool): If ``True``, streams in the imported
+                    pages' resources, such as embedded fonts and ICC profiles,
+                    that are identical to one imported earlier in the same call
+                    are replaced by references to the first, so that each is
+                    saved once.
+
+            .. versionadded:: 2.13
+            )~~~",
+            py::keep_alive<1, 2>(),
+            py::arg("sources"),
+            py::kw_only(),
+            py::arg("deduplicate_streams") = false
+        )
         .def("_replace_object",
             [](QPDF &q, std::pair<int, int> objgen, QPDFObjectHandle &h) {
                 q.replaceObject(objgen.first, objgen.second, h);
+                pdf_state(q).replaced_streams.insert(QPDFObjGen(objgen.first, objgen.second));
+                // The object may be part of the page tree
+                pdf_state(q).page_table_known = false;
             }
         )
         .def("_swap_objects",
@@ -794,21 +1072,32 @@ void init_qpdf(py::module_ &m)
                 QPDFObjGen o1(objgen1.first, objgen1.second);
                 QPDFObjGen o2(objgen2.first, objgen2.second);
                 q.swapObjects(o1, o2);
+                pdf_state(q).replaced_streams.insert(o1);
+                pdf_state(q).replaced_streams.insert(o2);
+                pdf_state(q).page_table_known = false;
             }
         )
         .def("_process",
-            [](QPDF &q, std::string description, py::bytes data) {
-                std::string s = data;
-                q.processMemoryFile(
-                    description.c_str(),
-                    s.data(),
-                    s.size()
-                );
+            [](QPDF &q, std::string description, py::buffer data) {
+                // qpdf reads from the buffer lazily, so it must stay alive
+                // for as long as this QPDF uses it; we do not copy it
+                auto stats = pdf_state(q).stats;
+                stats->input_kind = "buffer";
+                auto input_source = PointerHolder<InputSource>(
+                    new PyBufferInputSource(data, description, stats));
+                pdf_state(q).input = input_source;
+                pdf_state(q).replaced_streams.clear();
+                pdf_state(q).appended_stream_dicts.clear();
+                q.processInputSource(input_source);
+                // qpdf's page cache still describes the previous PDF
+                q.updateAllPagesCache();
+                page_table_updated(q);
             },
             R"~~~(
             Process a new in-memory PDF, replacing the existing PDF
 
-            Used to implement Pdf.close().
+            Used to implement Pdf.close(). The data may be any contiguous
+            buffer, which is referenced rather than copied.
             )~~~"
         )
         .def("_decode_all_streams_and_discard",
@@ -909,11 +1198,7 @@ void init_qpdf(py::module_ &m)
             .. versionadded:: 2.10
             )~~~"
         )
-        .def("generate_appearance_streams",
-            [](QPDF &q) {
-                QPDFAcroFormDocumentHelper afdh(q);
-                afdh.generateAppearancesIfNeeded();
-            },
+        .def("generate_appearance_streams", &generate_appearance_streams,
             R"~~~(
             Generates appearance streams for AcroForm forms and form fields.
 
@@ -931,30 +1216,26 @@ void init_qpdf(py::module_ &m)
             because it may modify objects that the user does not expect to be
             modified.
 
+            Args:
+                annotations: If given, appearance streams are generated only
+                    for these widget annotations, which may be given as
+                    :class:`pikepdf.Annotation`, their objects, or
+                    ``(objid, gen)`` tuples such as those returned by
+                    :meth:`pikepdf.Pdf.scan_annotations`. They are generated
+                    whether or not the form is marked as needing appearances,
+                    and the mark is left unchanged.
+
             See:
                 https://github.com/qpdf/qpdf/blob/bf6b9ba1c681a6fac6d585c6262fb2778d4bb9d2/include/qpdf/QPDFFormFieldObjectHelper.hh#L216
 
             .. versionadded:: 2.11
-            )~~~"
-        )
-        .def("flatten_annotations",
-            [](QPDF &q, std::string mode) {
-                QPDFPageDocumentHelper dh(q);
-                auto required = 0;
-                auto forbidden = an_invisible | an_hidden;
-
-                if (mode == "screen") {
-                    forbidden |= an_no_view;
-                } else if (mode == "print") {
-                    required |= an_print;
-                } else if (mode == "" || mode == "all") {
-                    // No op
-                } else {
-                    throw py::value_error("Mode must be one of 'all', 'screen', 'print'.");
-                }
 
-                dh.flattenAnnotations(required, forbidden);
-            },
+            .. versionchanged:: 2.13
+                Added ``annotations``.
+            )~~~",
+            py::arg("annotations") = py::none()
+        )
+        .def("flatten_annotations", &flatten_annotations,
             R"~~~(
             Flattens all PDF annotations into regular PDF content.
 
@@ -973,10 +1254,18 @@ void init_qpdf(py::module_ &m)
                     omitted or  set to empty, treated as ``'all'``. ``'screen'``
                     flattens all except those marked with the PDF flag /NoView.
                     ``'print'`` flattens only those marked for printing.
+                annotations: If given, only these annotations are flattened,
+                    given as for :meth:`generate_appearance_streams`. Those
+                    without an appearance stream are left as they are, and
+                    the rest of the form is kept.
 
             .. versionadded:: 2.11
+
+            .. versionchanged:: 2.13
+                Added ``annotations``.
             )~~~",
-            py::arg("mode") = "all"
+            py::arg("mode") = "all",
+            py::arg("annotations") = py::none()
         )
         ; // class Pdf
 }
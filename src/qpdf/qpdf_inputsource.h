@@ -23,14 +23,16 @@
 #include <pybind11/stl.h>
 
 #include "pikepdf.h"
+#include "pdf_stats.h"
 #include "utils.h"
 
 
 class PythonStreamInputSource : public InputSource
 {
 public:
-    PythonStreamInputSource(py::object stream, std::string name, bool close) :
-            stream(stream), name(name), close(close)
+    PythonStreamInputSource(py::object stream, std::string name, bool close,
+        std::shared_ptr<PdfStats> stats = nullptr) :
+            stream(stream), name(name), close(close), stats(stats)
     {
         py::gil_scoped_acquire gil;
         if (!stream.attr("readable")().cast<bool>())
@@ -63,14 +65,14 @@ public:
 
     qpdf_offset_t tell() override
     {
-        py::gil_scoped_acquire gil;
-        return py::cast<qpdf_offset_t>(this->stream.attr("tell")());
+        stats_gil_acquire gil(this->stats);
+        return this->stream_tell();
     }
 
     void seek(qpdf_offset_t offset, int whence) override
     {
-        py::gil_scoped_acquire gil;
-        this->stream.attr("seek")(offset, whence);
+        stats_gil_acquire gil(this->stats);
+        this->stream_seek(offset, whence);
     }
 
     // LCOV_EXCL_START
@@ -83,35 +85,8 @@ public:
 
     size_t read(char* buffer, size_t length) override
     {
-        py::gil_scoped_acquire gil;
-
-#if defined(PYPY_VERSION)
-        // PyPy does not permit readinto(memoryview), so read to a buffer and
-        // memcpy that buffer. Error message is:
-        // "TypeError: a read-write bytes-like object is required, not memoryview"
-        this->last_offset = this->tell();
-        py::bytes result = this->stream.attr("read")(length);
-        py::buffer pybuf(result);
-        py::buffer_info info = pybuf.request();
-        size_t bytes_read = info.size * info.itemsize;
-
-        memcpy(buffer, info.ptr, std::min(length, bytes_read));
-#else
-        auto view_buffer_info = py::memoryview::from_memory(buffer, length);
-        this->last_offset = this->tell();
-        py::object result = this->stream.attr("readinto")(view_buffer_info);
-        if (result.is_none())
-            return 0;
-        size_t bytes_read = py::cast<size_t>(result);
-#endif
-        if (bytes_read == 0) {
-            if (length > 0) {
-                // EOF
-                this->seek(0, SEEK_END);
-                this->last_offset = this->tell();
-            }
-        }
-        return bytes_read;
+        stats_gil_acquire gil(this->stats);
+        return this->stream_read(buffer, length);
     }
 
     void unreadCh(char ch) override
@@ -121,7 +96,7 @@ public:
 
     qpdf_offset_t findAndSkipNextEOL() override
     {
-        py::gil_scoped_acquire gil;
+        stats_gil_acquire gil(this->stats);
 
         qpdf_offset_t result = 0;
         bool done = false;
@@ -130,11 +105,11 @@ public:
         std::string line_endings = "\r\n";
 
         while (!done) {
-            qpdf_offset_t cur_offset = this->tell();
-            size_t len = this->read(const_cast<char *>(buf.data()), buf.size());
+            qpdf_offset_t cur_offset = this->stream_tell();
+            size_t len = this->stream_read(const_cast<char *>(buf.data()), buf.size());
             if (len == 0) {
                 done = true;
-                result = this->tell();
+                result = this->stream_tell();
             } else {
                 size_t found;
                 if (!eol_straddles_buf) {
@@ -151,7 +126,7 @@ public:
                     continue;
                 }
                 result = cur_offset + found_end;
-                this->seek(result, SEEK_SET);
+                this->stream_seek(result, SEEK_SET);
                 done = true;
             }
         }
@@ -159,7 +134,54 @@ public:
     }
 
 private:
+    // The stream_ functions must be called with the GIL held
+
+    qpdf_offset_t stream_tell()
+    {
+        return py::cast<qpdf_offset_t>(this->stream.attr("tell")());
+    }
+
+    void stream_seek(qpdf_offset_t offset, int whence)
+    {
+        if (this->stats)
+            stats_count(this->stats->seek_calls);
+        this->stream.attr("seek")(offset, whence);
+    }
+
+    size_t stream_read(char* buffer, size_t length)
+    {
+#if defined(PYPY_VERSION)
+        // PyPy does not permit readinto(memoryview), so read to a buffer and
+        // memcpy that buffer. Error message is:
+        // "TypeError: a read-write bytes-like object is required, not memoryview"
+        this->last_offset = this->stream_tell();
+        py::bytes result = this->stream.attr("read")(length);
+        py::buffer pybuf(result);
+        py::buffer_info info = pybuf.request();
+        size_t bytes_read = info.size * info.itemsize;
+
+        memcpy(buffer, info.ptr, std::min(length, bytes_read));
+#else
+        auto view_buffer_info = py::memoryview::from_memory(buffer, length);
+        this->last_offset = this->stream_tell();
+        py::object result = this->stream.attr("readinto")(view_buffer_info);
+        if (result.is_none())
+            return 0;
+        size_t bytes_read = py::cast<size_t>(result);
+#endif
+        stats_count_read(this->stats, bytes_read);
+        if (bytes_read == 0) {
+            if (length > 0) {
+                // EOF
+                this->stream_seek(0, SEEK_END);
+                this->last_offset = this->stream_tell();
+            }
+        }
+        return bytes_read;
+    }
+
     py::object stream;
     std::string name;
     bool close;
+    std::shared_ptr<PdfStats> stats;
 };
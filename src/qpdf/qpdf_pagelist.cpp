@@ -8,6 +8,14 @@
 
 #include "pikepdf.h"
 #include "qpdf_pagelist.h"
+#include "qpdf_state.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <qpdf/QPDFPageObjectHelper.hh>
 #include <qpdf/QPDFPageLabelDocumentHelper.hh>
@@ -35,11 +43,23 @@ size_t uindex_from_index(PageList &pl, ssize_t index)
     return uindex;
 }
 
+std::vector<QPDFObjectHandle> const &PageList::pages() const
+{
+    return page_table(*this->qpdf);
+}
+
+void PageList::page_table_updated()
+{
+    ::page_table_updated(*this->qpdf);
+}
+
 QPDFObjectHandle PageList::get_page(size_t index) const
 {
-    auto pages = this->qpdf->getAllPages();
-    if (index < pages.size())
+    auto const &pages = this->pages();
+    if (index < pages.size()) {
+        page_inherit_attributes(*this->qpdf, pages.at(index));
         return pages.at(index);
+    }
     throw py::index_error("Accessing nonexistent PDF page number");
 }
 
@@ -48,10 +68,12 @@ std::vector<QPDFObjectHandle> PageList::get_pages_impl(py::slice slice) const
     size_t start, stop, step, slicelength;
     if (!slice.compute(this->count(), &start, &stop, &step, &slicelength))
         throw py::error_already_set();
+    auto const &pages = this->pages();
     std::vector<QPDFObjectHandle> result;
+    result.reserve(slicelength);
     for (size_t i = 0; i < slicelength; ++i) {
-        QPDFObjectHandle oh = this->get_page(start);
-        result.push_back(oh);
+        page_inherit_attributes(*this->qpdf, pages.at(start));
+        result.push_back(pages.at(start));
         start += step;
     }
     return result;
@@ -120,6 +142,7 @@ void PageList::delete_page(size_t index)
 {
     auto page = this->get_page(index);
     this->qpdf->removePage(page);
+    this->page_table_updated();
 }
 
 void PageList::delete_pages_from_iterable(py::slice slice)
@@ -131,11 +154,12 @@ void PageList::delete_pages_from_iterable(py::slice slice)
     for (auto page : kill_list) {
         this->qpdf->removePage(page);
     }
+    this->page_table_updated();
 }
 
 size_t PageList::count() const
 {
-    return this->qpdf->getAllPages().size();
+    return this->pages().size();
 }
 
 void PageList::insert_page(size_t index, py::handle obj)
@@ -180,6 +204,7 @@ void PageList::insert_page(size_t index, QPDFObjectHandle h)
         } else {
             this->qpdf->addPage(page, false);
         }
+        this->page_table_updated();
     } catch (const std::runtime_error &e) {
         if (copied) {
             // If we created a new object to hold the page, and failed, delete
@@ -190,6 +215,223 @@ void PageList::insert_page(size_t index, QPDFObjectHandle h)
     }
 }
 
+void PageList::reverse()
+{
+    // Reversing with qpdf's page operations would take quadratic time, since
+    // each insertion renumbers every page after it. Instead, flatten the page
+    // tree as qpdf would, and rewrite /Kids in one pass.
+    auto const &pages = this->pages();
+    std::vector<QPDFObjectHandle> reversed(pages.rbegin(), pages.rend());
+    if (reversed.size() < 2)
+        return;
+
+    this->qpdf->pushInheritedAttributesToPage();
+    auto pages_root = this->qpdf->getRoot().getKey("/Pages");
+    for (auto &page : reversed) {
+        page.replaceKey("/Parent", pages_root);
+    }
+    pages_root.replaceKey("/Kids", QPDFObjectHandle::newArray(reversed));
+    pages_root.replaceKey("/Count",
+        QPDFObjectHandle::newInteger(static_cast<long long>(reversed.size())));
+    this->qpdf->updateAllPagesCache();
+    this->page_table_updated();
+}
+
+// Makes identical streams (by dictionary and raw data) that are reachable
+// from the objects visited share one object, by rewriting references to later
+// copies to point to the first. The copies are left unreferenced, so they are
+// not saved.
+class StreamDeduplicator {
+public:
+    void visit(QPDFObjectHandle container)
+    {
+        if (container.isStream())
+            container = container.getDict();
+        if (container.isDictionary()) {
+            for (auto const &key : container.getKeys()) {
+                if (key == "/Parent")
+                    continue; // Don't climb into the page tree
+                auto value = container.getKey(key);
+                auto replacement = this->resolve(value);
+                if (replacement.getObjGen() != value.getObjGen())
+                    container.replaceKey(key, replacement);
+            }
+        } else if (container.isArray()) {
+            int n = container.getArrayNItems();
+            for (int i = 0; i < n; ++i) {
+                auto item = container.getArrayItem(i);
+                auto replacement = this->resolve(item);
+                if (replacement.getObjGen() != item.getObjGen())
+                    container.setArrayItem(i, replacement);
+            }
+        }
+    }
+
+private:
+    QPDFObjectHandle resolve(QPDFObjectHandle h)
+    {
+        if (!h.isIndirect()) {
+            this->visit(h);
+            return h;
+        }
+        auto og = h.getObjGen();
+        auto found = this->replacements.find(og);
+        if (found != this->replacements.end())
+            return found->second;
+        this->replacements[og] = h;
+        if (h.isPageObject())
+            return h;
+        // Deduplicate what the stream refers to first, so that identical
+        // streams have identical dictionaries
+        this->visit(h);
+        if (h.isStream()) {
+            auto canonical = this->canonical(h);
+            this->replacements[og] = canonical;
+            return canonical;
+        }
+        return h;
+    }
+
+    QPDFObjectHandle canonical(QPDFObjectHandle stream)
+    {
+        auto dict = stream.getDict().shallowCopy();
+        dict.removeKey("/Length");
+        auto dict_text = dict.unparse();
+        auto raw = stream.getRawStreamData();
+        std::string data(reinterpret_cast<const char *>(raw->getBuffer()), raw->getSize());
+        auto hash = std::hash<std::string>()(dict_text) ^
+            (std::hash<std::string>()(data) * 31);
+
+        auto &candidates = this->streams[hash];
+        for (auto const &candidate : candidates) {
+            if (candidate.dict_text != dict_text)
+                continue;
+            auto other = candidate.stream.getRawStreamData();
+            if (other->getSize() == raw->getSize() &&
+                    std::equal(data.begin(), data.end(), other->getBuffer()))
+                return candidate.stream;
+        }
+        candidates.push_back({stream, dict_text});
+        return stream;
+    }
+
+    struct Candidate {
+        QPDFObjectHandle stream;
+        std::string dict_text;
+    };
+    std::map<QPDFObjGen, QPDFObjectHandle> replacements;
+    std::unordered_map<size_t, std::vector<Candidate>> streams;
+};
+
+// The owner of each source is added to owners, so that sources produced by
+// the iterable, such as Pdfs opened by a generator, stay alive until copied
+static void add_source_pages(std::vector<QPDFObjectHandle> &pages,
+    std::vector<py::object> &owners, py::handle source)
+{
+    QPDF *src = nullptr;
+    if (py::isinstance<QPDF>(source)) {
+        src = &source.cast<QPDF &>();
+        owners.push_back(py::reinterpret_borrow<py::object>(source));
+    } else if (py::isinstance<PageList>(source)) {
+        auto &pl = source.cast<PageList &>();
+        src = pl.qpdf.get();
+        owners.push_back(py::cast(pl.qpdf));
+    }
+    if (src) {
+        auto const &src_pages = page_table(*src);
+        pages.insert(pages.end(), src_pages.begin(), src_pages.end());
+        return;
+    }
+    auto tinfo = py::detail::get_type_info(typeid(QPDF));
+    for (auto item : source.cast<py::iterable>()) {
+        assert_pyobject_is_page(item);
+        auto page = item.cast<QPDFObjectHandle>();
+        auto pyowner = py::detail::get_object_handle(page.getOwningQPDF(), tinfo);
+        if (pyowner)
+            owners.push_back(py::reinterpret_borrow<py::object>(pyowner));
+        pages.push_back(page);
+    }
+}
+
+void keep_foreign_owner_alive(QPDF &q, QPDF *owner)
+{
+    if (!owner || owner == &q)
+        return;
+    // Only look up the existing Python objects; casting a QPDF that has none
+    // would make Python its owner
+    auto tinfo = py::detail::get_type_info(typeid(QPDF));
+    auto pyqpdf = py::detail::get_object_handle(&q, tinfo);
+    auto pyowner = py::detail::get_object_handle(owner, tinfo);
+    if (pyqpdf && pyowner)
+        py::detail::keep_alive_impl(pyqpdf, pyowner);
+}
+
+void import_pages(std::shared_ptr<QPDF> q, py::iterable sources, bool deduplicate_streams)
+{
+    std::vector<QPDFObjectHandle> incoming;
+    std::vector<py::object> owners;
+    for (auto source : sources)
+        add_source_pages(incoming, owners, source);
+    if (incoming.empty())
+        return;
+
+    // As in reverse(), flatten the page tree as qpdf would, and rewrite /Kids
+    // once at the end, rather than insert each page with qpdf's page
+    // operations.
+    page_inherit_attributes_all(*q);
+    q->pushInheritedAttributesToPage();
+    auto pages_root = q->getRoot().getKey("/Pages");
+    std::vector<QPDFObjectHandle> kids = page_table(*q);
+    std::set<QPDFObjGen> in_tree;
+    for (auto const &page : kids)
+        in_tree.insert(page.getObjGen());
+
+    // qpdf keeps one table of copied objects for each foreign Pdf, so
+    // resources shared by pages of a source are copied once
+    std::set<QPDF *> prepared;
+    std::vector<QPDFObjectHandle> imported;
+    imported.reserve(incoming.size());
+    for (auto &page : incoming) {
+        QPDF *owner = page.getOwningQPDF();
+        QPDFObjectHandle copy;
+        if (owner == q.get() || !owner) {
+            // As insert_page() does
+            copy = q->makeIndirectObject(page.shallowCopy());
+        } else {
+            if (prepared.insert(owner).second) {
+                // q's copies of the pages read stream data from the owner
+                keep_foreign_owner_alive(*q, owner);
+                // As qpdf does before copying pages from a foreign Pdf
+                page_inherit_attributes_all(*owner);
+                owner->pushInheritedAttributesToPage();
+            }
+            copy = q->copyForeignObject(page);
+            if (in_tree.count(copy.getObjGen())) {
+                // The same foreign page again; qpdf would copy the page
+                // dictionary so that each page is a distinct object
+                copy = q->makeIndirectObject(copy.shallowCopy());
+            }
+        }
+        in_tree.insert(copy.getObjGen());
+        copy.replaceKey("/Parent", pages_root);
+        kids.push_back(copy);
+        imported.push_back(copy);
+    }
+
+    if (deduplicate_streams) {
+        StreamDeduplicator dedup;
+        for (auto &page : imported) {
+            dedup.visit(page.getKey("/Resources"));
+        }
+    }
+
+    pages_root.replaceKey("/Kids", QPDFObjectHandle::newArray(kids));
+    pages_root.replaceKey("/Count",
+        QPDFObjectHandle::newInteger(static_cast<long long>(kids.size())));
+    q->updateAllPagesCache();
+    ::page_table_updated(*q);
+}
+
 void init_pagelist(py::module_ &m)
 {
     py::class_<PageList>(m, "PageList")
@@ -251,15 +493,7 @@ void init_pagelist(py::module_ &m)
             py::arg("index"),
             py::arg("obj")
         )
-        .def("reverse",
-            [](PageList &pl) {
-                py::slice ordinary_indices(0, pl.count(), 1);
-                py::int_ step(-1);
-                py::slice reversed = py::reinterpret_steal<py::slice>(
-                    PySlice_New(Py_None, Py_None, step.ptr()));
-                py::list reversed_pages = pl.get_pages(reversed);
-                pl.set_pages_from_iterable(ordinary_indices, reversed_pages);
-            },
+        .def("reverse", &PageList::reverse,
             "Reverse the order of pages."
         )
         .def("append",
@@ -336,6 +570,11 @@ void init_pagelist(py::module_ &m)
             to this ``Pdf``.
             )~~~"
         )
+        .def_property_readonly("_pdf",
+            [](PageList &pl) {
+                return pl.qpdf;
+            }
+        )
         .def("__repr__",
             [](PageList &pl) {
                 return std::string("<pikepdf._qpdf.PageList len=")
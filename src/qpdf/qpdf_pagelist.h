@@ -14,6 +14,15 @@
 
 void init_pagelist(py::module_ &m);
 
+// Append pages from other Pdfs, page lists or iterables of pages to the end of
+// q's page tree in one operation, optionally deduplicating identical resource
+// streams among the pages imported.
+void import_pages(std::shared_ptr<QPDF> q, py::iterable sources, bool deduplicate_streams);
+
+// Keep the Python Pdf that owns objects copied into q alive for as long as q,
+// since qpdf reads the data of copied streams from their owner on saving.
+void keep_foreign_owner_alive(QPDF &q, QPDF *owner);
+
 class PageList {
 public:
     PageList(std::shared_ptr<QPDF> q, size_t iterpos = 0) : iterpos(iterpos), qpdf(q) {};
@@ -27,10 +36,13 @@ public:
     size_t count() const;
     void insert_page(size_t index, py::handle obj);
     void insert_page(size_t index, QPDFObjectHandle page);
+    void reverse();
+    std::vector<QPDFObjectHandle> const &pages() const;
 public:
     size_t iterpos;
     std::shared_ptr<QPDF> qpdf;
 
 private:
     std::vector<QPDFObjectHandle> get_pages_impl(py::slice slice) const;
+    void page_table_updated();
 };
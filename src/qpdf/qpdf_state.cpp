@@ -0,0 +1,189 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#include "pikepdf.h"
+#include "qpdf_state.h"
+
+// The registry itself is guarded by a mutex, since a QPDF may be destroyed
+// from any thread (for example, when a worker thread drops the last reference).
+static std::mutex registry_mutex;
+static std::unordered_map<const QPDF *, std::unique_ptr<PdfState>> registry;
+
+static void delete_qpdf(QPDF *q)
+{
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.erase(q);
+    }
+    delete q;
+}
+
+std::shared_ptr<QPDF> make_qpdf()
+{
+    auto q = std::shared_ptr<QPDF>(new QPDF(), delete_qpdf);
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry[q.get()] = std::make_unique<PdfState>();
+    return q;
+}
+
+PdfState &pdf_state(QPDF &q)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto it = registry.find(&q);
+    if (it == registry.end())
+        throw std::logic_error("Pdf was not created by make_qpdf()"); // LCOV_EXCL_LINE
+    return *it->second;
+}
+
+std::vector<QPDFExc> const &peek_warnings(QPDF &q)
+{
+    auto &held = pdf_state(q).held_warnings;
+    if (q.anyWarnings()) {
+        for (auto &warning : q.getWarnings())
+            held.push_back(warning);
+    }
+    return held;
+}
+
+// Edits from Python that may have changed some page tree. Protected by the GIL.
+static unsigned long long page_tree_edits = 0;
+
+static bool is_page_tree_node(QPDFObjectHandle h)
+{
+    if (!h.isDictionary())
+        return false;
+    auto type = h.getKey("/Type");
+    return type.isName() && (type.getName() == "/Page" || type.getName() == "/Pages");
+}
+
+void page_tree_edit(QPDFObjectHandle dict, std::string const &key)
+{
+    // Only these keys change the shape of a page tree, so that editing the
+    // attributes of each page in turn does not rebuild the page table.
+    static const std::set<std::string> tree_keys = {
+        "/Count", "/Kids", "/Pages", "/Parent", "/Type"};
+    if (tree_keys.count(key))
+        ++page_tree_edits;
+}
+
+void page_tree_edit(QPDFObjectHandle item)
+{
+    if (is_page_tree_node(item))
+        ++page_tree_edits;
+}
+
+static long long pages_tree_count(QPDFObjectHandle pages_root)
+{
+    auto count = pages_root.getKey("/Count");
+    return count.isInteger() ? count.getIntValue() : -1;
+}
+
+static void remember_page_table(PdfState &state, QPDFObjectHandle pages_root)
+{
+    state.page_table_known = true;
+    state.pages_root_og = pages_root.getObjGen();
+    state.pages_count = pages_tree_count(pages_root);
+    state.page_tree_edits = page_tree_edits;
+    state.page_index_known = false;
+    state.page_index.clear();
+}
+
+std::vector<QPDFObjectHandle> const &page_table(QPDF &q)
+{
+    auto &state = pdf_state(q);
+    auto pages_root = q.getRoot().getKey("/Pages");
+    if (!state.page_table_known ||
+            pages_root.getObjGen() != state.pages_root_og ||
+            pages_tree_count(pages_root) != state.pages_count ||
+            page_tree_edits != state.page_tree_edits) {
+        q.updateAllPagesCache();
+        remember_page_table(state, pages_root);
+    }
+    return q.getAllPages();
+}
+
+void page_table_updated(QPDF &q)
+{
+    remember_page_table(pdf_state(q), q.getRoot().getKey("/Pages"));
+}
+
+long long page_table_index(QPDF &q, QPDFObjGen og)
+{
+    auto const &pages = page_table(q);
+    auto &state = pdf_state(q);
+    if (!state.page_index_known) {
+        state.page_index.reserve(pages.size());
+        for (size_t i = 0; i < pages.size(); ++i) {
+            // Keep the first occurrence, as a linear search would
+            state.page_index.emplace(pages[i].getObjGen(), i);
+        }
+        state.page_index_known = true;
+    }
+    auto it = state.page_index.find(og);
+    if (it == state.page_index.end())
+        return -1;
+    return static_cast<long long>(it->second);
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void page_inherit_attributes(QPDF &q, QPDFObjectHandle page)
+{
+    auto &state = pdf_state(q);
+    if (!state.inherit_pending)
+        return;
+    auto start = std::chrono::steady_clock::now();
+    static const char *inheritable_keys[] = {"/MediaBox", "/CropBox", "/Resources", "/Rotate"};
+    for (auto key : inheritable_keys) {
+        if (page.hasKey(key))
+            continue;
+        std::set<QPDFObjGen> seen; // Guard against loops in /Parent
+        auto node = page.getKey("/Parent");
+        while (node.isDictionary()) {
+            if (node.isIndirect() && !seen.insert(node.getObjGen()).second)
+                break;
+            if (node.hasKey(key)) {
+                auto value = node.getKey(key);
+                // As pushInheritedAttributesToPage() does, share a direct
+                // value that is not a scalar as one indirect object, kept at
+                // the ancestor for the pages still to inherit it. qpdf removes
+                // it from the ancestor when the rest are pushed.
+                if (!value.isIndirect() && !value.isScalar()) {
+                    value = q.makeIndirectObject(value);
+                    node.replaceKey(key, value);
+                }
+                page.replaceKey(key, value);
+                break;
+            }
+            node = node.getKey("/Parent");
+        }
+    }
+    state.inherit_seconds += seconds_since(start);
+}
+
+void page_inherit_attributes_all(QPDF &q)
+{
+    auto &state = pdf_state(q);
+    if (!state.inherit_pending)
+        return;
+    auto start = std::chrono::steady_clock::now();
+    // Keys that pages already have, including those pushed by
+    // page_inherit_attributes(), are left alone
+    q.pushInheritedAttributesToPage();
+    state.inherit_pending = false;
+    state.inherit_seconds += seconds_since(start);
+}
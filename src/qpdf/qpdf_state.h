@@ -0,0 +1,126 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <qpdf/InputSource.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFExc.hh>
+#include <qpdf/QPDFObjGen.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include "pdf_stats.h"
+
+struct ObjGenHash {
+    size_t operator()(const QPDFObjGen &og) const
+    {
+        return std::hash<long long>()(
+            (static_cast<long long>(og.getObj()) << 16) ^ og.getGen());
+    }
+};
+
+// State that pikepdf keeps for each Pdf, alongside qpdf's own.
+//
+// QPDF is bound directly (there is no wrapper class), so this state lives in
+// a registry keyed by QPDF*. Every QPDF that pikepdf creates must come from
+// make_qpdf(), so that its state is released along with it. Access to the
+// fields of a PdfState is protected by the GIL, like the QPDF it belongs to.
+struct PdfState {
+    // qpdf's page cache is only updated by its own page operations. We record
+    // the /Pages tree root, its /Count and the count of page tree edits made
+    // from Python (see page_tree_edit) whenever we know the cache to be
+    // current; if any differs, the page tree was edited some other way.
+    bool page_table_known = false;
+    QPDFObjGen pages_root_og;
+    long long pages_count = -1;
+    unsigned long long page_tree_edits = 0;
+
+    // Reverse map from page objgen to index in the page table, built lazily
+    // and discarded whenever the page table changes.
+    bool page_index_known = false;
+    std::unordered_map<QPDFObjGen, size_t, ObjGenHash> page_index;
+
+    // Set once any token filter is attached to a stream. qpdf gives no way to
+    // ask a stream whether it has token filters.
+    bool has_token_filters = false;
+
+    // Set when the Pdf was opened with lazy=True and inherited attributes are
+    // yet to be pushed down to every page.
+    bool inherit_pending = false;
+
+    // Time spent opening the Pdf, in seconds. For a lazy open, the time spent
+    // pushing inherited attributes accumulates as pages are accessed.
+    double read_seconds = 0;
+    double inherit_seconds = 0;
+
+    // Time spent in QPDFWriter::write, summed over all saves
+    double write_seconds = 0;
+
+    // Shared with the Pdf's input source and with the pipelines of a save
+    std::shared_ptr<PdfStats> stats = std::make_shared<PdfStats>();
+
+    // The input source the Pdf was read from, if any. An incremental save
+    // copies the original file from it, and reads the original objects again.
+    // After an update is appended to the original file, it also returns the
+    // update.
+    PointerHolder<InputSource> input;
+
+    // Streams whose data was replaced from Python, and objects replaced or
+    // swapped with others. qpdf gives no way to ask a stream whether its data
+    // was replaced.
+    std::unordered_set<QPDFObjGen, ObjGenHash> replaced_streams;
+
+    // The dictionaries of the streams in appended updates, as they were
+    // before the update compressed them.
+    std::unordered_map<QPDFObjGen, std::string, ObjGenHash> appended_stream_dicts;
+
+    // qpdf's getWarnings() clears its warnings. Warnings that pikepdf reads
+    // for its own purposes are kept here, to be returned by get_warnings().
+    std::vector<QPDFExc> held_warnings;
+};
+
+// The Pdf's warnings so far, without clearing them.
+std::vector<QPDFExc> const &peek_warnings(QPDF &q);
+
+std::shared_ptr<QPDF> make_qpdf();
+PdfState &pdf_state(QPDF &q);
+
+// qpdf's page cache, refreshed first if the page tree was edited without
+// going through qpdf's page operations. O(1) when nothing has changed.
+std::vector<QPDFObjectHandle> const &page_table(QPDF &q);
+
+// Call after modifying the page tree with qpdf's page operations, which keep
+// qpdf's page cache current.
+void page_table_updated(QPDF &q);
+
+// Call when a dictionary or array is edited from Python, with the key or item
+// that changed. Edits that may change a page tree, to /Kids, /Count, /Parent,
+// /Pages or /Type, or to an array holding pages, make every Pdf check its page
+// table on next use. An
+// array item may be a direct object with no owner, so this is not per Pdf.
+void page_tree_edit(QPDFObjectHandle dict, std::string const &key);
+void page_tree_edit(QPDFObjectHandle item);
+
+// The index of the page with this objgen, or -1 if it is not in the page table.
+long long page_table_index(QPDF &q, QPDFObjGen og);
+
+// For a Pdf opened lazily, copy the attributes that a page inherits from its
+// ancestors to the page itself, as pushInheritedAttributesToPage() would have
+// at open. Call before giving a page from the page table to Python.
+void page_inherit_attributes(QPDF &q, QPDFObjectHandle page);
+
+// For a Pdf opened lazily, push inherited attributes down to every page now,
+// so that the page tree is as it would be after an eager open.
+void page_inherit_attributes_all(QPDF &q);
@@ -0,0 +1,76 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <qpdf/Buffer.hh>
+#include <qpdf/Constants.h>
+#include <qpdf/Pipeline.hh>
+#include <qpdf/PointerHolder.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFExc.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include "pikepdf.h"
+
+// A stream's raw data and filters, copied into a QPDF of its own so that it
+// can be decoded on another thread. Reading a stream's raw data from its
+// input is not thread-safe, so the caller does that first, on the thread that
+// owns the stream's QPDF. Throws if the filters cannot be copied, which
+// happens only if /DecodeParms refers to a stream (e.g. /JBIG2Globals).
+class ScratchStream {
+public:
+    ScratchStream(QPDFObjectHandle stream, PointerHolder<Buffer> raw) :
+            ScratchStream(raw, stream.getDict().getKey("/Filter"),
+                stream.getDict().getKey("/DecodeParms"))
+    {
+    }
+    // As above, but with the given filters instead of the stream's own
+    ScratchStream(PointerHolder<Buffer> raw, QPDFObjectHandle filter,
+        QPDFObjectHandle decode_parms) :
+            qpdf(new QPDF)
+    {
+        auto filter_copy = detached_copy(filter);
+        auto decode_parms_copy = detached_copy(decode_parms);
+        qpdf_basic_settings(*this->qpdf);
+        this->qpdf->emptyPDF();
+        this->stream = QPDFObjectHandle::newStream(this->qpdf.get());
+        this->stream.replaceStreamData(raw, filter_copy, decode_parms_copy);
+    }
+    ScratchStream(const ScratchStream&) = delete;
+    ScratchStream& operator= (const ScratchStream&) = delete;
+
+    bool pipe(Pipeline *p, int encode_flags, qpdf_stream_decode_level_e decode_level,
+        bool suppress_warnings, bool will_retry)
+    {
+        return this->stream.pipeStreamData(
+            p, encode_flags, decode_level, suppress_warnings, will_retry);
+    }
+
+    // Warnings issued while decoding
+    std::vector<QPDFExc> warnings()
+    {
+        return this->qpdf->getWarnings();
+    }
+
+private:
+    // A copy that shares nothing with the original QPDF
+    static QPDFObjectHandle detached_copy(QPDFObjectHandle h)
+    {
+        if (h.isNull())
+            return QPDFObjectHandle::newNull();
+        return QPDFObjectHandle::parse(h.unparseResolved());
+    }
+
+    // Declared first so that it is destroyed last
+    std::unique_ptr<QPDF> qpdf;
+    QPDFObjectHandle stream;
+};
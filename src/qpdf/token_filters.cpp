@@ -0,0 +1,469 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <qpdf/QPDFObjectHandle.hh>
+#include <qpdf/QPDFTokenizer.hh>
+#include <qpdf/QUtil.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+
+// Token filters that are configured from Python but run entirely in C++.
+//
+// A NativeTokenFilter groups tokens into instructions (an operator and the
+// tokens that precede it, including whitespace and comments) and passes each
+// instruction through its rules in order. Combining filters concatenates their
+// rules, so any number of them are applied in a single pass over the content
+// stream, rather than one tokenizing pass per filter.
+
+using Token = QPDFTokenizer::Token;
+
+struct Instruction {
+    std::vector<Token> tokens;
+    std::string op; // Empty for tokens after the last operator
+    bool drop = false;
+};
+
+class InstructionRule {
+public:
+    virtual ~InstructionRule() = default;
+    virtual void apply(Instruction &ins) const = 0;
+    virtual std::string describe() const = 0;
+};
+
+static bool is_number(const Token &token)
+{
+    return token.getType() == QPDFTokenizer::tt_integer ||
+        token.getType() == QPDFTokenizer::tt_real;
+}
+
+// As PDF syntax: fixed point, never an exponent, without trailing zeros
+static std::string format_number(double value)
+{
+    auto text = QUtil::double_to_string(value, 6);
+    if (text.find('.') != std::string::npos) {
+        text.erase(text.find_last_not_of('0') + 1);
+        if (text.back() == '.')
+            text.pop_back();
+    }
+    if (text == "-0")
+        text = "0";
+    return text;
+}
+
+// Calls fn(token) for each operand token that is not nested inside an array
+// or dictionary. Returns the number of such tokens.
+template <typename Fn>
+static size_t for_each_direct_operand(Instruction &ins, Fn fn)
+{
+    int depth = 0;
+    size_t count = 0;
+    for (size_t i = 0; i + 1 < ins.tokens.size(); ++i) {
+        auto &token = ins.tokens[i];
+        switch (token.getType()) {
+        case QPDFTokenizer::tt_array_open:
+        case QPDFTokenizer::tt_dict_open:
+            ++depth;
+            break;
+        case QPDFTokenizer::tt_array_close:
+        case QPDFTokenizer::tt_dict_close:
+            --depth;
+            break;
+        case QPDFTokenizer::tt_space:
+        case QPDFTokenizer::tt_comment:
+            break;
+        default:
+            if (depth == 0) {
+                fn(token, count);
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+class StripOperators : public InstructionRule {
+public:
+    StripOperators(std::set<std::string> operators) : operators(std::move(operators)) {}
+
+    void apply(Instruction &ins) const override
+    {
+        if (this->operators.count(ins.op))
+            ins.drop = true;
+    }
+
+    std::string describe() const override
+    {
+        std::string result = "strip_operators(";
+        for (auto it = this->operators.begin(); it != this->operators.end(); ++it) {
+            if (it != this->operators.begin())
+                result += " ";
+            result += *it;
+        }
+        return result + ")";
+    }
+
+private:
+    std::set<std::string> operators;
+};
+
+class RemapResourceNames : public InstructionRule {
+public:
+    RemapResourceNames(std::map<std::string, std::string> mapping) : mapping(std::move(mapping)) {}
+
+    void apply(Instruction &ins) const override
+    {
+        static const std::set<std::string> resource_operators{
+            "Do", "Tf", "gs", "sh", "cs", "CS", "scn", "SCN"};
+        // For marked content, only the second operand names a resource
+        bool marked_content = (ins.op == "BDC" || ins.op == "DP");
+        if (!marked_content && !resource_operators.count(ins.op))
+            return;
+
+        for_each_direct_operand(ins, [&](Token &token, size_t n) {
+            if (token.getType() != QPDFTokenizer::tt_name)
+                return;
+            if (marked_content && n != 1)
+                return;
+            auto found = this->mapping.find(token.getValue());
+            if (found != this->mapping.end())
+                token = Token(QPDFTokenizer::tt_name, found->second);
+        });
+    }
+
+    std::string describe() const override
+    {
+        return "remap_resource_names(" + std::to_string(this->mapping.size()) + " names)";
+    }
+
+private:
+    // Values are already in their unparsed (escaped) form
+    std::map<std::string, std::string> mapping;
+};
+
+class ReplaceColor : public InstructionRule {
+public:
+    ReplaceColor(std::vector<double> old_color, std::vector<double> new_color)
+        : old_color(std::move(old_color)), new_color(std::move(new_color)) {}
+
+    void apply(Instruction &ins) const override
+    {
+        bool stroke;
+        if (!this->matches_operator(ins.op, stroke))
+            return;
+
+        std::vector<double> values;
+        size_t first = ins.tokens.size();
+        bool all_numbers = true;
+        for_each_direct_operand(ins, [&](Token &token, size_t) {
+            if (!is_number(token)) {
+                all_numbers = false;
+                return;
+            }
+            if (values.empty())
+                first = static_cast<size_t>(&token - ins.tokens.data());
+            // Independent of the C locale, unlike std::stod
+            values.push_back(
+                QPDFObjectHandle::parse(token.getValue()).getNumericValue());
+        });
+        if (!all_numbers || values.size() != this->old_color.size())
+            return;
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (std::fabs(values[i] - this->old_color[i]) > TOLERANCE)
+                return;
+        }
+
+        // Keep any whitespace or comments before the operands
+        ins.tokens.resize(first);
+        for (auto value : this->new_color) {
+            ins.tokens.emplace_back(QPDFTokenizer::tt_real, format_number(value));
+            ins.tokens.emplace_back(QPDFTokenizer::tt_space, " ");
+        }
+        ins.op = color_operator(this->new_color.size(), stroke);
+        ins.tokens.emplace_back(QPDFTokenizer::tt_word, ins.op);
+    }
+
+    std::string describe() const override
+    {
+        return "replace_color(" + std::to_string(this->old_color.size()) + " -> " +
+            std::to_string(this->new_color.size()) + " components)";
+    }
+
+    static std::string color_operator(size_t components, bool stroke)
+    {
+        switch (components) {
+        case 1:
+            return stroke ? "G" : "g";
+        case 3:
+            return stroke ? "RG" : "rg";
+        case 4:
+            return stroke ? "K" : "k";
+        default:
+            throw py::value_error("a color must have 1 (gray), 3 (RGB) or 4 (CMYK) components");
+        }
+    }
+
+private:
+    static constexpr double TOLERANCE = 1e-5;
+
+    bool matches_operator(const std::string &op, bool &stroke) const
+    {
+        for (bool s : {false, true}) {
+            if (op == color_operator(this->old_color.size(), s)) {
+                stroke = s;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<double> old_color;
+    std::vector<double> new_color;
+};
+
+class NativeTokenFilter : public QPDFObjectHandle::TokenFilter {
+public:
+    NativeTokenFilter() = default;
+    NativeTokenFilter(std::vector<std::shared_ptr<InstructionRule>> rules)
+        : rules(std::move(rules)) {}
+    virtual ~NativeTokenFilter() = default;
+
+    void handleToken(Token const& token) override
+    {
+        auto type = token.getType();
+        if (type == QPDFTokenizer::tt_eof)
+            return;
+
+        this->pending.tokens.push_back(token);
+        switch (type) {
+        case QPDFTokenizer::tt_array_open:
+        case QPDFTokenizer::tt_dict_open:
+            ++this->depth;
+            break;
+        case QPDFTokenizer::tt_array_close:
+        case QPDFTokenizer::tt_dict_close:
+            --this->depth;
+            break;
+        case QPDFTokenizer::tt_inline_image:
+            // The inline image data, including EI, completes BI ... ID
+            this->in_inline_image = false;
+            this->pending.op = "BI";
+            this->flush();
+            break;
+        case QPDFTokenizer::tt_word:
+            if (this->in_inline_image || this->depth > 0)
+                break;
+            if (token.getValue() == "BI") {
+                this->in_inline_image = true;
+                break;
+            }
+            this->pending.op = token.getValue();
+            this->flush();
+            break;
+        default:
+            break;
+        }
+    }
+
+    void handleEOF() override
+    {
+        // Trailing whitespace, or operands with no operator, pass through
+        this->pending.op.clear();
+        for (const auto &token : this->pending.tokens)
+            this->writeToken(token);
+        this->pending = Instruction();
+        this->depth = 0;
+        this->in_inline_image = false;
+    }
+
+    const std::vector<std::shared_ptr<InstructionRule>> &get_rules() const
+    {
+        return this->rules;
+    }
+
+private:
+    void flush()
+    {
+        for (const auto &rule : this->rules) {
+            if (this->pending.drop)
+                break;
+            rule->apply(this->pending);
+        }
+        if (!this->pending.drop) {
+            for (const auto &token : this->pending.tokens)
+                this->writeToken(token);
+        }
+        this->pending = Instruction();
+        this->depth = 0;
+    }
+
+    std::vector<std::shared_ptr<InstructionRule>> rules;
+    Instruction pending;
+    int depth = 0;
+    bool in_inline_image = false;
+};
+
+static PointerHolder<NativeTokenFilter> make_native_filter(std::shared_ptr<InstructionRule> rule)
+{
+    return PointerHolder<NativeTokenFilter>(
+        new NativeTokenFilter(std::vector<std::shared_ptr<InstructionRule>>{rule}));
+}
+
+static std::string name_key(py::handle h)
+{
+    if (py::isinstance<py::str>(h)) {
+        auto s = h.cast<std::string>();
+        if (s.empty() || s[0] != '/')
+            throw py::value_error("resource names must begin with /");
+        return s;
+    }
+    auto name = objecthandle_encode(h);
+    if (!name.isName())
+        throw py::type_error("resource names must be pikepdf.Name or str");
+    return name.getName();
+}
+
+void init_token_filters(py::module_ &m)
+{
+    py::class_<NativeTokenFilter, PointerHolder<NativeTokenFilter>, QPDFObjectHandle::TokenFilter>(
+            m, "NativeTokenFilter",
+            R"~~~(
+            A content stream token filter that runs entirely in C++.
+
+            Native token filters perform common rewrites of content streams
+            without calling back into Python for each token, which makes them
+            much faster than a :class:`pikepdf.TokenFilter` subclass. Create
+            one with its static methods, and use it with
+            :meth:`pikepdf.Page.add_content_token_filter` or
+            :meth:`pikepdf.Page.get_filtered_contents` in the same way.
+
+            Filters work on whole instructions: an operator and its operands.
+            Combine filters with :meth:`chain` or ``|``, rather than adding
+            several to the same page, so that the content stream is only
+            tokenized once.
+
+            .. versionadded:: 2.13
+            )~~~"
+        )
+        .def_static("strip_operators",
+            [](const std::vector<std::string> &operators) {
+                return make_native_filter(std::make_shared<StripOperators>(
+                    std::set<std::string>(operators.begin(), operators.end())));
+            },
+            R"~~~(
+            Remove every instruction that uses one of these operators, along
+            with its operands.
+
+            Use ``'BI'`` to remove inline images.
+
+            Args:
+                operators (Iterable[str]): Operators, such as ``['re', 'f']``.
+            )~~~",
+            py::arg("operators")
+        )
+        .def_static("drop_text",
+            []() {
+                return make_native_filter(std::make_shared<StripOperators>(
+                    std::set<std::string>{"Tj", "TJ", "'", "\""}));
+            },
+            R"~~~(
+            Remove all text-showing operators (``Tj``, ``TJ``, ``'`` and ``"``).
+
+            Text state and positioning operators are kept, so other content
+            is not affected.
+            )~~~"
+        )
+        .def_static("remap_resource_names",
+            [](py::dict mapping) {
+                std::map<std::string, std::string> names;
+                for (auto item : mapping) {
+                    names[name_key(item.first)] =
+                        QPDFObjectHandle::newName(name_key(item.second)).unparse();
+                }
+                return make_native_filter(std::make_shared<RemapResourceNames>(std::move(names)));
+            },
+            R"~~~(
+            Rename the resources that operators refer to.
+
+            This changes the names used by the operators that refer to
+            resources (``Do``, ``Tf``, ``gs``, ``sh``, ``cs``, ``CS``,
+            ``scn``, ``SCN``, and the property list of ``BDC`` and ``DP``).
+            The page's ``/Resources`` dictionary must be updated to match.
+
+            Args:
+                mapping (Mapping[pikepdf.Name, pikepdf.Name]): Old names to new
+                    names, such as ``{Name.Im0: Name.Im1}``.
+            )~~~",
+            py::arg("mapping")
+        )
+        .def_static("replace_color",
+            [](std::vector<double> old_color, std::vector<double> new_color) {
+                // Validate both colors now rather than while filtering
+                ReplaceColor::color_operator(old_color.size(), false);
+                ReplaceColor::color_operator(new_color.size(), false);
+                return make_native_filter(
+                    std::make_shared<ReplaceColor>(std::move(old_color), std::move(new_color)));
+            },
+            R"~~~(
+            Replace a device color set with ``g``/``G``, ``rg``/``RG`` or
+            ``k``/``K`` with another.
+
+            Colors are matched to within 1e-5 per component. The number of
+            components selects the color space: 1 for gray, 3 for RGB and 4
+            for CMYK. The new color may be in a different device color space;
+            stroking colors remain stroking colors. Colors set in other color
+            spaces, with ``sc`` or ``scn``, are not changed.
+
+            Args:
+                old (Sequence[float]): The color to replace, such as ``(1, 0, 0)``.
+                new (Sequence[float]): Its replacement.
+            )~~~",
+            py::arg("old"),
+            py::arg("new")
+        )
+        .def_static("chain",
+            [](const std::vector<PointerHolder<NativeTokenFilter>> &filters) {
+                std::vector<std::shared_ptr<InstructionRule>> rules;
+                for (const auto &filter : filters) {
+                    const auto &more = filter->get_rules();
+                    rules.insert(rules.end(), more.begin(), more.end());
+                }
+                return PointerHolder<NativeTokenFilter>(new NativeTokenFilter(rules));
+            },
+            R"~~~(
+            Combine native filters into one, which applies each of them in
+            order in a single pass.
+            )~~~",
+            py::arg("filters")
+        )
+        .def("__or__",
+            [](const NativeTokenFilter &self, const NativeTokenFilter &other) {
+                auto rules = self.get_rules();
+                const auto &more = other.get_rules();
+                rules.insert(rules.end(), more.begin(), more.end());
+                return PointerHolder<NativeTokenFilter>(new NativeTokenFilter(rules));
+            },
+            py::is_operator()
+        )
+        .def("__repr__",
+            [](const NativeTokenFilter &self) {
+                std::string result = "<pikepdf.NativeTokenFilter";
+                for (const auto &rule : self.get_rules())
+                    result += " " + rule->describe();
+                return result + ">";
+            }
+        );
+}
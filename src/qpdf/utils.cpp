@@ -7,18 +7,36 @@
  */
 
 #include <cstdlib>
+#include <climits>
 #include <system_error>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include "utils.h"
 
 /* POSIX functions on Windows have a leading underscore
  */
 #if defined(_WIN32)
+#   include <io.h>
 #   define posix_fdopen _fdopen
 #   define posix_close  _close
+#   define posix_write  _write
+#   define posix_read   _read
+#   define posix_lseek  _lseeki64
+#   define posix_fstat  _fstat64
+    typedef struct _stat64 posix_stat_t;
+#   define posix_isreg(m) (((m) & _S_IFMT) == _S_IFREG)
 #else
+#   include <unistd.h>
 #   define posix_fdopen fdopen
 #   define posix_close  close
+#   define posix_write  write
+#   define posix_read   read
+#   define posix_lseek  lseek
+#   define posix_fstat  fstat
+    typedef struct stat posix_stat_t;
+#   define posix_isreg(m) S_ISREG(m)
 #endif
 
 /* Convert a Python object to a filesystem encoded path
@@ -34,3 +52,81 @@ py::object fspath(py::object filename)
         throw py::error_already_set();
     return py::reinterpret_steal<py::object>(handle);
 }
+
+/* Get the file descriptor of a stream that we can safely write to without
+ * going through Python, or -1 if the stream must be accessed from Python.
+ *
+ * Only the standard library's own file classes are accepted, since a subclass
+ * may override write() and expect it to be called. The file descriptor must
+ * refer to a regular file. The stream is flushed and the file descriptor's
+ * position is synchronized with the stream's logical position.
+ */
+int native_file_descriptor(py::object stream)
+{
+    auto io = py::module_::import("io");
+    auto stream_type = stream.get_type();
+    if (!(stream_type.is(io.attr("FileIO")) ||
+          stream_type.is(io.attr("BufferedWriter")) ||
+          stream_type.is(io.attr("BufferedRandom"))))
+        return -1;
+
+    int fd;
+    try {
+        if (!stream.attr("writable")().cast<bool>())
+            return -1;
+        fd = stream.attr("fileno")().cast<int>();
+    } catch (const py::error_already_set &) {
+        return -1;
+    }
+
+    posix_stat_t st;
+    if (posix_fstat(fd, &st) != 0 || !posix_isreg(st.st_mode))
+        return -1;
+
+    stream.attr("flush")();
+    auto pos = stream.attr("tell")().cast<long long>();
+    if (posix_lseek(fd, pos, SEEK_SET) < 0)
+        return -1;
+    return fd;
+}
+
+long long native_file_tell(int fd)
+{
+    return posix_lseek(fd, 0, SEEK_CUR);
+}
+
+long long native_file_write(int fd, const unsigned char *buf, size_t len)
+{
+#if defined(_WIN32)
+    if (len > INT_MAX)
+        len = INT_MAX;
+    return posix_write(fd, buf, static_cast<unsigned int>(len));
+#else
+    return posix_write(fd, buf, len);
+#endif
+}
+
+/* Read from a file descriptor at an explicit offset, without using or changing
+ * the file position where possible.
+ */
+long long native_file_pread(int fd, unsigned char *buf, size_t len, long long offset)
+{
+#if defined(_WIN32)
+    // No pread() on Windows; callers must not share the file descriptor
+    if (posix_lseek(fd, offset, SEEK_SET) < 0)
+        return -1;
+    if (len > INT_MAX)
+        len = INT_MAX;
+    return posix_read(fd, buf, static_cast<unsigned int>(len));
+#else
+    return pread(fd, buf, len, static_cast<off_t>(offset));
+#endif
+}
+
+long long native_file_size(int fd)
+{
+    posix_stat_t st;
+    if (posix_fstat(fd, &st) != 0)
+        return -1;
+    return st.st_size;
+}
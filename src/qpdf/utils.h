@@ -12,6 +12,13 @@
 
 py::object fspath(py::object filename);
 
+// Native file descriptor access, for I/O that does not need the GIL
+int native_file_descriptor(py::object stream);
+long long native_file_tell(int fd);
+long long native_file_write(int fd, const unsigned char *buf, size_t len);
+long long native_file_pread(int fd, unsigned char *buf, size_t len, long long offset);
+long long native_file_size(int fd);
+
 template <typename T, typename S>
 inline bool str_startswith(T haystack, S needle)
 {
@@ -0,0 +1,302 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <algorithm>
+#include <exception>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <qpdf/BufferInputSource.hh>
+#include <qpdf/Pl_Buffer.hh>
+#include <qpdf/Pl_Discard.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFExc.hh>
+#include <qpdf/QPDFTokenizer.hh>
+
+#include <pybind11/stl.h>
+
+#include "pikepdf.h"
+#include "parallel.h"
+#include "qpdf_state.h"
+#include "scratch_stream.h"
+
+// Verification decodes every stream and parses every page's content streams
+// on native worker threads, rather than running QPDFWriter into Pl_Discard
+// and parsing pages from Python. Raw stream data is read serially, a window
+// at a time, since qpdf's input sources are not thread-safe. Each page is
+// checked as soon as all of its content streams are decoded, and decoded
+// content is dropped once no page left to check needs it.
+
+// (objid, generation, page index, kind, message). objid is 0 if the problem
+// does not concern an object, and the page index is -1 if not a page.
+using verify_problem = std::tuple<int, int, long long, std::string, std::string>;
+
+// Most raw stream data to hold in memory at once
+constexpr size_t VERIFY_WINDOW = 64 * 1024 * 1024;
+
+struct VerifyStream {
+    QPDFObjectHandle stream;
+    bool is_content = false;
+    size_t raw_size = 0;
+    std::unique_ptr<ScratchStream> scratch;
+    PointerHolder<Buffer> decoded; // Only kept for content streams
+    size_t pages_left = 0; // Pages yet to be checked that use this stream
+    std::vector<std::string> problems;
+};
+
+struct VerifyPage {
+    QPDFObjGen og;
+    std::vector<size_t> streams;
+    size_t ready_at = 0; // Checked once streams before this index are decoded
+    std::string problem;
+};
+
+static std::string exception_message(const std::exception &e)
+{
+    auto qpdf_exc = dynamic_cast<const QPDFExc *>(&e);
+    if (qpdf_exc)
+        return qpdf_exc->getMessageDetail();
+    return e.what();
+}
+
+// Decoding warnings name the object in the scratch QPDF; the problem already
+// refers to the original object
+static std::string scratch_message(const std::string &detail)
+{
+    const std::string prefix = "error decoding stream data for object ";
+    if (detail.compare(0, prefix.size(), prefix) == 0) {
+        auto colon = detail.find(": ", prefix.size());
+        if (colon != std::string::npos)
+            return "error decoding stream data: " + detail.substr(colon + 2);
+    }
+    return detail;
+}
+
+static void verify_read(VerifyStream &vs)
+{
+    PointerHolder<Buffer> raw;
+    try {
+        raw = vs.stream.getRawStreamData();
+    } catch (const std::exception &e) {
+        vs.problems.push_back(exception_message(e));
+        return;
+    }
+    vs.raw_size = raw->getSize();
+    try {
+        vs.scratch = std::make_unique<ScratchStream>(vs.stream, raw);
+    } catch (const std::exception &) {
+        // Filters that refer to other streams, such as JBIG2, which qpdf
+        // cannot decode anyway
+    }
+}
+
+static void verify_decode(VerifyStream &vs)
+{
+    if (!vs.scratch)
+        return;
+    bool decoded = false;
+    try {
+        if (vs.is_content) {
+            Pl_Buffer out("verify content stream");
+            decoded = vs.scratch->pipe(&out, 0, qpdf_dl_all, false, false);
+            if (decoded)
+                vs.decoded = PointerHolder<Buffer>(out.getBuffer());
+        } else {
+            Pl_Discard discard;
+            vs.scratch->pipe(&discard, 0, qpdf_dl_all, false, false);
+        }
+    } catch (const std::exception &e) {
+        vs.problems.push_back(exception_message(e));
+    }
+    for (auto &warning : vs.scratch->warnings())
+        vs.problems.push_back(scratch_message(warning.getMessageDetail()));
+    if (vs.is_content && !decoded && vs.problems.empty())
+        vs.problems.push_back("content stream uses filters that cannot be decoded");
+    vs.scratch.reset();
+}
+
+// Tokenize a page's content, and describe the first syntax error, if any.
+static std::string content_problem(const std::string &content)
+{
+    using tt = QPDFTokenizer::token_type_e;
+    const std::string description = "content stream";
+    PointerHolder<InputSource> input(new BufferInputSource(description, content));
+    QPDFTokenizer tokenizer;
+    tokenizer.allowEOF();
+    std::vector<tt> nesting;
+
+    while (true) {
+        auto token = tokenizer.readToken(input, description, true);
+        auto at = " at offset " + std::to_string(input->getLastOffset());
+        switch (token.getType()) {
+        case tt::tt_eof:
+            if (!nesting.empty())
+                return "content stream ends inside an array or dictionary";
+            return "";
+        case tt::tt_bad:
+            return token.getErrorMessage() + at;
+        case tt::tt_array_open:
+        case tt::tt_dict_open:
+            nesting.push_back(token.getType());
+            break;
+        case tt::tt_array_close:
+            if (nesting.empty() || nesting.back() != tt::tt_array_open)
+                return "unexpected ]" + at;
+            nesting.pop_back();
+            break;
+        case tt::tt_dict_close:
+            if (nesting.empty() || nesting.back() != tt::tt_dict_open)
+                return "unexpected >>" + at;
+            nesting.pop_back();
+            break;
+        case tt::tt_brace_open:
+        case tt::tt_brace_close:
+            return "unexpected brace" + at;
+        case tt::tt_word:
+            if (!nesting.empty())
+                return "operator " + token.getValue() + " inside an array or dictionary" + at;
+            if (token.getValue() == "ID") {
+                tokenizer.expectInlineImage(input);
+                auto image = tokenizer.readToken(input, description, true);
+                if (image.getType() != tt::tt_inline_image)
+                    return "inline image has no EI" + at;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void verify_page(VerifyPage &page, const std::vector<VerifyStream> &streams)
+{
+    if (!page.problem.empty())
+        return;
+    std::string content;
+    for (auto index : page.streams) {
+        auto const &vs = streams[index];
+        if (!vs.decoded.getPointer())
+            return; // Reported as a problem with the stream
+        // As qpdf does when it concatenates content streams
+        if (!content.empty())
+            content += '\n';
+        content.append(
+            reinterpret_cast<const char *>(vs.decoded->getBuffer()), vs.decoded->getSize());
+    }
+    page.problem = content_problem(content);
+}
+
+static std::vector<verify_problem> verify_pdf(QPDF &q, unsigned int workers)
+{
+    std::vector<VerifyStream> streams;
+    std::unordered_map<QPDFObjGen, size_t, ObjGenHash> stream_index;
+    for (auto &obj : q.getAllObjects()) {
+        if (!obj.isStream())
+            continue;
+        stream_index[obj.getObjGen()] = streams.size();
+        streams.emplace_back();
+        streams.back().stream = obj;
+    }
+
+    auto const &pages = page_table(q);
+    std::vector<VerifyPage> page_jobs(pages.size());
+    for (size_t i = 0; i < pages.size(); ++i) {
+        page_jobs[i].og = pages[i].getObjGen();
+        auto contents = pages[i].getKey("/Contents");
+        std::vector<QPDFObjectHandle> parts;
+        if (contents.isArray())
+            parts = contents.getArrayAsVector();
+        else if (!contents.isNull())
+            parts.push_back(contents);
+        for (auto &part : parts) {
+            auto found = part.isStream() ? stream_index.find(part.getObjGen()) : stream_index.end();
+            if (found == stream_index.end()) {
+                page_jobs[i].problem = "/Contents is not a stream or array of streams";
+                break;
+            }
+            auto &vs = streams[found->second];
+            vs.is_content = true;
+            ++vs.pages_left;
+            page_jobs[i].streams.push_back(found->second);
+            page_jobs[i].ready_at = std::max(page_jobs[i].ready_at, found->second + 1);
+        }
+    }
+    std::vector<size_t> page_order(page_jobs.size());
+    std::iota(page_order.begin(), page_order.end(), 0);
+    std::stable_sort(page_order.begin(), page_order.end(), [&](size_t a, size_t b) {
+        return page_jobs[a].ready_at < page_jobs[b].ready_at;
+    });
+
+    {
+        py::gil_scoped_release release;
+        size_t next_page = 0;
+        // Check the pages whose streams are all decoded
+        auto check_pages = [&](size_t decoded_end) {
+            size_t first = next_page;
+            while (next_page < page_order.size() &&
+                    page_jobs[page_order[next_page]].ready_at <= decoded_end)
+                ++next_page;
+            parallel_for(next_page - first, workers, [&](size_t i) {
+                verify_page(page_jobs[page_order[first + i]], streams);
+            });
+            for (size_t i = first; i < next_page; ++i) {
+                for (auto index : page_jobs[page_order[i]].streams) {
+                    auto &vs = streams[index];
+                    if (--vs.pages_left == 0)
+                        vs.decoded = PointerHolder<Buffer>();
+                }
+            }
+        };
+
+        check_pages(0);
+        size_t begin = 0;
+        while (begin < streams.size()) {
+            size_t end = begin;
+            size_t window = 0;
+            while (end < streams.size() && (end == begin || window < VERIFY_WINDOW)) {
+                verify_read(streams[end]);
+                window += streams[end].raw_size;
+                ++end;
+            }
+            parallel_for(end - begin, workers, [&](size_t i) {
+                verify_decode(streams[begin + i]);
+            });
+            begin = end;
+            check_pages(end);
+        }
+    }
+
+    std::vector<verify_problem> problems;
+    for (auto &vs : streams) {
+        for (auto &message : vs.problems)
+            problems.emplace_back(
+                vs.stream.getObjectID(), vs.stream.getGeneration(), -1, "stream", message);
+    }
+    for (size_t i = 0; i < page_jobs.size(); ++i) {
+        auto const &page = page_jobs[i];
+        if (!page.problem.empty())
+            problems.emplace_back(
+                page.og.getObj(), page.og.getGen(), i, "content", page.problem);
+    }
+    // Left for get_warnings() to report as well
+    for (auto const &warning : peek_warnings(q))
+        problems.emplace_back(0, 0, -1, "warning", warning.what());
+    return problems;
+}
+
+void init_verify(py::module_ &m)
+{
+    m.def("_verify", verify_pdf,
+        "Decode all streams and parse all content streams. Use pikepdf.Pdf.verify.",
+        py::arg("pdf"),
+        py::arg("workers")
+    );
+}
@@ -0,0 +1,342 @@
+/*
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright (C) 2021, James R. Barlow (https://github.com/jbarlow83/)
+ */
+
+#include <cctype>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <qpdf/Buffer.hh>
+#include <qpdf/QPDF.hh>
+#include <qpdf/QPDFObjectHandle.hh>
+
+#include "pikepdf.h"
+
+// Simple XMP properties, read and patched without parsing the packet.
+//
+// The packet is only scanned as text, so a property is reported only when it
+// appears once, in a form whose value can be read without an XML parser: an
+// attribute of rdf:Description, an element that contains only text, or a
+// language alternative whose first item contains only text. Anything that
+// needs a parser to interpret - comments, CDATA, entities, a namespace bound
+// to several prefixes, a description of something other than rdf:about="" -
+// is reported as complex, and is left to pikepdf.models.PdfMetadata.
+
+static const std::string XMP_NS_RDF = "http://www.w3.org/1999/02/22-rdf-syntax-ns#";
+static const std::string XMP_NS_PDF = "http://ns.adobe.com/pdf/1.3/";
+
+static bool is_name_char(char c)
+{
+    auto u = static_cast<unsigned char>(c);
+    return std::isalnum(u) || c == '-' || c == '_' || c == '.' || c == ':' || u >= 0x80;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static size_t skip_space(const std::string &xmp, size_t pos)
+{
+    while (pos < xmp.size() && is_space(xmp[pos]))
+        ++pos;
+    return pos;
+}
+
+static bool text_at(const std::string &xmp, size_t pos, const std::string &text)
+{
+    return pos <= xmp.size() && xmp.compare(pos, text.size(), text) == 0;
+}
+
+// True if pos is inside markup rather than character data
+static bool inside_tag(const std::string &xmp, size_t pos)
+{
+    auto open = xmp.rfind('<', pos);
+    auto close = xmp.rfind('>', pos);
+    return open != std::string::npos && (close == std::string::npos || close < open);
+}
+
+// A value that the parser would return exactly as it is stored
+static bool plain_value(const std::string &xmp, size_t begin, size_t end, bool attribute)
+{
+    bool blank = true;
+    for (size_t i = begin; i < end; ++i) {
+        char c = xmp[i];
+        if (c == '&' || c == '<' || c == '\r')
+            return false;
+        if (attribute && (c == '\t' || c == '\n'))
+            return false; // Normalized to spaces by the parser
+        if (!is_space(c))
+            blank = false;
+    }
+    return !blank;
+}
+
+// The prefix bound to ns, or "" if it is not bound. Sets ambiguous when the
+// namespace or its prefix is bound more than one way.
+static std::string bound_prefix(const std::string &xmp, const std::string &ns, bool &ambiguous)
+{
+    std::vector<std::pair<std::string, std::string>> bindings;
+    size_t pos = 0;
+    while ((pos = xmp.find("xmlns", pos)) != std::string::npos) {
+        size_t p = pos + 5;
+        bool attribute = pos > 0 && is_space(xmp[pos - 1]);
+        pos = p;
+        if (!attribute)
+            continue;
+        std::string prefix;
+        if (p < xmp.size() && xmp[p] == ':') {
+            size_t start = ++p;
+            while (p < xmp.size() && is_name_char(xmp[p]))
+                ++p;
+            prefix = xmp.substr(start, p - start);
+        }
+        p = skip_space(xmp, p);
+        if (p >= xmp.size() || xmp[p] != '=')
+            continue;
+        p = skip_space(xmp, p + 1);
+        if (p >= xmp.size() || (xmp[p] != '"' && xmp[p] != '\''))
+            continue;
+        auto close = xmp.find(xmp[p], p + 1);
+        if (close == std::string::npos) {
+            ambiguous = true;
+            return "";
+        }
+        bindings.emplace_back(prefix, xmp.substr(p + 1, close - p - 1));
+        pos = close + 1;
+    }
+
+    std::set<std::string> prefixes;
+    for (auto const &binding : bindings) {
+        if (binding.second != ns)
+            continue;
+        if (binding.first.empty()) {
+            ambiguous = true; // Default namespace
+            return "";
+        }
+        prefixes.insert(binding.first);
+    }
+    if (prefixes.size() != 1) {
+        ambiguous = prefixes.size() > 1;
+        return "";
+    }
+    auto prefix = *prefixes.begin();
+    for (auto const &binding : bindings) {
+        if (binding.first == prefix && binding.second != ns) {
+            ambiguous = true;
+            return "";
+        }
+    }
+    return prefix;
+}
+
+// Every position at which the qualified name qname appears as a whole name
+static std::vector<size_t> find_qname(const std::string &xmp, const std::string &qname)
+{
+    std::vector<size_t> found;
+    size_t pos = 0;
+    while ((pos = xmp.find(qname, pos)) != std::string::npos) {
+        auto after = pos + qname.size();
+        if ((pos == 0 || !is_name_char(xmp[pos - 1])) &&
+            (after == xmp.size() || !is_name_char(xmp[after])))
+            found.push_back(pos);
+        pos = after;
+    }
+    return found;
+}
+
+XmpValue xmp_find_simple(const std::string &xmp, const std::string &ns, const std::string &name)
+{
+    XmpValue result;
+    auto complex = [&result]() {
+        result.status = XmpValue::complex;
+        return result;
+    };
+    if (name.empty() || xmp.find(name) == std::string::npos)
+        return result;
+    if (xmp.find('\0') != std::string::npos || xmp.find("<!") != std::string::npos)
+        return complex(); // UTF-16, comments, CDATA or a DTD
+
+    bool ambiguous = false;
+    auto prefix = bound_prefix(xmp, ns, ambiguous);
+    if (ambiguous)
+        return complex();
+    if (prefix.empty())
+        return result;
+    auto rdf = bound_prefix(xmp, XMP_NS_RDF, ambiguous);
+    if (ambiguous || rdf.empty())
+        return complex();
+
+    // Like PdfMetadata, only read descriptions of the document itself
+    size_t descriptions = 0;
+    for (auto pos : find_qname(xmp, rdf + ":Description"))
+        if (pos > 0 && xmp[pos - 1] == '<')
+            ++descriptions;
+    auto abouts = find_qname(xmp, rdf + ":about");
+    if (abouts.size() != descriptions)
+        return complex();
+    for (auto pos : abouts) {
+        auto p = skip_space(xmp, pos + rdf.size() + 6);
+        if (p >= xmp.size() || xmp[p] != '=')
+            return complex();
+        p = skip_space(xmp, p + 1);
+        if (!text_at(xmp, p, "\"\"") && !text_at(xmp, p, "''"))
+            return complex();
+    }
+
+    auto qname = prefix + ":" + name;
+    auto found = find_qname(xmp, qname);
+    if (found.empty())
+        return result;
+    auto pos = found[0];
+    auto after = pos + qname.size();
+    if (pos == 0)
+        return complex();
+
+    if (xmp[pos - 1] == '<') {
+        // <prefix:name>...</prefix:name>, with nothing else of that name
+        if (found.size() != 2 || found[1] < 2 || !text_at(xmp, found[1] - 2, "</"))
+            return complex();
+        auto p = skip_space(xmp, found[1] + qname.size());
+        if (p >= xmp.size() || xmp[p] != '>')
+            return complex();
+        p = skip_space(xmp, after);
+        if (p >= xmp.size() || xmp[p] != '>')
+            return complex(); // Qualifiers, rdf:parseType or an empty element
+        auto content = p + 1;
+        auto content_end = found[1] - 2;
+        if (xmp.find('<', content) == content_end) {
+            if (!plain_value(xmp, content, content_end, false))
+                return complex();
+            result.status = XmpValue::simple;
+            result.begin = content;
+            result.end = content_end;
+            return result;
+        }
+
+        // <rdf:Alt><rdf:li ...>text</rdf:li>...</rdf:Alt>
+        p = skip_space(xmp, content);
+        if (!text_at(xmp, p, "<" + rdf + ":Alt"))
+            return complex();
+        p = skip_space(xmp, p + rdf.size() + 5);
+        if (p >= xmp.size() || xmp[p] != '>')
+            return complex();
+        p = skip_space(xmp, p + 1);
+        auto li = "<" + rdf + ":li";
+        if (!text_at(xmp, p, li) || p + li.size() >= xmp.size() ||
+            is_name_char(xmp[p + li.size()]))
+            return complex();
+        auto close = xmp.find('>', p);
+        if (close == std::string::npos || xmp[close - 1] == '/')
+            return complex();
+        auto value_end = xmp.find('<', close + 1);
+        if (value_end == std::string::npos || value_end > content_end ||
+            !text_at(xmp, value_end, "</" + rdf + ":li") ||
+            !plain_value(xmp, close + 1, value_end, false))
+            return complex();
+        result.status = XmpValue::simple;
+        result.begin = close + 1;
+        result.end = value_end;
+        result.alternative = true;
+        return result;
+    }
+
+    if (is_space(xmp[pos - 1]) && inside_tag(xmp, pos)) {
+        // <rdf:Description ... prefix:name="..." ...>
+        auto open = xmp.rfind('<', pos);
+        if (found.size() != 1 || !text_at(xmp, open + 1, rdf + ":Description"))
+            return complex();
+        auto p = skip_space(xmp, after);
+        if (p >= xmp.size() || xmp[p] != '=')
+            return complex();
+        p = skip_space(xmp, p + 1);
+        if (p >= xmp.size() || (xmp[p] != '"' && xmp[p] != '\''))
+            return complex();
+        auto close = xmp.find(xmp[p], p + 1);
+        if (close == std::string::npos || !plain_value(xmp, p + 1, close, true))
+            return complex();
+        result.status = XmpValue::simple;
+        result.begin = p + 1;
+        result.end = close;
+        return result;
+    }
+    return complex(); // The name is mentioned in some other way
+}
+
+void update_xmp_pdfversion(QPDF &q, std::string version)
+{
+    auto root = q.getRoot();
+    if (!root.hasKey("/Metadata"))
+        return; // Don't create an empty XMP object just to store the version
+
+    auto metadata = root.getKey("/Metadata");
+    if (metadata.isStream() && !version.empty() &&
+        version.find_first_of("<>&\"'") == std::string::npos) {
+        std::string xmp;
+        bool decoded = true;
+        try {
+            auto buf = metadata.getStreamData(qpdf_dl_generalized);
+            xmp.assign(reinterpret_cast<const char *>(buf->getBuffer()), buf->getSize());
+        } catch (std::exception &) {
+            decoded = false;
+        }
+        auto found = decoded ? xmp_find_simple(xmp, XMP_NS_PDF, "PDFVersion") : XmpValue();
+        if (decoded && found.status == XmpValue::absent)
+            return; // Only an existing version is kept up to date
+        if (decoded && found.status == XmpValue::simple && !found.alternative) {
+            if (xmp.compare(found.begin, found.end - found.begin, version) == 0)
+                return; // Already correct, so the stream is left alone
+
+            // Replace the stream, as PdfMetadata would, but keep the rest of
+            // the packet byte for byte
+            xmp.replace(found.begin, found.end - found.begin, version);
+            auto patched = QPDFObjectHandle::newStream(&q, xmp);
+            auto old_dict = metadata.getDict();
+            auto dict = patched.getDict();
+            for (auto const &key : old_dict.getKeys()) {
+                if (key == "/Length" || key == "/Filter" || key == "/DecodeParms" || key == "/DL")
+                    continue;
+                dict.replaceKey(key, old_dict.getKey(key));
+            }
+            root.replaceKey("/Metadata", patched);
+            return;
+        }
+    }
+
+    // Anything else needs the full metadata model
+    auto impl = py::module_::import("pikepdf._cpphelpers").attr("update_xmp_pdfversion");
+    auto pypdf = py::cast(q);
+    impl(pypdf, version);
+}
+
+void init_xmp(py::module_ &m)
+{
+    m.def("_xmp_simple_value",
+        [](py::bytes data, std::string ns, std::string name) {
+            std::string xmp = data;
+            auto found = xmp_find_simple(xmp, ns, name);
+            if (found.status == XmpValue::absent)
+                return py::make_tuple(true, py::none());
+            if (found.status == XmpValue::simple) {
+                PyObject *value = PyUnicode_DecodeUTF8(
+                    xmp.data() + found.begin, found.end - found.begin, nullptr);
+                if (value)
+                    return py::make_tuple(true, py::reinterpret_steal<py::str>(value));
+                PyErr_Clear(); // Let the parser's recovery deal with it
+            }
+            return py::make_tuple(false, py::none());
+        },
+        "Look up a simple XMP property without parsing the packet.\n\n"
+        "Returns (True, value) if the property was found, (True, None) if it\n"
+        "is absent, or (False, None) if the packet must be parsed to tell.",
+        py::arg("data"),
+        py::arg("namespace"),
+        py::arg("name")
+    );
+}
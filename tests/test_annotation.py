@@ -38,3 +38,60 @@ def test_checkbox(form):
         annot.get_page_content_for_appearance(Name.XYZ, 0)
         == b'q\n1 0 0 1 4.41818 3.10912 cm\n/XYZ Do\nQ\n'
     )
+
+
+def test_scan_annotations(form):
+    scan = form.scan_annotations()
+    assert list(scan) == [
+        'page',
+        'objgen',
+        'subtype',
+        'flags',
+        'rect',
+        'appearance_state',
+        'field_name',
+    ]
+    n = len(scan['page'])
+    assert n > 0 and len(scan['rect']) == 4 * n
+    assert all(len(scan[field]) == n for field in scan if field != 'rect')
+
+    checkbox = form.Root.AcroForm.Fields[2]
+    i = scan['objgen'].index(checkbox.objgen)
+    page_annots = form.pages[scan['page'][i]].Annots
+    assert checkbox.objgen in [annot.objgen for annot in page_annots]
+    assert scan['subtype'][i] == '/Widget'
+    assert scan['flags'][i] == 4
+    assert scan['appearance_state'][i] == '/Off'
+    assert scan['field_name'][i] == str(checkbox.T)
+    assert list(scan['rect'][4 * i : 4 * i + 4]) == [float(v) for v in checkbox.Rect]
+
+    assert list(form.scan_annotations(['flags', 'rect'])) == ['flags', 'rect']
+    assert form.scan_annotations('flags')['flags'] == scan['flags']
+    with pytest.raises(ValueError, match='unknown'):
+        form.scan_annotations(['colour'])
+
+
+def test_generate_appearance_streams_subset(form):
+    text, button = form.Root.AcroForm.Fields[0], form.Root.AcroForm.Fields[1]
+    assert Name.AP not in text
+    form.Root.AcroForm.NeedAppearances = True
+    form.generate_appearance_streams(annotations=[Annotation(text)])
+    assert Name.AP in text
+    assert form.Root.AcroForm.NeedAppearances
+    with pytest.raises(ValueError, match='owned by this Pdf'):
+        form.generate_appearance_streams(annotations=[Dictionary()])
+    assert Name.AP in button
+
+
+def test_flatten_annotations_subset(form):
+    form.Root.AcroForm.NeedAppearances = False
+    fields = form.Root.AcroForm.Fields
+    n_fields = len(fields)
+    button = fields[1]
+    before = form.scan_annotations(['objgen'])['objgen']
+
+    form.flatten_annotations(annotations=[button.objgen])
+    after = form.scan_annotations(['objgen'])['objgen']
+    assert button.objgen not in after
+    assert len(after) == len(before) - 1
+    assert len(form.Root.AcroForm.Fields) == n_fields - 1
@@ -0,0 +1,94 @@
+import pytest
+
+import pikepdf
+from pikepdf import Name, PasswordError, Pdf, PdfError, batch_process
+
+
+@pytest.fixture
+def jobs(resources, outdir):
+    names = ['graph.pdf', 'fourpages.pdf', 'sandwich.pdf']
+    return [(resources / name, outdir / name) for name in names]
+
+
+def test_batch_edits(jobs):
+    results = batch_process(
+        jobs,
+        [('set_docinfo', '/Title', 'Batch'), ('delete_xmp',), ('rotate', 90)],
+        workers=2,
+    )
+    assert [r.ok for r in results] == [True, True, True]
+    for (input_path, output_path), result in zip(jobs, results):
+        assert result.input == input_path and result.output == output_path
+        with Pdf.open(input_path) as src, Pdf.open(output_path) as pdf:
+            assert str(pdf.docinfo.Title) == 'Batch'
+            assert Name.Metadata not in pdf.Root
+            assert len(pdf.pages) == len(src.pages)
+            for page, src_page in zip(pdf.pages, src.pages):
+                assert page.Rotate == (src_page.get(Name.Rotate, 0) + 90) % 360
+
+
+def test_batch_delete_docinfo(resources, outdir):
+    with Pdf.open(resources / 'graph.pdf') as pdf:
+        pdf.docinfo.Title = 'Remove me'
+        pdf.save(outdir / 'titled.pdf')
+    (result,) = batch_process(
+        [(outdir / 'titled.pdf', outdir / 'out.pdf')], [('delete_docinfo', 'Title')]
+    )
+    assert result.ok
+    with Pdf.open(outdir / 'out.pdf') as pdf:
+        assert Name.Title not in pdf.docinfo
+
+
+def test_batch_save_options(jobs):
+    results = batch_process(
+        jobs[:1],
+        object_stream_mode=pikepdf.ObjectStreamMode.generate,
+        min_version='1.6',
+        static_id=True,
+    )
+    assert results[0].ok
+    with Pdf.open(jobs[0][1]) as pdf:
+        assert pdf.pdf_version >= '1.6'
+
+
+def test_batch_errors_are_per_file(resources, outdir, jobs):
+    bad = [
+        (resources / 'does-not-exist.pdf', outdir / 'a.pdf'),
+        (resources / 'graph-encrypted.pdf', outdir / 'b.pdf'),
+        (resources / 'graph.pdf', resources / 'graph.pdf'),
+        (__file__, outdir / 'c.pdf'),
+    ]
+    results = batch_process(bad + jobs, workers=3)
+    assert isinstance(results[0].error, OSError)
+    assert isinstance(results[1].error, PasswordError)
+    assert isinstance(results[2].error, ValueError)
+    assert isinstance(results[3].error, PdfError)
+    assert all(r.ok for r in results[4:])
+
+
+def test_batch_password(resources, outdir):
+    (result,) = batch_process(
+        [(resources / 'graph-encrypted.pdf', outdir / 'out.pdf')], password='owner'
+    )
+    assert result.ok
+    with Pdf.open(outdir / 'out.pdf') as pdf:
+        assert not pdf.is_encrypted
+
+
+@pytest.mark.parametrize(
+    'ops',
+    [
+        [('rotate', 45)],
+        [('set_docinfo', '/Title')],
+        [('frobnicate',)],
+        [()],
+    ],
+)
+def test_batch_invalid_ops(jobs, ops):
+    with pytest.raises(ValueError):
+        batch_process(jobs, ops)
+
+
+def test_batch_unsupported_save_option(jobs):
+    with pytest.raises(TypeError, match='progress'):
+        batch_process(jobs, progress=print)
@@ -18,6 +18,22 @@ def test_decode():
     assert b'\xa0'.decode('pdfdoc') == '€'
 
 
+def test_many():
+    assert pikepdf.codec.pdf_doc_to_utf8_many([b'A', b'\xa0', b'']) == ['A', '€', '']
+    assert pikepdf.codec.utf8_to_pdf_doc_many(['abc', '€', '你'], b'?') == [
+        (True, b'abc'),
+        (True, b'\xa0'),
+        (False, b'?'),
+    ]
+    with pytest.raises(TypeError):
+        pikepdf.codec.pdf_doc_to_utf8_many(['not bytes'])
+
+
+@given(binary())
+def test_many_matches_single(b):
+    assert pikepdf.codec.pdf_doc_to_utf8_many([b]) == [b.decode('pdfdoc')]
+
+
 def test_unicode_surrogate():
     with pytest.raises(ValueError, match=r'surrogate'):
         '\ud800'.encode('pdfdoc')
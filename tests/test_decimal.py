@@ -64,3 +64,49 @@ def test_nonfinite(pal):
         pal.pages[0].MediaBox[2] = float('NaN')
     with pytest.raises(ValueError):
         pal.pages[0].MediaBox[2] = float('Infinity')
+
+
+@pytest.fixture
+def real_as_float():
+    saved = pikepdf.settings.get_real_as_float()
+    pikepdf.settings.set_real_as_float(True)
+    yield
+    pikepdf.settings.set_real_as_float(saved)
+
+
+def test_real_as_float(real_as_float):
+    a = pikepdf.Array([Decimal('1.5'), 2, Decimal('-0.25')])
+    assert isinstance(a[0], float)
+    assert list(a) == [1.5, 2, -0.25]
+    assert isinstance(a[1], int)
+    a[0] = a[0] * 2
+    assert a[0] == 3.0
+
+
+def test_real_as_decimal_default():
+    a = pikepdf.Array([Decimal('1.5')])
+    assert isinstance(a[0], Decimal)
+
+
+@pytest.mark.parametrize(
+    'a, b, equal',
+    [
+        ('1.50', '1.5', True),
+        ('-0.0', '0', True),
+        ('.5', '0.50', True),
+        ('007', '7.000', True),
+        ('1.0000000000000000001', '1', False),
+        ('-1.5', '1.5', False),
+    ],
+)
+def test_real_equality_is_exact(a, b, equal):
+    # Parse arrays, so that the numbers keep their exact representation
+    arr_a = pikepdf.Object.parse(f'[{a}]'.encode())
+    arr_b = pikepdf.Object.parse(f'[{b}]'.encode())
+    assert (arr_a == arr_b) == equal
+    assert (arr_b == arr_a) == equal
+
+
+def test_numeric_equality_mixed_types():
+    assert pikepdf.Array([1, True]) == pikepdf.Array([Decimal('1.0'), 1])
+    assert pikepdf.Array([1]) != pikepdf.Array([pikepdf.Name.One])
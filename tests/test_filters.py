@@ -1,6 +1,15 @@
 import pytest
 
-from pikepdf import Page, Pdf, PdfError, Token, TokenFilter, TokenType
+from pikepdf import (
+    Name,
+    NativeTokenFilter,
+    Page,
+    Pdf,
+    PdfError,
+    Token,
+    TokenFilter,
+    TokenType,
+)
 
 
 @pytest.fixture
@@ -120,3 +129,77 @@ def test_issue160_tokenfilter_refcounting(resources, outpdf):
             page.add_content_token_filter(f)
             num += 1
         pdf.save(outpdf)
+
+
+def _page_with_contents(pdf, data):
+    page = Page(pdf.pages[0])
+    page.obj.Contents = pdf.make_stream(data)
+    return page
+
+
+@pytest.mark.parametrize(
+    'filter, expected',
+    [
+        (NativeTokenFilter.strip_operators(['cm']), b'q\n/Im0 Do\nQ'),
+        (NativeTokenFilter.strip_operators(['q', 'Q', 'Do', 'cm']), b''),
+        (
+            NativeTokenFilter.remap_resource_names({Name.Im0: '/Im1'}),
+            b'q\n144.0000 0 0 144.0000 0.0000 0.0000 cm\n/Im1 Do\nQ',
+        ),
+    ],
+)
+def test_native_filter(pal, filter, expected):
+    page = Page(pal.pages[0])
+    assert page.get_filtered_contents(filter) == expected
+    page.add_content_token_filter(filter)
+    assert page.obj.Contents.read_bytes() == expected
+
+
+def test_native_drop_text(pal):
+    page = _page_with_contents(
+        pal, b'BT /F1 12 Tf (Hello) Tj [(A) 10 (B)] TJ 0 -14 Td (x) \' ET'
+    )
+    result = page.get_filtered_contents(NativeTokenFilter.drop_text())
+    assert result == b'BT /F1 12 Tf 0 -14 Td ET'
+
+
+def test_native_replace_color(pal):
+    page = _page_with_contents(pal, b'1 0 0 rg 0 0 1 RG 0.5 g 1 0 0 RG')
+    to_green = NativeTokenFilter.replace_color((1, 0, 0), (0, 1, 0))
+    assert (
+        page.get_filtered_contents(to_green) == b'0 1 0 rg 0 0 1 RG 0.5 g 0 1 0 RG'
+    )
+    to_cmyk = NativeTokenFilter.replace_color([0.5], [0, 0, 0, 0.5])
+    assert (
+        page.get_filtered_contents(to_cmyk)
+        == b'1 0 0 rg 0 0 1 RG 0 0 0 0.5 k 1 0 0 RG'
+    )
+
+
+def test_native_replace_color_small_components(pal):
+    page = _page_with_contents(pal, b'.5 g 0.2 0.00001 1 rg')
+    to_small = NativeTokenFilter.replace_color([0.5], [0.00001, -0.0000001, 123.25])
+    result = page.get_filtered_contents(to_small)
+    assert result == b'0.00001 0 123.25 rg 0.2 0.00001 1 rg'
+    from_small = NativeTokenFilter.replace_color((0.2, 0.00001, 1), (1, 0, 0))
+    assert page.get_filtered_contents(from_small) == b'.5 g 1 0 0 rg'
+
+
+def test_native_chain(pal):
+    page = _page_with_contents(pal, b'q 1 0 0 rg /Im0 Do 0 0 10 10 re f Q')
+    chained = NativeTokenFilter.chain(
+        [
+            NativeTokenFilter.replace_color((1, 0, 0), (0,)),
+            NativeTokenFilter.strip_operators(['re', 'f']),
+        ]
+    ) | NativeTokenFilter.remap_resource_names({'/Im0': '/Im9'})
+    assert 'strip_operators' in repr(chained)
+    page.add_content_token_filter(chained)
+    assert page.obj.Contents.read_bytes() == b'q 0 g /Im9 Do Q'
+
+
+def test_native_invalid():
+    with pytest.raises(ValueError):
+        NativeTokenFilter.replace_color((1, 0), (0, 0, 0))
+    with pytest.raises(TypeError):
+        NativeTokenFilter.remap_resource_names({42: '/Im0'})
@@ -322,6 +322,54 @@ def test_jp2(resources):
     assert pim.bits_per_component == 8
 
 
+@pytest.mark.parametrize(
+    'filename',
+    [
+        'sandwich.pdf',
+        'congress.pdf',
+        'cmyk-jpeg.pdf',
+        'pal.pdf',
+        'pal-1bit-trivial.pdf',
+        'pal-1bit-rgb.pdf',
+        'pink-palette-icc.pdf',
+        'pike-jp2.pdf',
+    ],
+)
+def test_extract_many(resources, filename):
+    pdf = Pdf.open(resources / filename)
+    xobjs = list(pdf.pages[0].images.values())
+    many = PdfImage.extract_many(xobjs, jobs=2)
+    assert len(many) == len(xobjs)
+
+    for xobj, (ext, data) in zip(xobjs, many):
+        single = BytesIO()
+        assert PdfImage(xobj).extract_to(stream=single) == ext
+        if ext == '.png':
+            expected = Image.open(single)
+            im = Image.open(BytesIO(data))
+            assert im.size == expected.size
+            assert im.convert('RGB').tobytes() == expected.convert('RGB').tobytes()
+            assert im.info.get('icc_profile') == expected.info.get('icc_profile')
+        else:
+            assert data == single.getvalue()
+
+
+def test_extract_many_invalid(congress):
+    with pytest.raises(ValueError):
+        PdfImage.extract_many([congress[0]], jobs=0)
+    assert PdfImage.extract_many([]) == []
+
+
+def test_read_into(resources):
+    xobj, _pdf = first_image_in(resources / 'pal.pdf')
+    pim = PdfImage(xobj)
+    buffer = bytearray(pim.stride * pim.height)
+    assert pim.read_into(buffer) == len(buffer)
+    assert bytes(buffer) == pim.read_bytes()
+    with pytest.raises(ValueError, match='too small'):
+        pim.read_into(bytearray(len(buffer) - 1))
+
+
 def test_extract_filepath(congress, outdir):
     xobj, _pdf = congress
     pim = PdfImage(xobj)
@@ -428,6 +476,13 @@ def test_imagemagick_uses_rle_compression(resources):
     assert im.getpixel((5, 5)) == (255, 128, 0)
 
 
+needs_no_native_jbig2 = pytest.mark.skipif(
+    '/JBIG2Decode' in pikepdf.stream_decoders(),
+    reason="JBIG2 is decoded in-process",
+)
+
+
+@needs_no_native_jbig2
 def test_jbig2_not_available(jbig2, monkeypatch):
     xobj, _pdf = jbig2
     pim = PdfImage(xobj)
@@ -444,8 +499,29 @@ def test_jbig2_not_available(jbig2, monkeypatch):
 
 
 needs_jbig2dec = pytest.mark.skipif(
-    not pikepdf.jbig2.jbig2dec_available(), reason="jbig2dec not installed"
+    not pikepdf.jbig2.jbig2dec_available()
+    and '/JBIG2Decode' not in pikepdf.stream_decoders(),
+    reason="jbig2dec not installed",
+)
+
+
+@pytest.mark.skipif(
+    '/JBIG2Decode' not in pikepdf.stream_decoders(),
+    reason="pikepdf built without PIKEPDF_JBIG2DEC",
 )
+def test_jbig2_native(resources):
+    xobj, _pdf = first_image_in(resources / 'jbig2global.pdf')
+    data = xobj.read_bytes(pikepdf.StreamDecodeLevel.specialized)
+    assert len(data) == (4000 + 7) // 8 * 2864
+
+    # A decoder from Python takes over, until it is removed
+    pikepdf.register_stream_decoder('/JBIG2Decode', lambda data, parms: b'python')
+    try:
+        assert xobj.read_bytes(pikepdf.StreamDecodeLevel.specialized) == b'python'
+    finally:
+        pikepdf.register_stream_decoder('/JBIG2Decode', None)
+    assert '/JBIG2Decode' in pikepdf.stream_decoders()
+    assert xobj.read_bytes(pikepdf.StreamDecodeLevel.specialized) == data
 
 
 @needs_jbig2dec
@@ -478,6 +554,7 @@ def test_jbig2_global_palette(resources):
     assert im.getpixel((0, 0)) == 255  # Ensure loaded
 
 
+@needs_no_native_jbig2
 def test_jbig2_error(resources, monkeypatch):
     xobj, _pdf = first_image_in(resources / 'jbig2global.pdf')
     pim = PdfImage(xobj)
@@ -493,6 +570,7 @@ def test_jbig2_error(resources, monkeypatch):
         pim.as_pil_image()
 
 
+@needs_no_native_jbig2
 def test_jbig2_too_old(resources, monkeypatch):
     xobj, _pdf = first_image_in(resources / 'jbig2global.pdf')
     pim = PdfImage(xobj)
@@ -1,6 +1,7 @@
+import hashlib
 import os.path
 import sys
-from io import BytesIO, FileIO
+from io import BufferedRandom, BytesIO, FileIO
 from shutil import copy
 
 import psutil
@@ -250,3 +251,165 @@ def test_stop_iteration_on_close(resources):
     stream = StopIterationOnClose((resources / 'pal-1bit-trivial.pdf').read_bytes())
     pdf = Pdf.open(stream)
     pdf.close()
+
+
+def test_save_to_open_file_keeps_position(sandwich, outpdf):
+    bio = BytesIO()
+    sandwich.save(bio, static_id=True)
+
+    with outpdf.open('wb') as f:
+        f.write(b'prefix')
+        sandwich.save(f, static_id=True)
+        f.write(b'suffix')
+    assert outpdf.read_bytes() == b'prefix' + bio.getvalue() + b'suffix'
+
+
+def test_save_to_file_subclass_uses_write(sandwich, outpdf):
+    class CountingFileIO(FileIO):
+        written = 0
+
+        def write(self, b):
+            n = super().write(b)
+            self.written += n
+            return n
+
+    with CountingFileIO(outpdf, 'wb') as f:
+        sandwich.save(f)
+        assert f.written == outpdf.stat().st_size > 0
+
+
+@pytest.mark.parametrize(
+    'access_mode',
+    [
+        pikepdf._qpdf.AccessMode.default,
+        pikepdf._qpdf.AccessMode.stream,
+        pikepdf._qpdf.AccessMode.mmap,
+        pikepdf._qpdf.AccessMode.fd,
+    ],
+)
+def test_access_modes_equivalent(resources, access_mode):
+    with Pdf.open(resources / 'graph.pdf') as reference, Pdf.open(
+        resources / 'graph.pdf', access_mode=access_mode
+    ) as pdf:
+        assert len(pdf.pages) == len(reference.pages)
+        for page, ref_page in zip(pdf.pages, reference.pages):
+            assert page.Contents.read_bytes() == ref_page.Contents.read_bytes()
+
+
+def test_fd_access_to_stream(resources):
+    with (resources / 'fourpages.pdf').open('rb') as f:
+        with Pdf.open(f, access_mode=pikepdf._qpdf.AccessMode.fd) as pdf:
+            assert len(pdf.pages) == 4
+        assert not f.closed
+
+
+def test_fd_access_falls_back_to_stream(resources):
+    bio = BytesIO((resources / 'fourpages.pdf').read_bytes())
+    with Pdf.open(bio, access_mode=pikepdf._qpdf.AccessMode.fd) as pdf:
+        assert len(pdf.pages) == 4
+
+
+def test_fd_access_does_not_call_read(resources):
+    class UnreadableFile(FileIO):
+        def read(self, *args, **kwargs):
+            raise ExpectedError()
+
+        readinto = read
+
+    f = UnreadableFile(resources / 'pal.pdf', 'rb')
+    with Pdf.open(f, access_mode=pikepdf._qpdf.AccessMode.fd) as pdf:
+        assert len(pdf.pages) == 1
+
+
+class WriteOnlySink:
+    """A sink with write() but no seek(), like a socket or HTTP response"""
+
+    def __init__(self):
+        self.chunks = []
+
+    def write(self, b):
+        self.chunks.append(bytes(b))
+        return len(b)
+
+
+def test_save_write_only_stream(sandwich):
+    bio = BytesIO()
+    sandwich.save(bio, static_id=True)
+    sink = WriteOnlySink()
+    sandwich.save(sink, static_id=True)
+    assert b''.join(sink.chunks) == bio.getvalue()
+
+
+@pytest.mark.parametrize('chunk_size', [1, 1000, 1 << 20])
+def test_save_chunked(sandwich, chunk_size):
+    bio = BytesIO()
+    sandwich.save(bio, static_id=True)
+    expected = bio.getvalue()
+
+    chunks = []
+    result = sandwich.save_chunked(
+        chunks.append, chunk_size=chunk_size, checksum='sha256', static_id=True
+    )
+    assert b''.join(chunks) == expected
+    assert all(len(chunk) == chunk_size for chunk in chunks[:-1])
+    assert 0 < len(chunks[-1]) <= chunk_size
+    assert result.bytes_written == len(expected)
+    assert result.checksum == hashlib.sha256(expected).hexdigest()
+
+
+def test_save_chunked_options(sandwich):
+    sink = WriteOnlySink()
+    result = sandwich.save_chunked(sink, checksum=None, linearize=True)
+    assert result.checksum is None
+    data = b''.join(sink.chunks)
+    assert result.bytes_written == len(data)
+    with Pdf.open(BytesIO(data)) as pdf:
+        assert pdf.is_linearized
+
+    with pytest.raises(TypeError, match='unexpected save options'):
+        sandwich.save_chunked(sink, filename_or_stream='x.pdf')
+    with pytest.raises(TypeError):
+        sandwich.save_chunked(42)
+    with pytest.raises(ValueError):
+        sandwich.save_chunked(sink, chunk_size=0)
+
+
+def test_save_chunked_deduplicate():
+    pdf = Pdf.new()
+    data = b'duplicated' * 100
+    pdf.Root.A = pdf.make_stream(data)
+    pdf.Root.B = pdf.make_stream(data)
+    chunks = []
+    result = pdf.save_chunked(chunks.append, deduplicate=True)
+    assert result.bytes_written == len(b''.join(chunks))
+    assert pdf.Root.A.objgen == pdf.Root.B.objgen
+    with Pdf.open(BytesIO(b''.join(chunks))) as reopened:
+        assert reopened.Root.A.objgen == reopened.Root.B.objgen
+        assert reopened.Root.A.read_bytes() == data
+
+
+def test_save_chunked_callback_error(sandwich):
+    def fail(chunk):
+        raise ConnectionError("upload failed")
+
+    with pytest.raises(ConnectionError, match='upload failed'):
+        sandwich.save_chunked(fail, chunk_size=100)
+
+
+def test_save_to_buffered_random_reads_back(resources, outdir):
+    path = outdir / 'readwrite.pdf'
+    path.write_bytes(b'x' * 1_000_000)
+    with Pdf.open(resources / 'graph.pdf') as pdf, open(path, 'r+b') as f:
+        assert isinstance(f, BufferedRandom)
+        f.read(10)  # Fill the read buffer with the old contents
+        f.seek(0)
+        pdf.save(f)
+        end = f.tell()
+        assert end < 1_000_000
+        assert f.read(5) == b'xxxxx'
+        f.seek(0)
+        data = f.read(end)
+        assert data.startswith(b'%PDF-') and data.rstrip().endswith(b'%%EOF')
+        f.truncate(end)
+    with Pdf.open(path) as reopened:
+        assert len(reopened.pages) == 1
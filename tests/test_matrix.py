@@ -1,3 +1,5 @@
+from decimal import Decimal
+
 import pytest
 
 import pikepdf
@@ -24,3 +26,8 @@ def test_matrix_from_matrix():
     m_copy = PdfMatrix(m)
     assert m == m_copy
     assert m != 'not matrix'
+
+
+def test_matrix_from_array():
+    m = PdfMatrix(pikepdf.Array([1, 0, 0, 1, Decimal('2.5'), 3]))
+    assert m.shorthand == (1, 0, 0, 1, 2.5, 3)
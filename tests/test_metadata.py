@@ -1,6 +1,8 @@
 import os
 import re
+import zlib
 from datetime import datetime, timedelta, timezone, tzinfo
+from io import BytesIO
 from pathlib import Path
 from xml.etree import ElementTree as ET
 
@@ -757,3 +759,99 @@ def test_xxe(trivial, outdir):
     )
     with trivial.open_metadata() as m:
         assert 'This is a secret' not in str(m)
+
+
+XMP_SIMPLE = b"""\
+<?xpacket begin="\xef\xbb\xbf" id="W5M0MpCehiHzreSzNTczkc9d"?>
+<x:xmpmeta xmlns:x="adobe:ns:meta/" x:xmptk="pytest">
+ <rdf:RDF xmlns:rdf="http://www.w3.org/1999/02/22-rdf-syntax-ns#">
+  <rdf:Description rdf:about=""
+    xmlns:pdf="http://ns.adobe.com/pdf/1.3/"
+    pdf:Producer="Example Producer">
+   <pdf:PDFVersion>1.4</pdf:PDFVersion>
+  </rdf:Description>
+  <rdf:Description rdf:about=""
+    xmlns:dc="http://purl.org/dc/elements/1.1/"
+    xmlns:xmp="http://ns.adobe.com/xap/1.0/">
+   <dc:title><rdf:Alt><rdf:li xml:lang="x-default">Example Title</rdf:li></rdf:Alt></dc:title>
+   <dc:creator><rdf:Seq><rdf:li>Someone</rdf:li></rdf:Seq></dc:creator>
+   <xmp:CreatorTool>Example Tool</xmp:CreatorTool>
+  </rdf:Description>
+ </rdf:RDF>
+</x:xmpmeta>
+<?xpacket end="w"?>"""
+
+
+def test_simple_lookup_without_parsing(trivial):
+    trivial.Root.Metadata = Stream(trivial, XMP_SIMPLE)
+    meta = trivial.open_metadata()
+    assert meta['pdf:Producer'] == 'Example Producer'
+    assert meta['pdf:PDFVersion'] == '1.4'
+    assert meta['dc:title'] == 'Example Title'
+    assert meta['xmp:CreatorTool'] == 'Example Tool'
+    assert 'xmp:CreateDate' not in meta
+    with pytest.raises(KeyError):
+        meta['xmp:CreateDate']
+    assert meta._xmp is None
+
+    # A list needs the full model
+    assert meta['dc:creator'] == ['Someone']
+    assert meta._xmp is not None
+
+
+@pytest.mark.parametrize(
+    'xmp',
+    [
+        XMP_SIMPLE.replace(b'Example Tool', b'Example &amp; Tool'),
+        XMP_SIMPLE.replace(b'<rdf:RDF', b'<!-- comment --><rdf:RDF'),
+        XMP_SIMPLE.replace(b'rdf:about=""', b'rdf:about="uuid:1234"', 1),
+        XMP_SIMPLE.replace(
+            b'xmlns:xmp=', b'xmlns:xap="http://ns.adobe.com/xap/1.0/" xmlns:xmp='
+        ),
+    ],
+)
+def test_simple_lookup_falls_back(xmp):
+    assert pikepdf._qpdf._xmp_simple_value(xmp, XMP_NS_XMP, 'CreatorTool') == (
+        False,
+        None,
+    )
+
+
+def test_simple_lookup_absent():
+    assert pikepdf._qpdf._xmp_simple_value(
+        XMP_SIMPLE, 'http://example.com/unbound/', 'PDFVersion'
+    ) == (True, None)
+
+
+@pytest.mark.parametrize('attribute', [False, True])
+def test_pdf_version_patched(trivial, attribute):
+    xmp = XMP_SIMPLE
+    if attribute:
+        xmp = xmp.replace(b'<pdf:PDFVersion>1.4</pdf:PDFVersion>', b'').replace(
+            b'pdf:Producer=', b'pdf:PDFVersion="1.4" pdf:Producer='
+        )
+    trivial.Root.Metadata = Stream(trivial, xmp)
+    trivial.Root.Metadata.Type = Name.Metadata
+    trivial.save(BytesIO(), force_version='1.7')
+    patched = trivial.Root.Metadata.read_bytes()
+    # Only the version changes; the rest of the packet is kept as it was
+    assert patched == xmp.replace(b'1.4', b'1.7')
+    assert trivial.Root.Metadata.Type == Name.Metadata
+
+
+def test_pdf_version_unchanged(trivial):
+    metadata = Stream(trivial, b'')
+    metadata.write(zlib.compress(XMP_SIMPLE), filter=Name.FlateDecode)
+    trivial.Root.Metadata = metadata
+    trivial.save(BytesIO(), force_version='1.4')
+    # Already correct, so not rewritten uncompressed
+    assert trivial.Root.Metadata.Filter == Name.FlateDecode
+    assert trivial.Root.Metadata.read_bytes() == XMP_SIMPLE
+
+
+def test_pdf_version_complex_falls_back(trivial):
+    xmp = XMP_SIMPLE.replace(b'<rdf:RDF', b'<!-- comment --><rdf:RDF')
+    trivial.Root.Metadata = Stream(trivial, xmp)
+    trivial.save(BytesIO(), force_version='1.7')
+    with trivial.open_metadata() as meta:
+        assert meta['pdf:PDFVersion'] == '1.7'
@@ -30,6 +30,7 @@ from pikepdf import (
     Pdf,
     PdfError,
     Stream,
+    StreamDecodeLevel,
     String,
 )
 from pikepdf import _qpdf as qpdf
@@ -352,6 +353,34 @@ class TestRepr:
             pdf.Root.Circular.Parent = pdf.make_indirect(pdf.Root.Circular)
             assert '.get_object' in repr(pdf.Root.Circular)
 
+    def test_repr_limits(self):
+        limits = pikepdf.settings.get_repr_limits()
+        nested = Array([Dictionary(A=Array([1]))])
+        long = Array(range(10))
+        try:
+            pikepdf.settings.set_repr_limits(2, 3, 0)
+            assert repr(nested) == '<pikepdf.Array([ {\n  "/A": [ <...> ]\n} ])>'
+            assert repr(long) == '<pikepdf.Array([ 0, 1, 2, <... 7 more> ])>'
+            pikepdf.settings.set_repr_limits(0, 0, 20)
+            r = repr(Array([String('é' * 30)]))
+            assert r.startswith('<pikepdf.Array([ "é') and r.endswith('<...>)>')
+            assert len(r.encode()) < 40
+            pikepdf.settings.set_repr_limits(0, 0, 0)
+            assert eval(repr(long)) == long
+        finally:
+            pikepdf.settings.set_repr_limits(*limits)
+
+    def test_repr_deep(self):
+        a = Array([42])
+        for _ in range(200):
+            a = Array([a])
+        rlimit = sys.getrecursionlimit()
+        try:
+            sys.setrecursionlimit(100)
+            assert repr(a).endswith('[ <...> ] ] ] ] ])>')
+        finally:
+            sys.setrecursionlimit(rlimit)
+
 
 def test_operator_inline(resources):
     with pikepdf.open(resources / 'image-mono-inline.pdf') as pdf:
@@ -557,6 +586,35 @@ class TestStreamReadWrite:
                 compress(b'foo'), filter=Name.FlateDecode, decode_parms=[42]
             )
 
+    def test_memoryview(self, stream_object):
+        stream_object.write(compress(b'memory'), filter=Name.FlateDecode)
+        view = stream_object.read_memoryview()
+        assert view.readonly
+        assert bytes(view) == b'memory'
+        assert bytes(stream_object.read_raw_memoryview()) == compress(b'memory')
+
+    def test_write_buffers(self, stream_object):
+        data = bytearray(b'mutable')
+        stream_object.write(data)
+        data[:] = b'changed'
+        assert stream_object.read_bytes() == b'mutable'
+        stream_object.write(memoryview(b'readonly'))
+        assert stream_object.read_bytes() == b'readonly'
+        assert stream_object.Length == len(b'readonly')
+        with pytest.raises(TypeError):
+            stream_object.write('not a buffer')
+        with pytest.raises(BufferError):
+            stream_object.write(memoryview(b'abcdef')[::2])
+
+    def test_write_buffer_save(self, outdir):
+        pdf = pikepdf.new()
+        data = bytes(range(256)) * 1000
+        pdf.Root.Big = pdf.make_indirect(Stream(pdf, data))
+        del data
+        pdf.save(outdir / 'big.pdf')
+        with Pdf.open(outdir / 'big.pdf') as saved:
+            assert saved.Root.Big.read_bytes() == bytes(range(256)) * 1000
+
     def test_filter_decodeparms_mismatch(self, stream_object):
         with pytest.raises(ValueError, match=r"filter.*and decode_parms"):
             stream_object.write(
@@ -566,6 +624,66 @@ class TestStreamReadWrite:
             )
 
 
+@pytest.fixture
+def reverse_decoder():
+    calls = []
+
+    def reverse(data, decode_parms):
+        calls.append(decode_parms)
+        return data[::-1]
+
+    pikepdf.register_stream_decoder('/XReverse', reverse)
+    yield calls
+    pikepdf.register_stream_decoder('/XReverse', None)
+
+
+class TestStreamDecoders:
+    def test_registered(self, stream_object, reverse_decoder):
+        assert '/XReverse' in pikepdf.stream_decoders()
+        stream_object.write(b'olleh', filter=Name('/XReverse'))
+        assert stream_object.read_bytes(StreamDecodeLevel.specialized) == b'hello'
+        assert bytes(stream_object.read_memoryview(StreamDecodeLevel.all)) == b'hello'
+        assert reverse_decoder == [None, None]
+        with pytest.raises(PdfError):
+            stream_object.read_bytes()  # generalized does not use decoders
+
+    def test_after_qpdf_filters(self, stream_object, reverse_decoder):
+        stream_object.write(
+            compress(b'dlrow'),
+            filter=[Name.FlateDecode, Name('/XReverse')],
+            decode_parms=[None, Dictionary(Mode=1)],
+        )
+        assert stream_object.read_bytes(StreamDecodeLevel.specialized) == b'world'
+        assert reverse_decoder == [Dictionary(Mode=1)]
+
+    def test_unregistered(self, stream_object, reverse_decoder):
+        pikepdf.register_stream_decoder('/XReverse', None)
+        assert '/XReverse' not in pikepdf.stream_decoders()
+        stream_object.write(b'olleh', filter=Name('/XReverse'))
+        with pytest.raises(PdfError):
+            stream_object.read_bytes(StreamDecodeLevel.specialized)
+
+    def test_decoder_error(self, stream_object):
+        def fail(data, decode_parms):
+            raise ValueError('bad data')
+
+        pikepdf.register_stream_decoder('/XFail', fail)
+        try:
+            stream_object.write(b'x', filter=Name('/XFail'))
+            with pytest.raises(ValueError, match='bad data'):
+                stream_object.read_bytes(StreamDecodeLevel.specialized)
+        finally:
+            pikepdf.register_stream_decoder('/XFail', None)
+
+    def test_invalid(self):
+        with pytest.raises(ValueError, match='already decodes'):
+            pikepdf.register_stream_decoder('/FlateDecode', lambda d, p: d)
+        with pytest.raises(ValueError):
+            pikepdf.register_stream_decoder('XReverse', lambda d, p: d)
+        with pytest.raises(TypeError):
+            pikepdf.register_stream_decoder('/XReverse', 42)
+
+
 def test_copy():
     d = Dictionary(
         {
@@ -593,6 +711,140 @@ def test_object_iteration(sandwich):
     assert expected == loops
 
 
+def _objgens(objects):
+    return [obj.objgen for obj in objects if isinstance(obj, Object)]
+
+
+def test_iter_objects(sandwich):
+    assert _objgens(sandwich.iter_objects()) == _objgens(sandwich.objects)
+    assert None not in list(sandwich.iter_objects())
+
+    # Leaves a null object where it was, and missing objects before its new place
+    moved = sandwich.make_indirect(Dictionary(Moved=True))
+    old_objgen, new_objgen = moved.objgen, (moved.objgen[0] + 5, 0)
+    sandwich._swap_objects(old_objgen, new_objgen)
+    yielded = list(sandwich.iter_objects())
+    assert None not in yielded
+    assert old_objgen not in _objgens(yielded)
+    assert new_objgen in _objgens(yielded)
+
+    new_stream = Stream(sandwich, b'new')
+    streams = list(sandwich.iter_objects(stream=True))
+    assert streams and all(isinstance(obj, Stream) for obj in streams)
+    assert streams[-1].objgen == new_stream.objgen
+    assert _objgens(sandwich.iter_objects(type_code=qpdf.ObjectType.stream)) == [
+        obj.objgen for obj in streams
+    ]
+    assert not any(
+        isinstance(obj, Stream) for obj in sandwich.iter_objects(stream=False)
+    )
+
+    images = list(sandwich.iter_objects(subtype=Name.Image))
+    assert images and all(obj.Subtype == Name.Image for obj in images)
+    assert _objgens(sandwich.iter_objects(type='/XObject', subtype='/Image')) == [
+        obj.objgen for obj in images
+    ]
+    assert list(sandwich.iter_objects(type=Name.Page)) == list(sandwich.pages)
+    assert list(sandwich.iter_objects(type=Name.Page, stream=True)) == []
+
+
+def test_iter_objects_invalid(sandwich):
+    with pytest.raises(ValueError):
+        sandwich.iter_objects(type='Page')
+    with pytest.raises(TypeError):
+        sandwich.iter_objects(Name.Page)
+
+
+def test_intern_scalars():
+    d = Dictionary(Type=Name.Font, Title=String('title'), Long=String('x' * 100))
+    assert d.Type is not d.Type
+    assert pikepdf.settings.set_intern_scalars(True)
+    try:
+        assert pikepdf.settings.get_intern_scalars()
+        assert d.Type is d.Type
+        assert d.Title is d.Title
+        assert d.Long is not d.Long
+        assert d.Type == Name.Font
+        assert Dictionary(Type=Name.Font).Type is d.Type
+    finally:
+        pikepdf.settings.set_intern_scalars(False)
+    assert d.Type is not d.Type
+
+
+def test_eq_deep_nesting():
+    a, b = Array([42]), Array([42])
+    for _ in range(200):
+        a, b = Array([a]), Array([b])
+    rlimit = sys.getrecursionlimit()
+    try:
+        sys.setrecursionlimit(100)
+        assert a == b
+        assert a.deep_equal(b)
+        assert a.content_hash() == b.content_hash()
+    finally:
+        sys.setrecursionlimit(rlimit)
+
+
+def test_deep_equal():
+    pdf1, pdf2 = Pdf.new(), Pdf.new()
+    for pdf in (pdf1, pdf2):
+        pdf.Root.Shared = pdf.make_indirect(Dictionary(N=1))
+        pdf.Root.Data = Stream(pdf, b'data')
+    d1 = Dictionary(A=pdf1.Root.Shared, B=Array([1, 2.0, String('x')]))
+    d2 = Dictionary(A=pdf2.Root.Shared, B=Array([1.0, 2, String('x')]))
+    assert d1.deep_equal(d2)
+    assert not d1.deep_equal(d2, follow_indirect=False)
+    assert d1.deep_equal(copy(d1), follow_indirect=False)
+
+    d3 = Dictionary(A=pdf1.make_indirect(Dictionary(N=1)), B=d1.B)
+    assert d1 != d3
+    assert d1.deep_equal(d3)
+
+    assert pdf1.Root.Data != pdf2.Root.Data
+    assert pdf1.Root.Data.deep_equal(pdf2.Root.Data)
+    pdf2.Root.Data.write(b'other')
+    assert not pdf1.Root.Data.deep_equal(pdf2.Root.Data)
+
+    d2.B.append(3)
+    assert not d1.deep_equal(d2)
+
+
+def test_deep_equal_cycle():
+    pdf = Pdf.new()
+    a = pdf.make_indirect(Dictionary(N=1))
+    b = pdf.make_indirect(Dictionary(N=1))
+    a.Next, b.Next = a, b
+    assert a != b
+    assert a.deep_equal(b)
+    assert a.content_hash() == b.content_hash()
+    b.N = 2
+    assert not a.deep_equal(b)
+    assert a.content_hash() != b.content_hash()
+
+
+def test_content_hash():
+    d = Dictionary(A=1, B=Array([Name.X, String('y')]))
+    digest = d.content_hash()
+    assert isinstance(digest, bytes) and len(digest) == 16
+    assert Dictionary(B=Array([Name.X, String('y')]), A=1.0).content_hash() == digest
+    assert Dictionary(A=2, B=Array([Name.X, String('y')])).content_hash() != digest
+    assert Array([1, 2]).content_hash() != Array([[1, 2]]).content_hash()
+    assert String('x').content_hash() != Name('/x').content_hash()
+
+    pdf = Pdf.new()
+    s1, s2 = Stream(pdf, b'one'), Stream(pdf, b'two')
+    assert s1.content_hash() == s2.content_hash()
+    assert s1.content_hash(stream_data=True) != s2.content_hash(stream_data=True)
+
+    shared = pdf.make_indirect(Dictionary(N=1))
+    other = pdf.make_indirect(Dictionary(N=1))
+    assert Array([shared]).content_hash() == Array([other]).content_hash()
+    assert (
+        Array([shared]).content_hash(follow_indirect=False)
+        != Array([other]).content_hash(follow_indirect=False)
+    )
+
+
 def test_object_not_iterable():
     with pytest.raises(TypeError, match="__iter__ not available"):
         iter(pikepdf.Name.A)
@@ -744,3 +996,72 @@ def test_swap_object(resources):
         pdf._swap_objects(pdf.pages[0].objgen, pdf.pages[1].objgen)
         assert pdf.pages[1].MarkPage0
         assert Name.MarkPage0 not in pdf.pages[0]
+
+
+def test_as_float_array():
+    a = Array([0, Decimal('1.5'), -3, 612.25])
+    floats = a.as_float_array()
+    assert isinstance(floats, memoryview)
+    assert floats.format == 'd'
+    assert floats.tolist() == [0.0, 1.5, -3.0, 612.25]
+
+
+def test_as_float_array_rejects_mixed():
+    with pytest.raises(TypeError, match='item 1'):
+        Array([1, Name.Foo, 2]).as_float_array()
+    with pytest.raises(TypeError, match='not an array'):
+        Dictionary().as_float_array()
+
+
+def test_as_float_array_empty():
+    assert Array().as_float_array().tolist() == []
+
+
+def test_from_floats():
+    from array import array
+
+    values = [0.5, -1.25, 3.0]
+    for source in (values, array('d', values), Array(values).as_float_array()):
+        a = Array.from_floats(source)
+        assert a.as_float_array().tolist() == values
+    with pytest.raises(ValueError):
+        Array.from_floats([float('nan')])
+
+
+def test_from_records():
+    records = [{'/Index': i, '/Name': Name.Foo, '/T': f'field{i}'} for i in range(3)]
+    dicts = Dictionary.from_records(records)
+    assert len(dicts) == 3
+    for i, d in enumerate(dicts):
+        assert d == Dictionary(Index=i, Name=Name.Foo, T=String(f'field{i}'))
+        assert not d.is_indirect
+
+
+def test_from_records_template():
+    template = Dictionary(Type=Name.Annot, Rect=[0, 0, 10, 10], Border=[0, 0, 1])
+    dicts = Dictionary.from_records(
+        [{'/Index': 0}, {'/Index': 1, '/Border': None}], template=template
+    )
+    assert dicts[0].Type == Name.Annot
+    assert dicts[0].Border == [0, 0, 1]
+    assert '/Border' not in dicts[1]
+    dicts[0].Rect[0] = 5
+    assert dicts[1].Rect[0] == 0
+    assert template.Rect[0] == 0
+    assert '/Index' not in template
+
+
+def test_from_records_owner():
+    pdf = Pdf.new()
+    dicts = Dictionary.from_records(({'/Index': i} for i in range(4)), owner=pdf)
+    assert all(d.is_indirect for d in dicts)
+    assert len({d.objgen for d in dicts}) == 4
+
+
+def test_from_records_invalid():
+    with pytest.raises(KeyError):
+        Dictionary.from_records([{'Index': 1}])
+    with pytest.raises(TypeError):
+        Dictionary.from_records([[1, 2]])
+    with pytest.raises(TypeError):
+        Dictionary.from_records([{}], template={'/Type': Name.Annot})
@@ -497,3 +497,49 @@ def test_outline_repr(resources):
         with pdf.open_outline() as outline:
             assert repr(outline).startswith('<pikepdf.Outline:')
             assert repr(outline.root[0]).startswith('<pikepdf.OutlineItem')
+
+
+def _walk(items):
+    for item in items:
+        yield item
+        yield from _walk(item.children)
+
+
+def test_children_loaded_lazily(outlines_doc):
+    with outlines_doc.open_outline() as outline:
+        first = outline.root[0]
+        assert first._children is None
+        assert len(first.children) == 2
+        assert first._children is not None
+        assert first.children[0].obj == outlines_doc.Root.Outlines.First.First
+
+
+def test_page_index(outlines_doc):
+    with outlines_doc.open_outline() as outline:
+        outline.root.append(OutlineItem('Page two', 1))
+        outline.root.append(OutlineItem('Named', Name.Nowhere))
+    with outlines_doc.open_outline() as outline:
+        page_two, named = outline.root[-2:]
+        assert page_two.page_index == 1
+        assert named.page_index is None
+        page_two.destination = 0
+        assert page_two.page_index == 0
+        page_two.destination = make_page_destination(outlines_doc, 0)
+        assert page_two.page_index is None
+
+
+def test_unchanged_subtree_not_rewritten(outlines_doc):
+    # Write everything once, so that the whole tree is as Outline writes it
+    with outlines_doc.open_outline() as outline:
+        list(_walk(outline.root))
+
+    deep = outlines_doc.Root.Outlines.First.First.Next.First
+    deep.Dest = 0  # Would become a page destination if rewritten
+    with outlines_doc.open_outline() as outline:
+        outline.root[1].title = 'Changed'
+    assert outlines_doc.Root.Outlines.First.Next.Title == 'Changed'
+    assert deep.Dest == 0
+
+    with outlines_doc.open_outline() as outline:
+        list(_walk(outline.root))
+    assert deep.Dest == make_page_destination(outlines_doc, 0)
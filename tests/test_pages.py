@@ -1,5 +1,6 @@
 import gc
 from contextlib import suppress
+from io import BytesIO
 from shutil import copy
 from typing import Type
 
@@ -11,7 +12,16 @@ except ImportError:
 import pytest
 from conftest import skip_if_pypy
 
-from pikepdf import Array, Dictionary, Name, Page, Pdf, PdfMatrix, Stream
+from pikepdf import (
+    Array,
+    Dictionary,
+    Name,
+    Page,
+    Pdf,
+    PdfMatrix,
+    Stream,
+    parse_content_stream,
+)
 from pikepdf._cpphelpers import label_from_label_dict
 
 # pylint: disable=redefined-outer-name,pointless-statement
@@ -107,6 +117,109 @@ def test_reverse_pages(resources, outdir):
         assert qr.pages[n].Contents.stream_dict.Length == length
 
 
+def test_reverse_keeps_page_objects(fourpages):
+    objgens = [page.objgen for page in fourpages.pages]
+    fourpages.pages.reverse()
+    assert [page.objgen for page in fourpages.pages] == objgens[::-1]
+    assert all(page.Parent == fourpages.Root.Pages for page in fourpages.pages)
+    assert fourpages.Root.Pages.Count == 4
+
+
+def test_page_list_sees_external_edits(fourpages):
+    pdf = fourpages
+    pdf.pages.append(pdf.pages[0])  # Ensures the page tree is flat
+    assert len(pdf.pages) == 5
+
+    pages_root = pdf.Root.Pages
+    del pages_root.Kids[0]
+    pages_root.Count = len(pages_root.Kids)
+    assert len(pdf.pages) == 4
+    assert pdf.pages[0] == pages_root.Kids[0]
+
+
+def test_page_list_sees_reordered_kids(fourpages):
+    pdf = fourpages
+    pdf.pages.append(pdf.pages[0])  # Ensures the page tree is flat
+    del pdf.pages[-1]
+    objgens = [page.objgen for page in pdf.pages]
+
+    # The same /Count, in a different order
+    kids = pdf.Root.Pages.Kids
+    kids[0], kids[3] = kids[3], kids[0]
+    assert [page.objgen for page in pdf.pages] == [
+        objgens[3],
+        objgens[1],
+        objgens[2],
+        objgens[0],
+    ]
+
+    pdf.Root.Pages.Kids = Array(list(pdf.Root.Pages.Kids)[::-1])
+    assert [page.objgen for page in pdf.pages] == [
+        objgens[0],
+        objgens[2],
+        objgens[1],
+        objgens[3],
+    ]
+
+
+@pytest.fixture
+def inherited_attrs(fourpages):
+    # Move the page attributes up to the root of the page tree
+    pdf = fourpages
+    pdf.Root.Pages.MediaBox = pdf.pages[0].MediaBox
+    pdf.Root.Pages.Rotate = 90
+    for page in pdf.Root.Pages.Kids:
+        del page.MediaBox
+    bio = BytesIO()
+    pdf.save(bio, static_id=True)
+    return bio
+
+
+def test_lazy_open(inherited_attrs):
+    with Pdf.open(inherited_attrs, lazy=True) as pdf:
+        assert Name.MediaBox not in pdf.Root.Pages.Kids[1]
+        assert pdf.open_timings['inherit_page_attributes'] == 0
+        assert pdf.pages[1].Rotate == 90
+        assert Name.MediaBox in pdf.Root.Pages.Kids[1]
+        assert Name.MediaBox not in pdf.Root.Pages.Kids[2]
+        # Shared as one indirect object, as an eager open would
+        assert pdf.pages[1].MediaBox.is_indirect
+        assert pdf.pages[3].MediaBox.objgen == pdf.pages[1].MediaBox.objgen
+        assert pdf.open_timings['read'] > 0
+        lazy = BytesIO()
+        pdf.save(lazy, static_id=True)
+        assert Name.MediaBox in pdf.Root.Pages.Kids[2]
+        assert Name.MediaBox not in pdf.Root.Pages
+
+    inherited_attrs.seek(0)
+    with Pdf.open(inherited_attrs) as pdf:
+        assert Name.MediaBox in pdf.Root.Pages.Kids[2]
+        assert Name.MediaBox not in pdf.Root.Pages
+        eager = BytesIO()
+        pdf.save(eager, static_id=True)
+    assert lazy.getvalue() == eager.getvalue()
+
+
+def test_lazy_open_modify_pages(inherited_attrs):
+    with Pdf.open(inherited_attrs, lazy=True) as pdf:
+        del pdf.pages[0]
+        assert all(Name.MediaBox in page for page in pdf.Root.Pages.Kids)
+
+
+@pytest.mark.timeout(20)
+def test_many_pages(fourpages):
+    pdf = fourpages
+    while len(pdf.pages) < 2000:
+        pdf.pages.append(pdf.pages[-1])
+    assert sum(1 for _ in pdf.pages) == 2000
+    assert len(pdf.pages[::2]) == 1000
+    last = pdf.pages[-1].objgen
+    pdf.pages.reverse()
+    assert pdf.pages[0].objgen == last
+    pdf.pages.extend(pdf.pages[:500])
+    assert len(pdf.pages) == 2500
+
+
 @skip_if_pypy
 def test_evil_page_deletion(resources, outdir):
     # str needed for py<3.6
@@ -200,6 +313,97 @@ def test_slice_differing_lengths(fourpages, sandwich):
         pdf.pages[0::2] = pdf2.pages[0:1]
 
 
+def test_import_pages(fourpages, sandwich, graph, outdir):
+    pdf = Pdf.new()
+    sandwich_len = int(sandwich.pages[0].Contents.Length)
+    pdf.import_pages([fourpages, sandwich.pages, graph.pages[:1], [graph.pages[0]]])
+    assert len(pdf.pages) == 7
+    assert pdf.pages[4].Contents.Length == sandwich_len
+    assert pdf.pages[5].objgen != pdf.pages[6].objgen
+    assert all(page.Parent == pdf.Root.Pages for page in pdf.pages)
+
+    pdf.import_pages([pdf])
+    assert len(pdf.pages) == 14
+    pdf.save(outdir / 'imported.pdf')
+    with Pdf.open(outdir / 'imported.pdf') as reopened:
+        assert len(reopened.pages) == 14
+
+
+@pytest.mark.parametrize('as_pages', [False, True])
+def test_import_pages_from_generator(resources, outdir, as_pages):
+    names = ['fourpages.pdf', 'graph.pdf', 'sandwich.pdf']
+
+    def sources():
+        for name in names:
+            src = Pdf.open(resources / name)
+            yield src.pages if as_pages else list(src.pages)
+
+    pdf = Pdf.new()
+    pdf.import_pages(sources())
+    gc.collect()
+    pdf.save(outdir / 'imported.pdf')
+    with Pdf.open(outdir / 'imported.pdf') as reopened:
+        assert len(reopened.pages) == 6
+        assert reopened.pages[5].Contents.read_bytes()
+
+
+def test_copy_foreign_many_from_generator(resources):
+    def streams():
+        for _ in range(2):
+            yield Pdf.open(resources / 'sandwich.pdf').pages[0].Contents
+
+    pdf = Pdf.new()
+    copies = pdf.copy_foreign_many(streams())
+    gc.collect()
+    assert all(copy.read_bytes() for copy in copies)
+    pdf.save(BytesIO())
+
+
+def test_import_pages_not_pages(fourpages, graph):
+    with pytest.raises(TypeError):
+        fourpages.import_pages([[graph.Root]])
+    assert len(fourpages.pages) == 4
+
+
+def _pdf_with_font_stream():
+    pdf = Pdf.new()
+    pdf.add_blank_page()
+    font_file = Stream(pdf, b'pretend this is a font program')
+    pdf.pages[0].Resources = Dictionary(
+        Font=Dictionary(
+            F1=pdf.make_indirect(
+                Dictionary(
+                    Type=Name.Font,
+                    FontDescriptor=Dictionary(FontFile2=font_file),
+                )
+            )
+        )
+    )
+    return pdf
+
+
+@pytest.mark.parametrize('deduplicate', [False, True])
+def test_import_pages_deduplicate(deduplicate):
+    sources = [_pdf_with_font_stream() for _ in range(3)]
+    pdf = Pdf.new()
+    pdf.import_pages(sources, deduplicate_streams=deduplicate)
+    font_files = {
+        page.Resources.Font.F1.FontDescriptor.FontFile2.objgen for page in pdf.pages
+    }
+    assert len(font_files) == (1 if deduplicate else 3)
+    assert (
+        pdf.pages[2].Resources.Font.F1.FontDescriptor.FontFile2.read_bytes()
+        == b'pretend this is a font program'
+    )
+
+
+def test_copy_foreign_many(fourpages, graph):
+    objects = [graph.make_stream(b'one'), graph.make_stream(b'two')]
+    copies = fourpages.copy_foreign_many(objects)
+    assert [copy.read_bytes() for copy in copies] == [b'one', b'two']
+    assert all(copy.is_owned_by(fourpages) for copy in copies)
+
+
 @pytest.mark.timeout(1)
 def test_self_extend(fourpages):
     pdf = fourpages
@@ -427,6 +631,22 @@ def test_page_index(fourpages):
         assert fourpages.pages.index(page) == n
 
 
+def test_page_index_after_low_level_page_operations(fourpages):
+    first, second = fourpages.pages[0], fourpages.pages[1]
+    assert Page(second).index == 1
+    fourpages._remove_page(first)
+    assert Page(second).index == 0
+    fourpages._add_page(first, first=False)
+    assert Page(first).index == 3
+    fourpages._remove_page(first)
+    fourpages._add_page_at(first, True, second)
+    assert Page(first).index == 0
+    assert Page(second).index == 1
+    blank = fourpages.add_blank_page()
+    assert Page(blank).index == 4
+    assert fourpages.pages.index(blank) == 4
+
+
 def test_page_index_foreign_page(fourpages, sandwich):
     with pytest.raises(ValueError, match="Page is not in this Pdf"):
         fourpages.pages.index(sandwich.pages[0])
@@ -516,6 +736,34 @@ def test_page_labels():
         assert page.label == labels[n]
 
 
+def test_page_labels_nested_number_tree():
+    p = Pdf.new()
+    d = Dictionary(Type=Name.Page, MediaBox=[0, 0, 612, 792], Resources=Dictionary())
+    for _ in range(4):
+        p.pages.append(d)
+
+    p.Root.PageLabels = p.make_indirect(
+        Dictionary(
+            Kids=Array(
+                [
+                    Dictionary(Limits=[0, 0], Nums=[0, Dictionary(S=Name.A)]),
+                    Dictionary(Limits=[2, 2], Nums=[2, Dictionary(S=Name.D, St=7)]),
+                ]
+            )
+        )
+    )
+    assert [Page(page).label for page in p.pages] == ['A', 'B', '7', '8']
+
+
+def test_page_index_after_edits(fourpages):
+    pages = fourpages.pages
+    pages.reverse()
+    for n, page in enumerate(pages):
+        assert Page(page).index == n
+    del pages[0]
+    assert [Page(page).index for page in pages] == [0, 1, 2]
+
+
 def test_unattached_page():
     rawpage = Dictionary(
         Type=Name.Page, MediaBox=[0, 0, 612, 792], Resources=Dictionary()
@@ -534,3 +782,81 @@ def test_unindexed_page(graph):
     del graph.pages[0]
     with pytest.raises(ValueError, match='not consistently registered'):
         page.index
+
+
+def _analysis_pdf():
+    pdf = Pdf.new()
+    image = Stream(pdf, b'\xff' * 3)
+    image.Type, image.Subtype = Name.XObject, Name.Image
+    image.Width, image.Height, image.BitsPerComponent = 1, 1, 8
+    image.ColorSpace = Name.DeviceRGB
+    form = Stream(pdf, b'')
+    form.Type, form.Subtype, form.BBox = Name.XObject, Name.Form, [0, 0, 1, 1]
+    font = Dictionary(Type=Name.Font, Subtype=Name.Type1, BaseFont=Name.Helvetica)
+
+    page = pdf.add_blank_page()
+    page.Resources = Dictionary(
+        Font=Dictionary(F1=font), XObject=Dictionary(Im0=image, Fm0=form)
+    )
+    page.Contents = Array(
+        [
+            Stream(pdf, b'q 2 0 0 3 10 20 cm /Im0 Do Q /Fm0 Do'),
+            Stream(
+                pdf,
+                b'BT /F1 12 Tf 100 200 Td (Hello) Tj '
+                b'0 -50 Td [(Wor) -10 (ld)] TJ ET '
+                b'q 2 0 0 2 0 0 cm BI /W 1 /H 1 /BPC 8 /CS /G ID \x00 EI Q',
+            ),
+        ]
+    )
+    pdf.add_blank_page().Contents = Stream(pdf, b'q 1 0 0 1 0 0 cm (unterminated')
+    return pdf
+
+
+@pytest.mark.parametrize('jobs', [None, 1, 2])
+def test_analyze(jobs):
+    pdf = _analysis_pdf()
+    first, second = pdf.pages.analyze(jobs=jobs)
+
+    assert first.operators['Do'] == 2 and first.operators['cm'] == 2
+    assert first.operators['Tj'] == 1 and first.operators['TJ'] == 1
+    assert 'ID' not in first.operators
+    assert first.resources == {'/XObject': ['/Im0', '/Fm0'], '/Font': ['/F1']}
+    # Only images, not forms, and inline images have no name
+    assert first.images == [
+        ('/Im0', (2.0, 0.0, 0.0, 3.0, 10.0, 20.0)),
+        (None, (2.0, 0.0, 0.0, 2.0, 0.0, 0.0)),
+    ]
+    assert first.text_shows == 2
+    assert first.text_bytes == len(b'Hello') + len(b'World')
+    assert first.text_bbox == (100.0, 150.0, 100.0, 200.0)
+    assert first.error is None
+
+    assert second.operators == {'q': 1, 'cm': 1}
+    assert second.text_bbox is None
+    assert second.error is not None
+
+
+def test_analyze_collect():
+    pdf = _analysis_pdf()
+    (first, _second) = pdf.pages.analyze(collect=['text'])
+    assert first.operators is None and first.resources is None
+    assert first.images is None
+    assert first.text_shows == 2
+    with pytest.raises(ValueError, match='unknown page analysis'):
+        pdf.pages.analyze(collect=['glyphs'])
+    with pytest.raises(TypeError):
+        pdf.pages.analyze(collect='text')
+    with pytest.raises(ValueError):
+        pdf.pages.analyze(jobs=0)
+
+
+def test_analyze_matches_parse(graph):
+    (analysis,) = graph.pages.analyze()
+    counts = {}
+    for _operands, operator in parse_content_stream(graph.pages[0]):
+        counts[str(operator)] = counts.get(str(operator), 0) + 1
+    counts.pop('INLINE IMAGE', None)
+    operators = dict(analysis.operators)
+    operators.pop('BI', None)
+    assert operators == counts
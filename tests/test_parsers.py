@@ -1,3 +1,4 @@
+import gc
 import shutil
 import sys
 from subprocess import PIPE, run
@@ -176,3 +177,55 @@ def test_unparse_invalid_inline_image():
 
     with pytest.raises(PdfParsingError):
         unparse_content_stream(instructions)
+
+
+def test_parse_lazy(resources):
+    with Pdf.open(resources / 'graph.pdf') as pdf:
+        page = pdf.pages[0]
+        eager = parse_content_stream(page)
+        lazy = parse_content_stream(page, lazy=True)
+        assert len(lazy) == len(eager)
+        assert list(lazy) == eager
+        assert lazy[-1] == eager[-1]
+        assert lazy[1:4] == eager[1:4]
+        assert lazy.operator_name(0) == str(eager[0][1])
+        with pytest.raises(IndexError):
+            lazy[len(eager)]
+        assert unparse_content_stream(lazy) == unparse_content_stream(eager)
+
+
+@pytest.mark.parametrize('of_stream', [False, True])
+def test_parse_lazy_outlives_pdf(resources, of_stream):
+    def parse():
+        pdf = Pdf.open(resources / 'graph.pdf')
+        page = pdf.pages[0]
+        # Bytes, so that nothing else refers to the Pdf
+        expected = unparse_content_stream(parse_content_stream(page))
+        target = page.Contents if of_stream else page
+        return expected, parse_content_stream(target, lazy=True)
+
+    expected, lazy = parse()
+    gc.collect()
+    assert unparse_content_stream(list(lazy)) == expected
+
+
+def test_parse_lazy_filtered(resources):
+    with Pdf.open(resources / 'graph.pdf') as pdf:
+        page = pdf.pages[0]
+        eager = parse_content_stream(page, 'cm q Q Do')
+        lazy = parse_content_stream(page, 'cm q Q Do', lazy=True)
+        assert list(lazy) == eager
+        assert {str(op) for _, op in lazy} <= {'cm', 'q', 'Q', 'Do'}
+        stream = parse_content_stream(page.Contents, 'cm', lazy=True)
+        assert all(str(op) == 'cm' for _, op in stream)
+
+
+def test_parse_lazy_inline(resources):
+    with Pdf.open(resources / 'image-mono-inline.pdf') as pdf:
+        p0 = pdf.pages[0]
+        cmds = parse_content_stream(p0, lazy=True)
+        iimages = [
+            operands[0] for operands, op in cmds if op == Operator('INLINE IMAGE')
+        ]
+        assert iimages and isinstance(iimages[0], pikepdf.PdfInlineImage)
+        assert b'BI' in unparse_content_stream(cmds)
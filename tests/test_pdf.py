@@ -14,7 +14,7 @@ from unittest.mock import Mock
 import pytest
 
 import pikepdf
-from pikepdf import Name, PasswordError, Pdf, PdfError, Stream
+from pikepdf import Array, Name, PasswordError, Pdf, PdfError, Stream
 
 # pylint: disable=redefined-outer-name
 
@@ -304,6 +304,265 @@ def test_check(resources):
         assert 'parse error while reading' in problems[0]
 
 
+@pytest.mark.parametrize('jobs', [None, 1, 3])
+def test_verify(resources, jobs):
+    with pikepdf.open(resources / 'content-stream-errors.pdf') as pdf:
+        problems = pdf.verify(jobs=jobs)
+        content = {p.page: p for p in problems if p.kind == 'content'}
+        assert {0, 3} <= set(content) and 1 not in content
+        assert content[0].objgen == pdf.pages[0].objgen
+        assert 'array or dictionary' in content[0].message
+
+
+def test_verify_clean(resources):
+    with pikepdf.open(resources / 'graph.pdf') as pdf:
+        assert pdf.verify() == []
+
+
+def test_verify_bad_stream(resources):
+    with pikepdf.open(resources / 'graph.pdf') as pdf:
+        stream = pdf.make_stream(b'not compressed')
+        stream.Filter = Name.FlateDecode
+        pdf.Root.Broken = stream
+        problems = pdf.verify(jobs=2)
+        assert [p.kind for p in problems] == ['stream']
+        assert problems[0].objgen == stream.objgen
+        assert problems[0].page is None
+        with pytest.raises(ValueError):
+            pdf.verify(jobs=0)
+
+
+def test_verify_keeps_warnings():
+    pdf = Pdf.new()
+    pdf.add_blank_page()
+    bio = BytesIO()
+    pdf.save(bio)
+    data = bio.getvalue()
+    damaged = data[: data.rindex(b'startxref')] + b'startxref\n999999\n%%EOF\n'
+    with Pdf.open(BytesIO(damaged)) as pdf:
+        warnings = [p.message for p in pdf.verify() if p.kind == 'warning']
+        assert warnings
+        assert [p.message for p in pdf.verify() if p.kind == 'warning'] == warnings
+        assert pdf.get_warnings() == warnings
+        assert pdf.get_warnings() == []
+
+
+def test_stats(resources):
+    with Pdf.open(resources / 'graph.pdf') as pdf:
+        stats = pdf.stats()
+        assert stats['input']['bytes_read'] > 0
+        assert stats['input']['read_calls'] > 0
+        assert stats['objects'] == len(pdf.objects)
+        assert stats['streams_decoded'] == {}
+
+        data = b'q Q ' * 100
+        stream = pdf.make_stream(zlib.compress(data))
+        stream.Filter = Name.FlateDecode
+        stream.read_bytes()
+        assert stats != pdf.stats()
+        decoded = pdf.stats()['streams_decoded']['/FlateDecode']
+        assert decoded['streams'] == 1
+        assert decoded['bytes_out'] == len(data)
+
+        assert pdf.stats()['seconds']['write'] == 0
+        pdf.save(BytesIO())
+        assert pdf.stats()['seconds']['write'] > 0
+
+
+def test_stats_counts_reads_of_input(resources):
+    path = resources / 'graph.pdf'
+    size = path.stat().st_size
+    with Pdf.open(path, access_mode=pikepdf._qpdf.AccessMode.mmap_only) as pdf:
+        stats = pdf.stats()['input']
+        assert stats['kind'] == 'mmap'
+        assert (stats['bytes_read'], stats['read_calls']) == (size, 1)
+        assert 'seek_calls' not in stats
+    with Pdf.open(path, access_mode=pikepdf._qpdf.AccessMode.fd) as pdf:
+        stats = pdf.stats()['input']
+        assert stats['kind'] == 'fd'
+        # Reads of the read-ahead window, not of each token
+        assert stats['bytes_read'] > 0
+        assert 0 < stats['read_calls'] < size // 1000
+        # Reads are at an offset, so there are no seeks to report
+        assert 'seek_calls' not in stats
+
+
+def test_stats_stream_input(resources):
+    data = BytesIO((resources / 'graph.pdf').read_bytes())
+    with Pdf.open(data, access_mode=pikepdf._qpdf.AccessMode.stream) as pdf:
+        stats = pdf.stats()
+        assert stats['input']['kind'] == 'stream'
+        assert stats['input']['seek_calls'] > 0
+        assert stats['gil_acquisitions'] > 0
+        acquisitions = stats['gil_acquisitions']
+        pdf.save(BytesIO())
+        assert pdf.stats()['gil_acquisitions'] > acquisitions
+
+
+def _pdf_with_duplicates():
+    pdf = Pdf.new()
+    data = zlib.compress(b'duplicate data ' * 1000)
+    wrappers = []
+    for _ in range(2):
+        stream = pdf.make_stream(data)
+        stream.Filter = Name.FlateDecode
+        wrappers.append(pdf.make_indirect(pikepdf.Dictionary(Data=stream)))
+    pdf.Root.Wrappers = pikepdf.Array(wrappers)
+    pdf.Root.Unique = pdf.make_stream(b'unique')
+    return pdf, data
+
+
+@pytest.mark.parametrize('jobs', [None, 1, 3])
+def test_deduplicate(jobs):
+    with _pdf_with_duplicates()[0] as pdf:
+        first, second = pdf.Root.Wrappers
+        result = pdf.deduplicate(jobs=jobs)
+        # Merging the streams makes the dictionaries that hold them identical
+        assert result.streams == 1
+        assert result.objects == 1
+        assert result.bytes_saved > 0
+        assert pdf.Root.Wrappers[0].objgen == pdf.Root.Wrappers[1].objgen
+        assert pdf.Root.Wrappers[0].objgen == first.objgen
+        assert second.objgen not in {obj.objgen for obj in pdf.Root.Wrappers}
+        # The merged duplicate is no longer referred to, but still works
+        assert second.Data.read_raw_bytes() == first.Data.read_raw_bytes()
+        assert pdf.Root.Unique.read_bytes() == b'unique'
+        assert pdf.deduplicate() == (0, 0, 0)
+        with pytest.raises(ValueError):
+            pdf.deduplicate(jobs=0)
+
+
+def test_deduplicate_keeps_annotations():
+    pdf = pikepdf.new()
+    for _ in range(2):
+        page = pdf.add_blank_page()
+        link = pikepdf.Dictionary(Subtype=Name.Link, Rect=[0, 0, 10, 10])
+        link = pdf.make_indirect(link)
+        page.Annots = pikepdf.Array([link])
+    unlisted = [
+        pdf.make_indirect(pikepdf.Dictionary(Subtype=Name.Text, Rect=[0, 0, 1, 1]))
+        for _ in range(2)
+    ]
+    pdf.Root.Unlisted = pikepdf.Array(unlisted)
+    assert pdf.deduplicate() == (0, 0, 0)
+    first, second = (page.Annots[0] for page in pdf.pages)
+    assert first.objgen != second.objgen
+
+
+def test_save_deduplicate():
+    pdf, data = _pdf_with_duplicates()
+    plain, deduplicated = BytesIO(), BytesIO()
+    pdf.save(plain)
+    pdf.save(deduplicated, deduplicate=True)
+    assert len(plain.getvalue()) - len(deduplicated.getvalue()) >= len(data)
+    with Pdf.open(deduplicated) as reopened:
+        first, second = reopened.Root.Wrappers
+        assert first.objgen == second.objgen
+        assert first.Data.read_raw_bytes() == data
+
+
+def test_save_incremental(resources, outdir):
+    target = outdir / 'incremental.pdf'
+    with Pdf.open(resources / 'graph.pdf', inherit_page_attributes=False) as pdf:
+        unchanged = BytesIO()
+        assert pdf.save_incremental(unchanged) == 0
+        assert unchanged.getvalue() == (resources / 'graph.pdf').read_bytes()
+
+        pdf.docinfo['/Title'] = 'Incremental'
+        pdf.Root.Extra = pdf.make_stream(b'new stream ' * 100)
+        assert pdf.save_incremental(target) >= 2
+
+    original = (resources / 'graph.pdf').read_bytes()
+    updated = target.read_bytes()
+    assert updated.startswith(original)
+    assert updated.count(b'%%EOF') == original.count(b'%%EOF') + 1
+    with Pdf.open(target) as pdf:
+        assert str(pdf.docinfo.Title) == 'Incremental'
+        assert pdf.Root.Extra.read_bytes() == b'new stream ' * 100
+        assert pdf.Root.Extra.Filter == Name.FlateDecode
+        assert len(pdf.pages) == 1
+        assert pdf.verify() == []
+
+
+def test_save_incremental_edits_dictionaries(resources, outdir):
+    target = outdir / 'edited.pdf'
+    with Pdf.open(resources / 'graph.pdf', inherit_page_attributes=False) as pdf:
+        pdf.Root.PageMode = Name.UseOutlines
+        pdf.docinfo['/Author'] = 'Someone'
+        pdf.pages[0].Rotate = 90
+        # The catalog, the document info and the page
+        assert pdf.save_incremental(target) == 3
+    with Pdf.open(target) as pdf:
+        assert pdf.Root.PageMode == Name.UseOutlines
+        assert str(pdf.docinfo.Author) == 'Someone'
+        assert pdf.pages[0].Rotate == 90
+        assert pdf.verify() == []
+
+
+def test_save_incremental_in_place(resources, outdir):
+    target = outdir / 'in_place.pdf'
+    shutil.copy(resources / 'graph.pdf', target)
+    size = target.stat().st_size
+    with Pdf.open(
+        target, allow_overwriting_input=True, inherit_page_attributes=False
+    ) as pdf:
+        pdf.pages[0].Contents.write(b'q Q')
+        pdf.Root.Extra = pdf.make_stream(b'extra')
+        # The contents, the catalog and the new stream
+        assert pdf.save_incremental() == 3
+        first_size = target.stat().st_size
+        assert first_size > size
+        # Each save appends what changed since the previous one
+        assert pdf.save_incremental() == 0
+        pdf.pages[0].Contents.write(b'q q Q Q')
+        assert pdf.save_incremental() == 1
+        assert target.stat().st_size > first_size
+        with target.open('ab') as f:
+            f.write(b'\n')
+        pdf.pages[0].Contents.write(b'Q')
+        with pytest.raises(ValueError, match='changed since it was opened'):
+            pdf.save_incremental()
+    original = (resources / 'graph.pdf').read_bytes()
+    assert target.read_bytes().count(b'%%EOF') == original.count(b'%%EOF') + 2
+    with Pdf.open(target) as pdf:
+        assert pdf.pages[0].Contents.read_bytes() == b'q q Q Q'
+        assert pdf.Root.Extra.read_bytes() == b'extra'
+        assert pdf.verify() == []
+
+
+def test_save_incremental_swapped_streams(resources, outdir):
+    target = outdir / 'swapped.pdf'
+    with Pdf.open(resources / 'graph.pdf', inherit_page_attributes=False) as pdf:
+        first = pdf.make_stream(b'first!')
+        second = pdf.make_stream(b'second')
+        pdf.Root.Streams = Array([first, second])
+        saved = outdir / 'streams.pdf'
+        pdf.save(saved, compress_streams=False)
+    with Pdf.open(saved, inherit_page_attributes=False) as pdf:
+        first, second = pdf.Root.Streams
+        # Equal dictionaries, so only the data tells them apart
+        assert first.stream_dict.unparse() == second.stream_dict.unparse()
+        pdf._swap_objects(first.objgen, second.objgen)
+        assert pdf.save_incremental(target) == 2
+    with Pdf.open(target) as pdf:
+        first, second = pdf.Root.Streams
+        assert first.read_bytes() == b'second'
+        assert second.read_bytes() == b'first!'
+
+
+def test_save_incremental_invalid(resources, outdir):
+    with pytest.raises(ValueError, match='not opened from a file'):
+        Pdf.new().save_incremental(BytesIO())
+    with Pdf.open(resources / 'graph-encrypted.pdf', password='owner') as pdf:
+        with pytest.raises(ValueError, match='encrypted'):
+            pdf.save_incremental(BytesIO())
+    with Pdf.open(resources / 'graph.pdf') as pdf:
+        with pytest.raises(ValueError, match='allow_overwriting_input'):
+            pdf.save_incremental()
+        with pytest.raises(ValueError, match='Cannot overwrite input file'):
+            pdf.save_incremental(resources / 'graph.pdf')
+
+
 def test_repr(trivial):
     assert repr(trivial).startswith('<')
 
@@ -325,6 +584,12 @@ def test_recompress(resources, outdir):
         assert smaller.stat().st_size < bigger.stat().st_size
 
 
+def test_save_jobs_invalid(resources):
+    with pikepdf.open(resources / 'graph.pdf') as pdf:
+        with pytest.raises(ValueError, match='jobs'):
+            pdf.save(BytesIO(), jobs=0)
+
+
 def test_flate_compression_level():
     # We don't want to change the compression level because it's global state
     # and will change subsequent test results, so just ping it with an invalid